@@ -2,25 +2,30 @@
 
 
 #include "Components/InteractionComponent.h"
-#include "Components/WidgetComponent.h"
+#include "Subsystems/FocusHighlightSubsystem.h"
+#include "Subsystems/InteractionSubsystem.h"
+#include "Subsystems/InteractionTimerSubsystem.h"
 #include "Trust/TrustCharacter.h"
+#include "Trust/TrustPlayerController.h"
+#include "Widgets/InteractionPromptPool.h"
 #include "Widgets/InteractionWidget.h"
 
 UInteractionComponent::UInteractionComponent() {
-	SetComponentTickEnabled(false);
+	PrimaryComponentTick.bCanEverTick = false;
 
 	InteractionTime = 0.f;
 	InteractionDistance = 200.f;
 	InteractableNameText = FText::FromString("Interactable Object");
 	InteractableActionText = FText::FromString("Interact");
 	bAllowMultipleInteractions = true;
-
-	Space = EWidgetSpace::Screen;
-	DrawSize = FIntPoint(600, 100);
-	bDrawAtDesiredSize = true;
+	bPredictInteraction = false;
+	bOwnerHiddenByPrediction = false;
+	bOwnerCollisionBeforePrediction = false;
+	bInteractRefused = false;
+	OutlineStencilValue = 0;
+	OutlineOwnerComponentCount = INDEX_NONE;
 
 	SetActive(true);
-	SetHiddenInGame(true);
 }
 
 void UInteractionComponent::SetInteractableNameText(const FText& NewNameText) {
@@ -33,9 +38,53 @@ void UInteractionComponent::SetInteractableActionText(const FText& NewActionText
 	RefreshWidget();
 }
 
+void UInteractionComponent::OnRegister() {
+	Super::OnRegister();
+
+	if (IsActive()) {
+		if (UInteractionSubsystem* Registry = GetWorld() ? GetWorld()->GetSubsystem<UInteractionSubsystem>() : nullptr) {
+			Registry->RegisterInteractable(this);
+		}
+	}
+}
+
+void UInteractionComponent::OnUnregister() {
+	if (UInteractionSubsystem* Registry = GetWorld() ? GetWorld()->GetSubsystem<UInteractionSubsystem>() : nullptr) {
+		Registry->UnregisterInteractable(this);
+	}
+
+	Super::OnUnregister();
+}
+
+void UInteractionComponent::OnUpdateTransform(EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport) {
+	Super::OnUpdateTransform(UpdateTransformFlags, Teleport);
+
+	if (UInteractionSubsystem* Registry = GetWorld() ? GetWorld()->GetSubsystem<UInteractionSubsystem>() : nullptr) {
+		Registry->UpdateInteractable(this);
+	}
+}
+
+void UInteractionComponent::Activate(bool bReset) {
+	Super::Activate(bReset);
+
+	if (IsActive() && IsRegistered()) {
+		if (UInteractionSubsystem* Registry = GetWorld() ? GetWorld()->GetSubsystem<UInteractionSubsystem>() : nullptr) {
+			Registry->RegisterInteractable(this);
+		}
+	}
+}
+
 void UInteractionComponent::Deactivate() {
 	Super::Deactivate();
 
+	if (UInteractionSubsystem* Registry = GetWorld() ? GetWorld()->GetSubsystem<UInteractionSubsystem>() : nullptr) {
+		Registry->UnregisterInteractable(this);
+	}
+
+	if (UInteractionTimerSubsystem* InteractionTimers = GetWorld() ? GetWorld()->GetSubsystem<UInteractionTimerSubsystem>() : nullptr) {
+		InteractionTimers->CancelInteractionsWith(this);
+	}
+
 	for (int32 i = Interactors.Num() - 1; i >= 0; --i) {
 		if (ATrustCharacter* Interactor = Interactors[i]) {
 			EndFocus(Interactor);
@@ -44,6 +93,7 @@ void UInteractionComponent::Deactivate() {
 	}
 	
 	Interactors.Empty();
+	InteractStartTimes.Empty();
 }
 
 bool UInteractionComponent::CanInteract(ATrustCharacter* Character) const {
@@ -52,7 +102,7 @@ bool UInteractionComponent::CanInteract(ATrustCharacter* Character) const {
 }
 
 void UInteractionComponent::RefreshWidget() {
-	if (UInteractionWidget *InteractionWidget = Cast<UInteractionWidget>(GetUserWidgetObject())) {
+	if (UInteractionWidget *InteractionWidget = PromptWidget.Get()) {
 		InteractionWidget->UpdateInteractionWidget(this);
 	}
 }
@@ -65,13 +115,8 @@ void UInteractionComponent::BeginFocus(ATrustCharacter* Character) {
 	OnBeginFocus.Broadcast(Character);
 
 	if (GetNetMode() != NM_DedicatedServer) {
-		SetHiddenInGame(false);
-		
-		for (auto& VisualComp : GetOwner()->GetComponentsByClass(UPrimitiveComponent::StaticClass())) {
-			if (UPrimitiveComponent* Prim = Cast<UPrimitiveComponent>(VisualComp)) {
-				Prim->SetRenderCustomDepth(true);
-			}
-		}
+		SetPromptVisible(Character, true);
+		SetOutlined(true);
 	}
 
 	RefreshWidget();
@@ -81,43 +126,186 @@ void UInteractionComponent::EndFocus(ATrustCharacter* Character) {
 	OnEndFocus.Broadcast(Character);
 
 	if (GetNetMode() != NM_DedicatedServer) {
-		SetHiddenInGame(true);
+		SetPromptVisible(Character, false);
+		SetOutlined(false);
+	}
+}
+
+void UInteractionComponent::SetPromptVisible(ATrustCharacter* Character, const bool bVisible) {
+	ATrustPlayerController* PlayerController = Character ? Cast<ATrustPlayerController>(Character->GetController()) : nullptr;
+	if (!PlayerController || !PlayerController->IsLocalController()) {
+		return;
+	}
+
+	if (UInteractionPromptPool* Prompts = PlayerController->GetInteractionPrompts()) {
+		if (bVisible) {
+			Prompts->ShowPrompt(this);
+		} else {
+			Prompts->HidePrompt(this);
+		}
+	}
+}
+
+UInteractionWidget* UInteractionComponent::GetPromptWidget() const {
+	return PromptWidget.Get();
+}
+
+void UInteractionComponent::SetPromptWidget(UInteractionWidget* NewPromptWidget) {
+	PromptWidget = NewPromptWidget;
+}
+
+void UInteractionComponent::SetOutlined(const bool bOutlined) {
+	//Batched so sweeping the cursor over a pile of pickups only touches render state for what is still focused at the end of the frame
+	if (UFocusHighlightSubsystem* Highlights = GetWorld() ? GetWorld()->GetSubsystem<UFocusHighlightSubsystem>() : nullptr) {
+		Highlights->RequestHighlight(this, bOutlined);
+		return;
+	}
+
+	for (const TWeakObjectPtr<UPrimitiveComponent>& Primitive : GetOutlinePrimitives()) {
+		if (Primitive.IsValid()) {
+			Primitive->SetRenderCustomDepth(bOutlined);
+		}
+	}
+}
+
+const TArray<TWeakObjectPtr<UPrimitiveComponent>>& UInteractionComponent::GetOutlinePrimitives() {
+	const AActor* Owner = GetOwner();
+	if (!Owner) {
+		OutlinePrimitives.Reset();
+		return OutlinePrimitives;
+	}
 
-		for (auto& VisualComp : GetOwner()->GetComponentsByClass(UPrimitiveComponent::StaticClass())) {
-			if (UPrimitiveComponent* Prim = Cast<UPrimitiveComponent>(VisualComp)) {
-				Prim->SetRenderCustomDepth(false);
+	//Comparing the component count catches components added or removed at runtime without walking them
+	if (OutlineOwnerComponentCount != Owner->GetComponents().Num()) {
+		OutlinePrimitives.Reset();
+		for (UActorComponent* Component : Owner->GetComponents()) {
+			UPrimitiveComponent* Primitive = Cast<UPrimitiveComponent>(Component);
+			if (Primitive) {
+				OutlinePrimitives.Add(Primitive);
 			}
 		}
+		OutlineOwnerComponentCount = Owner->GetComponents().Num();
 	}
+
+	return OutlinePrimitives;
+}
+
+void UInteractionComponent::InvalidateOutlinePrimitives() {
+	OutlineOwnerComponentCount = INDEX_NONE;
 }
 
 void UInteractionComponent::BeginInteract(ATrustCharacter* Character) {
 	if (CanInteract(Character)) {
 		Interactors.AddUnique(Character);
+
+		if (!FMath::IsNearlyZero(InteractionTime)) {
+			const float StartTime = GetWorld()->GetTimeSeconds();
+			InteractStartTimes.Add(Character, StartTime);
+
+			//The prompt animates from this on its own until the hold is cancelled or completes
+			if (UInteractionWidget* Prompt = PromptWidget.Get()) {
+				if (Character->IsLocallyControlled()) {
+					Prompt->BeginInteractProgress(StartTime, InteractionTime);
+				}
+			}
+		}
+
 		OnBeginInteract.Broadcast(Character);
 	}
 }
 
 void UInteractionComponent::EndInteract(ATrustCharacter* Character) {
-	Interactors.RemoveSingle(Character);
+	Interactors.RemoveSingleSwap(Character);
+	FinishInteractProgress(Character, false);
 	OnEndInteract.Broadcast(Character);
 }
 
-void UInteractionComponent::Interact(ATrustCharacter* Character) {
-	if (CanInteract(Character)) {
-		OnInteract.Broadcast(Character);
+bool UInteractionComponent::Interact(ATrustCharacter* Character) {
+	if (!CanInteract(Character)) {
+		return false;
+	}
+
+	FinishInteractProgress(Character, true);
+
+	bInteractRefused = false;
+	OnInteract.Broadcast(Character);
+	const bool bCarriedOut = !bInteractRefused;
+	bInteractRefused = false;
+
+	if (Character) {
+		Character->NotifyInteractFired();
 	}
+	return bCarriedOut;
 }
 
-float UInteractionComponent::GetInteractPercentage() {
-	if (Interactors.IsValidIndex(0)) {
-		if (ATrustCharacter* Interactor = Interactors[0]) {
-			if (Interactor && Interactor->IsInteracting()) {
-				return 1.f - FMath::Abs(Interactor->GetRemainingInteractTime() / InteractionTime);
-			}
+void UInteractionComponent::RefuseInteract() {
+	bInteractRefused = true;
+}
+
+bool UInteractionComponent::CanPredictInteract(ATrustCharacter* Character) const {
+	return bPredictInteraction && FMath::IsNearlyZero(InteractionTime) && CanInteract(Character);
+}
+
+void UInteractionComponent::PredictInteract(ATrustCharacter* Character) {
+	AActor* Owner = GetOwner();
+	if (!Owner || bOwnerHiddenByPrediction) {
+		return;
+	}
+
+	bOwnerHiddenByPrediction = true;
+	bOwnerCollisionBeforePrediction = Owner->GetActorEnableCollision();
+	Owner->SetActorHiddenInGame(true);
+	Owner->SetActorEnableCollision(false);
+
+	//Out of the registry too, so focus moves on right away rather than when the server's destroy arrives
+	if (UInteractionSubsystem* Registry = GetWorld()->GetSubsystem<UInteractionSubsystem>()) {
+		Registry->UnregisterInteractable(this);
+	}
+
+	OnPredictInteract.Broadcast(Character);
+}
+
+void UInteractionComponent::RollbackPredictedInteract(ATrustCharacter* Character) {
+	AActor* Owner = GetOwner();
+	if (!Owner || !bOwnerHiddenByPrediction) {
+		return;
+	}
+
+	bOwnerHiddenByPrediction = false;
+	Owner->SetActorHiddenInGame(false);
+	Owner->SetActorEnableCollision(bOwnerCollisionBeforePrediction);
+
+	if (IsActive()) {
+		if (UInteractionSubsystem* Registry = GetWorld()->GetSubsystem<UInteractionSubsystem>()) {
+			Registry->RegisterInteractable(this);
 		}
 	}
-	return 0.f;
+
+	OnPredictedInteractRejected.Broadcast(Character);
+}
+
+void UInteractionComponent::FinishInteractProgress(ATrustCharacter* Character, const bool bCompleted) {
+	if (InteractStartTimes.Remove(Character) == 0) {
+		return;
+	}
+
+	if (UInteractionWidget* Prompt = PromptWidget.Get()) {
+		if (Character && Character->IsLocallyControlled()) {
+			Prompt->EndInteractProgress(bCompleted);
+		}
+	}
+}
+
+float UInteractionComponent::GetInteractPercentage() {
+	return Interactors.IsValidIndex(0) ? GetInteractPercentageFor(Interactors[0]) : 0.f;
+}
+
+float UInteractionComponent::GetInteractPercentageFor(ATrustCharacter* Character) const {
+	const float* StartTime = InteractStartTimes.Find(Character);
+	if (!StartTime || FMath::IsNearlyZero(InteractionTime)) {
+		return 0.f;
+	}
+	return FMath::Clamp((GetWorld()->GetTimeSeconds() - *StartTime) / InteractionTime, 0.f, 1.f);
 }
 
 float UInteractionComponent::GetInteractionDistance() const {
@@ -126,6 +314,10 @@ float UInteractionComponent::GetInteractionDistance() const {
 
 void UInteractionComponent::SetInteractionDistance(const float NewDistance) {
 	InteractionDistance = NewDistance;
+
+	if (UInteractionSubsystem* Registry = GetWorld() ? GetWorld()->GetSubsystem<UInteractionSubsystem>() : nullptr) {
+		Registry->UpdateInteractable(this);
+	}
 }
 
 void UInteractionComponent::SetInteractionTime(const float NewTime) {
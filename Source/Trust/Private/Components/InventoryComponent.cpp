@@ -4,28 +4,475 @@
 #include "Components/InventoryComponent.h"
 
 #include "Engine/ActorChannel.h"
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
+#include "Net/RepLayout.h"
 #include "Net/UnrealNetwork.h"
+#include "Subsystems/ItemStreamingSubsystem.h"
+#include "Trust/Trust.h"
 
 #define LOCTEXT_NAMESPACE "Inventory"
 
+DECLARE_DWORD_COUNTER_STAT(TEXT("Inventory Notifications Coalesced"), STAT_InventoryNotificationsCoalesced, STATGROUP_Trust);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Inventory Notifications Broadcast"), STAT_InventoryNotificationsBroadcast, STATGROUP_Trust);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Inventory Client Refreshes Sent"), STAT_InventoryClientRefreshesSent, STATGROUP_Trust);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Items Allocated"), STAT_ItemsAllocated, STATGROUP_Trust);
+DECLARE_CYCLE_STAT(TEXT("Inventory Replicate Subobjects"), STAT_InventoryReplicateSubobjects, STATGROUP_Trust);
+
+#if !UE_BUILD_SHIPPING
+static TAutoConsoleVariable<int32> CVarValidateInventoryIndex(
+	TEXT("Trust.Inventory.ValidateIndex"),
+	0,
+	TEXT("If non-zero, inventories recompute their cached item lookups and weight after every change and log any mismatch."),
+	ECVF_Cheat);
+#endif
+
+//Picks the item settings and quantity for a batched request. The quantity isn't clamped to a stack, so a request
+//for more than fits is reported as a partial add of what was asked for
+static const UItem* ResolveRequestTemplate(const FInventoryItemRequest& Request, int32& OutQuantity) {
+	const UItem* Template = Request.Item ? Request.Item : (Request.ItemClass ? Request.ItemClass->GetDefaultObject<UItem>() : nullptr);
+
+	if (Template) {
+		OutQuantity = FMath::Max(Request.Quantity, 0);
+	}
+
+	return Template;
+}
+
+//How many of Template fit into FreeWeight. The one weight rule for adding and for checking an add ahead of time,
+//with a little slack so a capacity that is an exact multiple of the item weight isn't lost to float error
+static int32 GetWeightMaxAddAmount(const UItem* Template, const float FreeWeight) {
+	if (Template->GetItemWeight() <= 0.f) {
+		return MAX_int32;
+	}
+
+	const float MaxAddAmount = FreeWeight / Template->GetItemWeight() + KINDA_SMALL_NUMBER;
+	return MaxAddAmount >= MAX_int32 ? MAX_int32 : FMath::Max(FMath::FloorToInt(MaxAddAmount), 0);
+}
+
+//Stack views aren't one of the inventory's stacks, a request for one is a request for its compact stack
+static FInventoryItemRequest ResolveStackView(const FInventoryItemRequest& Request) {
+	if (Request.Item && Request.Item->IsStackView()) {
+		return FInventoryItemRequest(Request.Item->GetClass(), Request.Quantity);
+	}
+	return Request;
+}
+
+void FInventoryChangeSummary::Record(const EInventoryChangeType ChangeType, UItem* Item, TSubclassOf<UItem> ItemClass) {
+	++NumChanges;
+
+	if (!ItemClass && Item) {
+		ItemClass = Item->GetClass();
+	}
+
+	if (ItemClass) {
+		ChangedClasses.AddUnique(ItemClass);
+	}
+
+	switch (ChangeType) {
+	case EInventoryChangeType::ICT_Added:
+		if (Item && RemovedItems.RemoveSingleSwap(Item) == 0) {
+			AddedItems.AddUnique(Item);
+		}
+		break;
+	case EInventoryChangeType::ICT_Removed:
+		if (Item) {
+			ChangedItems.RemoveSingleSwap(Item);
+
+			//Added and removed inside the same window, the listeners never saw it
+			if (AddedItems.RemoveSingleSwap(Item) == 0) {
+				RemovedItems.AddUnique(Item);
+			}
+		}
+		break;
+	case EInventoryChangeType::ICT_Changed:
+		if (Item && !AddedItems.Contains(Item) && !RemovedItems.Contains(Item)) {
+			ChangedItems.AddUnique(Item);
+		}
+		break;
+	case EInventoryChangeType::ICT_Capacity:
+		bCapacityChanged = true;
+		break;
+	}
+}
+
+void FInventoryChangeSummary::Reset() {
+	AddedItems.Reset();
+	RemovedItems.Reset();
+	ChangedItems.Reset();
+	ChangedClasses.Reset();
+	bCapacityChanged = false;
+	NumChanges = 0;
+}
+
 // Sets default values for this component's properties
 UInventoryComponent::UInventoryComponent() {
+	//Only ticks while notifications are pending, after everything else this frame has had a chance to change the inventory
 	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+	PrimaryComponentTick.TickGroup = TG_PostUpdateWork;
 
 	OnItemAdded.AddDynamic(this, &UInventoryComponent::ItemAdded);
     OnItemRemoved.AddDynamic(this, &UInventoryComponent::ItemRemoved);
 
     SetIsReplicatedByDefault(true);
+
+    bUseDeltaReplication = false;
+    ActivePredictionId = 0;
+
+    BatchDepth = 0;
+    ReplicateSubobjectsCycles = 0;
+    bPendingInventoryUpdate = false;
+    bPendingClientRefresh = false;
+    bPendingItemsKeyBump = false;
+
+    NotificationInterval = 0.f;
+}
+
+void UInventoryComponent::PostInitProperties() {
+	Super::PostInitProperties();
+
+	//Set after property init so the pointer copied over from the archetype is replaced with our own
+	InventoryList.OwnerComponent = this;
+}
+
+void UInventoryComponent::EndPlay(const EEndPlayReason::Type EndPlayReason) {
+	if (UItemStreamingSubsystem* Streaming = GetWorld() ? GetWorld()->GetSubsystem<UItemStreamingSubsystem>() : nullptr) {
+		Streaming->ReleaseAllItemAssets(this);
+	}
+	StreamedItemClasses.Reset();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UInventoryComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) {
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	//Disabled first so a listener that changes the inventory again re-enables the tick for the next frame rather than having it switched off
+	SetComponentTickEnabled(false);
+	FlushPendingNotifications();
 }
 
 FItemAddResult UInventoryComponent::TryAddItem(UItem* Item) {
-	return TryAddItem_Internal(Item);
+	if (!Item) {
+		return FItemAddResult::AddedNone(0, LOCTEXT("NoItemText", "No item to add."));
+	}
+	return TryAddItem_Internal(Item, Item->GetQuantity());
 }
 
 FItemAddResult UInventoryComponent::TryAddItemFromClass(TSubclassOf<UItem> ItemClass, const int32 Quantity /*=1*/) {
-	UItem* Item = NewObject<UItem>(GetOwner(), ItemClass);
-	Item->SetQuantity(Quantity);
-	return TryAddItem_Internal(Item);
+	if (!ItemClass) {
+		return FItemAddResult::AddedNone(Quantity, LOCTEXT("NoItemText", "No item to add."));
+	}
+
+	//The class default object carries everything the add needs, no need for a throwaway item
+	return TryAddItem_Internal(ItemClass->GetDefaultObject<UItem>(), FMath::Max(Quantity, 0));
+}
+
+TArray<FItemAddResult> UInventoryComponent::TryAddItems(const TArray<FInventoryItemRequest>& Requests, const bool bAllOrNothing /*= false*/) {
+	TArray<FItemAddResult> Results;
+	Results.Reserve(Requests.Num());
+
+	if (!GetOwner() || !GetOwner()->HasAuthority()) {
+		//Adding should never be done on a client
+		for (int32 i = 0; i < Requests.Num(); ++i) {
+			Results.Add(FItemAddResult::AddedNone(-1, LOCTEXT("ErrorMessage", "")));
+		}
+		return Results;
+	}
+
+	if (bAllOrNothing && !CanAddAll(Requests, Results)) {
+		return Results;
+	}
+
+	FInventoryBatchScope BatchScope(this);
+
+	for (const FInventoryItemRequest& Request : Requests) {
+		int32 Quantity = 0;
+		if (const UItem* Template = ResolveRequestTemplate(Request, Quantity)) {
+			Results.Add(TryAddItem_Internal(Template, Quantity));
+		} else {
+			Results.Add(FItemAddResult::AddedNone(Request.Quantity, LOCTEXT("NoItemText", "No item to add.")));
+		}
+	}
+
+	return Results;
+}
+
+TArray<int32> UInventoryComponent::RemoveItems(const TArray<FInventoryItemRequest>& Requests, const bool bAllOrNothing /*= false*/) {
+	TArray<int32> RemovedQuantities;
+	RemovedQuantities.SetNumZeroed(Requests.Num());
+
+	if (!GetOwner() || !GetOwner()->HasAuthority() || (bAllOrNothing && !CanRemoveAll(Requests))) {
+		return RemovedQuantities;
+	}
+
+	FInventoryBatchScope BatchScope(this);
+
+	for (int32 i = 0; i < Requests.Num(); ++i) {
+		const FInventoryItemRequest Request = ResolveStackView(Requests[i]);
+
+		if (Request.Item) {
+			if (ItemIndex.Contains(Request.Item)) {
+				RemovedQuantities[i] = ConsumeItem(Request.Item, Request.Quantity);
+			}
+		} else if (Request.ItemClass) {
+			//Work through as many stacks of the class as it takes
+			int32 RemainingQuantity = Request.Quantity;
+			while (RemainingQuantity > 0) {
+				const int32 ConsumedQuantity = ConsumeItemOfClass(Request.ItemClass, RemainingQuantity);
+				if (ConsumedQuantity <= 0) {
+					break;
+				}
+				RemainingQuantity -= ConsumedQuantity;
+			}
+			RemovedQuantities[i] = Request.Quantity - RemainingQuantity;
+		}
+	}
+
+	return RemovedQuantities;
+}
+
+bool UInventoryComponent::CanAddAll(const TArray<FInventoryItemRequest>& Requests, TArray<FItemAddResult>& OutResults, const TArray<FInventoryItemRequest>* OutgoingRequests /*= nullptr*/) const {
+	//Plays the requests against a projected copy of the inventory using the same rules as TryAddItem_Internal
+	float ProjectedWeight = GetCurrentWeight();
+	int32 ProjectedStacks = GetNumStacks();
+	TMap<const UClass*, int32> ProjectedStackQuantities;
+
+	//Outgoing requests are assumed to be valid, CanRemoveAll checks that. A stack projected down to zero is gone
+	if (OutgoingRequests) {
+		for (const FInventoryItemRequest& Outgoing : *OutgoingRequests) {
+			const UItem* Template = Outgoing.Item ? Outgoing.Item : (Outgoing.ItemClass ? Outgoing.ItemClass->GetDefaultObject<UItem>() : nullptr);
+			if (!Template) {
+				continue;
+			}
+
+			ProjectedWeight -= Outgoing.Quantity * Template->GetItemWeight();
+
+			if (Template->IsStackable()) {
+				int32* StackQuantity = ProjectedStackQuantities.Find(Template->GetClass());
+				if (!StackQuantity) {
+					int32 ExistingQuantity = 0;
+					FindStackQuantity(Template->GetClass(), ExistingQuantity);
+					StackQuantity = &ProjectedStackQuantities.Add(Template->GetClass(), ExistingQuantity);
+				}
+
+				if (*StackQuantity > 0 && *StackQuantity - Outgoing.Quantity <= 0) {
+					--ProjectedStacks;
+				}
+				*StackQuantity = FMath::Max(*StackQuantity - Outgoing.Quantity, 0);
+			} else {
+				ProjectedStacks -= Outgoing.Item ? 1 : Outgoing.Quantity;
+			}
+		}
+	}
+
+	int32 FailedIndex = INDEX_NONE;
+	FText FailedText;
+
+	for (int32 i = 0; i < Requests.Num() && FailedIndex == INDEX_NONE; ++i) {
+		int32 Quantity = 0;
+		const UItem* Template = ResolveRequestTemplate(Requests[i], Quantity);
+
+		if (!Template) {
+			FailedText = LOCTEXT("NoItemText", "No item to add.");
+		} else if (Quantity > (Template->IsStackable() ? Template->GetMaxStackSize() : 1)) {
+			//One stack per class, so this can never be added whole
+			FailedText = FText::Format(LOCTEXT("StackTooLargeText", "Couldn't add all of %s, it's more than one stack holds."), Template->GetItemDisplayName());
+		} else if (Template->IsStackable()) {
+			int32* StackQuantity = ProjectedStackQuantities.Find(Template->GetClass());
+			if (!StackQuantity) {
+				int32 ExistingQuantity = 0;
+				if (FindStackQuantity(Template->GetClass(), ExistingQuantity)) {
+					StackQuantity = &ProjectedStackQuantities.Add(Template->GetClass(), ExistingQuantity);
+				}
+			}
+
+			if (StackQuantity && *StackQuantity > 0) {
+				if (*StackQuantity + Quantity > Template->GetMaxStackSize()) {
+					FailedText = FText::Format(LOCTEXT("StackFullText", "Couldn't add %s. Tried adding items to a stack that was full."), Template->GetItemDisplayName());
+				} else {
+					*StackQuantity += Quantity;
+				}
+			} else if (ProjectedStacks + 1 > GetCapacity()) {
+				FailedText = FText::Format(LOCTEXT("InventoryCapacityFullText", "Couldn't add %s to Inventory. Inventory is full."), Template->GetItemDisplayName());
+			} else {
+				++ProjectedStacks;
+				ProjectedStackQuantities.Add(Template->GetClass(), Quantity);
+			}
+		} else if (ProjectedStacks + 1 > GetCapacity()) {
+			FailedText = FText::Format(LOCTEXT("InventoryCapacityFullText", "Couldn't add %s to Inventory. Inventory is full."), Template->GetItemDisplayName());
+		} else {
+			++ProjectedStacks;
+		}
+
+		if (FailedText.IsEmpty()) {
+			if (Quantity > GetWeightMaxAddAmount(Template, WeightCapacity - ProjectedWeight)) {
+				FailedText = FText::Format(LOCTEXT("StackWeightFullText", "Couldn't add %s, too much weight."), Template->GetItemDisplayName());
+			} else {
+				ProjectedWeight += Quantity * Template->GetItemWeight();
+			}
+		}
+
+		if (!FailedText.IsEmpty()) {
+			FailedIndex = i;
+		}
+	}
+
+	if (FailedIndex == INDEX_NONE) {
+		return true;
+	}
+
+	OutResults.Reset();
+	for (int32 i = 0; i < Requests.Num(); ++i) {
+		OutResults.Add(FItemAddResult::AddedNone(Requests[i].Quantity, i == FailedIndex ? FailedText : LOCTEXT("BatchNotAddedText", "Nothing was added because another item didn't fit.")));
+	}
+
+	return false;
+}
+
+bool UInventoryComponent::CanRemoveAll(const TArray<FInventoryItemRequest>& Requests) const {
+	TMap<const UItem*, int32> RequestedPerItem;
+	TMap<const UClass*, int32> RequestedPerClass;
+
+	for (const FInventoryItemRequest& RequestOrView : Requests) {
+		const FInventoryItemRequest Request = ResolveStackView(RequestOrView);
+		if (Request.Item) {
+			if (!ItemIndex.Contains(Request.Item)) {
+				return false;
+			}
+
+			RequestedPerItem.FindOrAdd(Request.Item) += Request.Quantity;
+			RequestedPerClass.FindOrAdd(Request.Item->GetClass()) += Request.Quantity;
+		} else if (Request.ItemClass) {
+			RequestedPerClass.FindOrAdd(Request.ItemClass) += Request.Quantity;
+		} else {
+			return false;
+		}
+	}
+
+	for (auto& Requested : RequestedPerItem) {
+		if (Requested.Key->GetQuantity() < Requested.Value) {
+			return false;
+		}
+	}
+
+	for (auto& Requested : RequestedPerClass) {
+		int32 Available = 0;
+		ItemIndex.FindCompactStack(Requested.Key, Available);
+
+		for (const UItem* Item : ItemIndex.FindAllOfClass(Requested.Key)) {
+			if (Item->GetClass() == Requested.Key) {
+				Available += Item->GetQuantity();
+			}
+		}
+
+		if (Available < Requested.Value) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void UInventoryComponent::BeginBatchUpdate() {
+	++BatchDepth;
+}
+
+void UInventoryComponent::EndBatchUpdate() {
+	if (ensure(BatchDepth > 0) && --BatchDepth == 0) {
+		FlushItemsKey();
+
+		if (bPendingInventoryUpdate || bPendingClientRefresh) {
+			ScheduleNotificationFlush();
+		}
+	}
+}
+
+void UInventoryComponent::NotifyInventoryChanged(const EInventoryChangeType ChangeType, UItem* Item /*= nullptr*/, TSubclassOf<UItem> ItemClass /*= nullptr*/) {
+	PendingChanges.Record(ChangeType, Item, ItemClass);
+	++NotificationCounters.NotificationsRequested;
+	bPendingInventoryUpdate = true;
+
+	if (BatchDepth == 0) {
+		ScheduleNotificationFlush();
+	}
+}
+
+void UInventoryComponent::RequestClientRefresh(TSubclassOf<UItem> ItemClass) {
+	if (ItemClass) {
+		PendingChanges.ChangedClasses.AddUnique(ItemClass);
+	}
+	++NotificationCounters.ClientRefreshesRequested;
+	bPendingClientRefresh = true;
+
+	if (BatchDepth == 0) {
+		ScheduleNotificationFlush();
+	}
+}
+
+void UInventoryComponent::MarkItemsKeyDirty() {
+	bPendingItemsKeyBump = true;
+
+	//Bumping the key is cheap and the net driver only looks at it once per frame, so there is no reason to hold it back
+	if (BatchDepth == 0) {
+		FlushItemsKey();
+	}
+}
+
+void UInventoryComponent::FlushItemsKey() {
+	if (bPendingItemsKeyBump) {
+		bPendingItemsKeyBump = false;
+		ReplicatedItemsKey++;
+	}
+}
+
+void UInventoryComponent::ScheduleNotificationFlush() {
+	//Nothing ticks before BeginPlay, so changes made while setting up still notify straight away
+	if (!HasBegunPlay()) {
+		FlushPendingNotifications();
+		return;
+	}
+
+	if (!IsComponentTickEnabled()) {
+		SetComponentTickInterval(NotificationInterval);
+		SetComponentTickEnabled(true);
+	}
+}
+
+void UInventoryComponent::FlushPendingNotifications() {
+	FlushItemsKey();
+
+	if (bPendingClientRefresh) {
+		bPendingClientRefresh = false;
+
+		//Delta replicated clients already refresh per entry and a structural change reaches legacy clients through OnRep_Items
+		if (!bUseDeltaReplication && !PendingChanges.HasStructuralChanges() && GetOwner() && GetOwner()->HasAuthority()) {
+			++NotificationCounters.ClientRefreshesSent;
+			INC_DWORD_STAT(STAT_InventoryClientRefreshesSent);
+			ClientRefreshInventory(PendingChanges.ChangedClasses);
+		}
+	}
+
+	if (bPendingInventoryUpdate) {
+		bPendingInventoryUpdate = false;
+
+		//Listeners may change the inventory again, which starts a fresh window instead of editing the summary being broadcast
+		FInventoryChangeSummary Changes = MoveTemp(PendingChanges);
+		PendingChanges.Reset();
+
+		//Before listeners run, so UI asking for thumbnails finds them already on their way
+		UpdateItemAssetRequests();
+
+		++NotificationCounters.NotificationsBroadcast;
+		INC_DWORD_STAT(STAT_InventoryNotificationsBroadcast);
+		INC_DWORD_STAT_BY(STAT_InventoryNotificationsCoalesced, FMath::Max(Changes.NumChanges - 1, 0));
+
+		OnInventoryUpdated.Broadcast();
+		OnInventoryChanged.Broadcast(Changes);
+	} else {
+		PendingChanges.Reset();
+	}
 }
 
 int32 UInventoryComponent::ConsumeItem(UItem* Item) {
@@ -36,6 +483,10 @@ int32 UInventoryComponent::ConsumeItem(UItem* Item) {
 }
 
 int32 UInventoryComponent::ConsumeItem(UItem* Item, const int32 Quantity) {
+	if (Item && Item->IsStackView()) {
+		return ConsumeItemOfClass(Item->GetClass(), Quantity);
+	}
+
 	if (GetOwner() && GetOwner()->HasAuthority() && Item) {
 		const int32 RemoveQuantity = FMath::Min(Quantity, Item->GetQuantity());
 
@@ -46,9 +497,10 @@ int32 UInventoryComponent::ConsumeItem(UItem* Item, const int32 Quantity) {
 		Item->SetQuantity(Item->GetQuantity() - RemoveQuantity);
 
 		if (Item->GetQuantity() <= 0) {
+			//Callers, UI and clients may still hold the item, so it's left to the garbage collector rather than reused
 			RemoveItem(Item);
 		} else {
-			ClientRefreshInventory();
+			RequestClientRefresh(Item->GetClass());
 		}
 
 		return RemoveQuantity;
@@ -57,15 +509,55 @@ int32 UInventoryComponent::ConsumeItem(UItem* Item, const int32 Quantity) {
 	return 0;
 }
 
+int32 UInventoryComponent::ConsumeItemOfClass(TSubclassOf<UItem> ItemClass, const int32 Quantity) {
+	if (GetOwner() && GetOwner()->HasAuthority()) {
+		int32 StackQuantity = 0;
+		if (ItemIndex.FindCompactStack(ItemClass, StackQuantity)) {
+			const int32 RemoveQuantity = FMath::Min(Quantity, StackQuantity);
+
+			if (StackQuantity - RemoveQuantity <= 0) {
+				RemoveCompactStack(ItemClass);
+			} else {
+				SetStackQuantity(ItemClass, StackQuantity - RemoveQuantity);
+				RequestClientRefresh(ItemClass);
+			}
+
+			return RemoveQuantity;
+		}
+
+		if (UItem* Item = ItemIndex.FindFirstOfClass(ItemClass)) {
+			return ConsumeItem(Item, Quantity);
+		}
+	}
+
+	return 0;
+}
+
 bool UInventoryComponent::RemoveItem(UItem* Item) {
 	if (GetOwner() && GetOwner()->HasAuthority()) {
+		int32 StackQuantity = 0;
+		if (Item && Item->IsStackView()) {
+			if (!ItemIndex.FindCompactStack(Item->GetClass(), StackQuantity)) {
+				return false;
+			}
+			RemoveCompactStack(Item->GetClass());
+			return true;
+		}
+
 		if (Item) {
 			Items.RemoveSingle(Item);
+			ItemIndex.RemoveItem(Item);
+			ItemViews.RemoveItem(Item);
+			PostItemIndexChanged();
 			OnItemRemoved.Broadcast(Item);
 
-			OnRep_Items();
+			NotifyInventoryChanged(EInventoryChangeType::ICT_Removed, Item);
 
-			ReplicatedItemsKey++;
+			if (bUseDeltaReplication) {
+				InventoryList.RemoveEntry(Item);
+			} else {
+				MarkItemsKeyDirty();
+			}
 
 			return true;
 		}
@@ -74,103 +566,428 @@ bool UInventoryComponent::RemoveItem(UItem* Item) {
 	return false;
 }
 
+void UInventoryComponent::CaptureSnapshot(FInventorySnapshot& OutSnapshot, TMap<const UItem*, int32>* OutStackIndices /*= nullptr*/) const {
+	OutSnapshot.Stacks.Reserve(OutSnapshot.Stacks.Num() + ItemIndex.Num());
+
+	for (const UItem* Item : Items) {
+		if (Item) {
+			const int32 StackIndex = OutSnapshot.AddStack(Item->GetClass(), Item->GetQuantity());
+			if (OutStackIndices) {
+				OutStackIndices->Add(Item, StackIndex);
+			}
+		}
+	}
+
+	for (auto& CompactStack : ItemIndex.GetCompactStacks()) {
+		OutSnapshot.AddStack(const_cast<UClass*>(CompactStack.Key), CompactStack.Value);
+	}
+}
+
+bool UInventoryComponent::RestoreSnapshot(const FInventorySnapshot& Snapshot, TArray<UItem*>* OutItems /*= nullptr*/) {
+	if (!GetOwner() || !GetOwner()->HasAuthority()) {
+		return false;
+	}
+
+	if (OutItems) {
+		OutItems->Reset();
+		OutItems->SetNumZeroed(Snapshot.Stacks.Num());
+	}
+
+	FInventoryBatchScope BatchScope(this);
+
+	for (UItem* Item : TArray<UItem*>(Items)) {
+		RemoveItem(Item);
+	}
+
+	TArray<const UClass*> CompactClasses;
+	ItemIndex.GetCompactStacks().GetKeys(CompactClasses);
+	for (const UClass* CompactClass : CompactClasses) {
+		RemoveCompactStack(const_cast<UClass*>(CompactClass));
+	}
+
+	//Resolve each definition once, the snapshot usually has several stacks per class
+	TArray<TSubclassOf<UItem>> ResolvedClasses;
+	ResolvedClasses.SetNum(Snapshot.Definitions.Num());
+	for (int32 i = 0; i < Snapshot.Definitions.Num(); ++i) {
+		ResolvedClasses[i] = Snapshot.ResolveDefinition(i);
+		if (!ResolvedClasses[i]) {
+			UE_LOG(LogTrust, Warning, TEXT("Inventory snapshot item %s no longer exists, dropping its stacks"), *Snapshot.Definitions[i].ToString());
+		}
+	}
+
+	bool bRestoredAll = true;
+	for (int32 i = 0; i < Snapshot.Stacks.Num(); ++i) {
+		const FInventorySnapshotStack& Stack = Snapshot.Stacks[i];
+		TSubclassOf<UItem> ItemClass = ResolvedClasses[Stack.DefinitionIndex];
+
+		if (Stack.Quantity <= 0) {
+			continue;
+		}
+
+		if (!ItemClass || GetNumStacks() >= GetCapacity()) {
+			bRestoredAll = false;
+			continue;
+		}
+
+		//Weight was already checked when the items were first added, only the stack limits are enforced again
+		const UItem* ItemCDO = ItemClass->GetDefaultObject<UItem>();
+		const int32 Quantity = FMath::Min(Stack.Quantity, ItemCDO->IsStackable() ? ItemCDO->GetMaxStackSize() : 1);
+
+		int32 ExistingCompactQuantity = 0;
+		if (UsesCompactStorage(ItemClass) && !ItemIndex.FindCompactStack(ItemClass, ExistingCompactQuantity)) {
+			AddCompactStack(ItemClass, Quantity);
+		} else if (UItem* NewItem = AddItem(ItemClass, Quantity)) {
+			if (OutItems) {
+				(*OutItems)[i] = NewItem;
+			}
+		}
+	}
+
+	return bRestoredAll;
+}
+
 bool UInventoryComponent::HasItem(TSubclassOf <UItem> ItemClass, const int32 Quantity /*= 1*/) const {
-	if (UItem* ItemToFind = FindItemByClass(ItemClass)) {
-		return ItemToFind->GetQuantity() >= Quantity;
+	int32 StackQuantity = 0;
+	if (FindStackQuantity(ItemClass, StackQuantity)) {
+		return StackQuantity >= Quantity;
 	}
 	return false;
 }
 
 UItem* UInventoryComponent::FindItem(UItem* Item) const {
 	if (Item) {
-		for (auto& InvItem : Items) {
-			if (InvItem && InvItem->GetClass() == Item->GetClass()) {
-				return InvItem;
-			}
-		}
+		return FindItemByClass(Item->GetClass());
 	}
 	return nullptr;
 }
 
 UItem* UInventoryComponent::FindItemByClass(TSubclassOf<UItem> ItemClass) const {
-	for (auto& InvItem : Items) {
-		if (InvItem && InvItem->GetClass() == ItemClass) {
-			return InvItem;
-		}
+	if (UItem* Item = ItemIndex.FindFirstOfClass(ItemClass)) {
+		return Item;
 	}
-	return nullptr;
+	return GetCompactStackView(ItemClass);
+}
+
+UItem* UInventoryComponent::FindOrMaterializeItemByClass(TSubclassOf<UItem> ItemClass) {
+	if (UItem* Item = ItemIndex.FindFirstOfClass(ItemClass)) {
+		return Item;
+	}
+	return MaterializeCompactStack(ItemClass);
 }
 
 TArray<UItem*> UInventoryComponent::FindItemsByClass(TSubclassOf<UItem> ItemClass) const {
-	TArray<UItem*> ItemsOfClass;
+	TArray<UItem*> FoundItems = ItemIndex.FindAllOfClass(ItemClass);
+	if (!ItemClass) {
+		return FoundItems;
+	}
+
+	for (auto& CompactStack : ItemIndex.GetCompactStacks()) {
+		if (CompactStack.Key->IsChildOf(ItemClass)) {
+			FoundItems.Add(GetCompactStackView(CompactStack.Key));
+		}
+	}
+	return FoundItems;
+}
+
+TArray<UItem*> UInventoryComponent::FindOrMaterializeItemsByClass(TSubclassOf<UItem> ItemClass) {
+	MaterializeCompactStacks(ItemClass);
+	return FindItemsByClass(ItemClass);
+}
+
+TArray<FInventoryItemRequest> UInventoryComponent::GetStacksOfClass(TSubclassOf<UItem> ItemClass) const {
+	TArray<FInventoryItemRequest> Stacks;
+	if (!ItemClass) {
+		return Stacks;
+	}
+
+	for (UItem* Item : ItemIndex.FindAllOfClass(ItemClass)) {
+		FInventoryItemRequest& Stack = Stacks.Emplace_GetRef(Item, Item->GetQuantity());
+		Stack.ItemClass = Item->GetClass();
+	}
+
+	for (auto& CompactStack : ItemIndex.GetCompactStacks()) {
+		if (CompactStack.Key->IsChildOf(ItemClass)) {
+			Stacks.Emplace(const_cast<UClass*>(CompactStack.Key), CompactStack.Value);
+		}
+	}
+	return Stacks;
+}
 
-	for (auto& InvItem : Items) {
-		if (InvItem && InvItem->GetClass()->IsChildOf(ItemClass)) {
-			ItemsOfClass.Add(InvItem);
+void UInventoryComponent::MaterializeCompactStacks(const UClass* ItemClass) {
+	if (ItemIndex.GetCompactStacks().Num() > 0) {
+		TArray<const UClass*> CompactClasses;
+		for (auto& CompactStack : ItemIndex.GetCompactStacks()) {
+			if (CompactStack.Key->IsChildOf(ItemClass)) {
+				CompactClasses.Add(CompactStack.Key);
+			}
+		}
+
+		for (const UClass* CompactClass : CompactClasses) {
+			MaterializeCompactStack(const_cast<UClass*>(CompactClass));
 		}
 	}
+}
+
+const TArray<UItem*>& UInventoryComponent::GetItemView(const EInventorySortMode SortMode, TSubclassOf<UItem> FilterClass /*= nullptr*/) const {
+	CreateCompactStackViews();
+	return ItemViews.GetView(SortMode, FilterClass, Items, CompactStackViews);
+}
+
+TArray<UItem*> UInventoryComponent::GetSortedItems(const EInventorySortMode SortMode, TSubclassOf<UItem> FilterClass) const {
+	return GetItemView(SortMode, FilterClass);
+}
 
-	return ItemsOfClass;
+void UInventoryComponent::RegisterItemView(const FName ViewName, const EInventorySortMode SortMode, TFunction<bool(const UItem*)> Filter) {
+	ItemViews.RegisterView(ViewName, SortMode, MoveTemp(Filter));
+}
+
+void UInventoryComponent::UnregisterItemView(const FName ViewName) {
+	ItemViews.UnregisterView(ViewName);
+}
+
+const TArray<UItem*>* UInventoryComponent::GetNamedItemView(const FName ViewName) const {
+	CreateCompactStackViews();
+	return ItemViews.GetNamedView(ViewName, Items, CompactStackViews);
+}
+
+TArray<UItem*> UInventoryComponent::GetInventoryItems() const {
+	return FindItemsByClass(UItem::StaticClass());
 }
 
 float UInventoryComponent::GetCurrentWeight() const {
-	float Weight = 0.f;
+	return ItemIndex.GetTotalWeight();
+}
 
-	for (auto& Item : Items) {
-		if (Item) {
-			Weight += Item->GetStackWeight();
+void UInventoryComponent::MarkDirtyForReplication() {
+	//With delta replication quantity changes travel in InventoryList, item subobjects only need sending when they are added
+	if (!bUseDeltaReplication) {
+		MarkItemsKeyDirty();
+	}
+}
+
+void UInventoryComponent::NotifyItemQuantityChanged(UItem* Item) {
+	if (Item->IsStackView()) {
+		//Replicated and server side stack changes reach the view already applied, anything else changed the view itself
+		int32 StackQuantity = 0;
+		if (GetOwner() && GetOwner()->HasAuthority() && ItemIndex.FindCompactStack(Item->GetClass(), StackQuantity) && StackQuantity != Item->GetQuantity()) {
+			SetStackQuantity(Item->GetClass(), Item->GetQuantity());
+		}
+		ItemViews.UpdateItemQuantity(Item);
+		return;
+	}
+
+	ItemIndex.UpdateItemQuantity(Item);
+	ItemViews.UpdateItemQuantity(Item);
+	PostItemIndexChanged();
+
+	if (bUseDeltaReplication && GetOwner() && GetOwner()->HasAuthority()) {
+		InventoryList.UpdateEntry(Item);
+	}
+
+	NotifyInventoryChanged(EInventoryChangeType::ICT_Changed, Item);
+}
+
+void UInventoryComponent::PostItemIndexChanged() const {
+#if !UE_BUILD_SHIPPING
+	if (CVarValidateInventoryIndex.GetValueOnGameThread() != 0) {
+		ValidateItemIndex();
+	}
+#endif
+}
+
+#if !UE_BUILD_SHIPPING
+bool UInventoryComponent::ValidateItemIndex() const {
+	TMap<const UClass*, int32> ExpectedCompactStacks;
+	if (bUseDeltaReplication) {
+		for (const FInventoryEntry& Entry : InventoryList.Entries) {
+			if (Entry.IsCompact()) {
+				ExpectedCompactStacks.Add(Entry.ItemClass, Entry.Quantity);
+			}
 		}
 	}
 
-	return Weight;
+	FString Error;
+	if (!ItemIndex.Validate(Items, ExpectedCompactStacks, Error)) {
+		UE_LOG(LogTrust, Error, TEXT("Inventory index out of sync on %s: %s"), *GetPathName(), *Error);
+		return false;
+	}
+	return true;
 }
+#endif
 
 void UInventoryComponent::SetWeightCapacity(const float NewWeightCapacity) {
 	WeightCapacity = NewWeightCapacity;
-	OnInventoryUpdated.Broadcast();
+	NotifyInventoryChanged(EInventoryChangeType::ICT_Capacity);
 }
 
 void UInventoryComponent::SetCapacity(const int32 NewCapacity) {
 	Capacity = NewCapacity;
-	OnInventoryUpdated.Broadcast();
+	NotifyInventoryChanged(EInventoryChangeType::ICT_Capacity);
+}
+
+void UInventoryComponent::ClientRefreshInventory_Implementation(const TArray<TSubclassOf<UItem>>& ChangedClasses) {
+	//A listen server already notified its own UI when the change happened
+	if (GetOwner() && GetOwner()->HasAuthority()) {
+		return;
+	}
+
+	for (TSubclassOf<UItem> ItemClass : ChangedClasses) {
+		ReconcilePredictedItems(ItemClass);
+		NotifyInventoryChanged(EInventoryChangeType::ICT_Changed, nullptr, ItemClass);
+	}
+}
+
+UItem* UInventoryComponent::AddPredictedItem(TSubclassOf<UItem> ItemClass, const int32 Quantity, const UObject* Source) {
+	if (!ItemClass || Quantity <= 0 || (GetOwner() && GetOwner()->HasAuthority())) {
+		return nullptr;
+	}
+
+	//Never owned by the inventory, so nothing about it reaches the server or the lookups
+	UItem* Item = NewInventoryItem(this, ItemClass);
+	Item->SetWorld(GetWorld());
+	Item->SetQuantityFromReplication(Quantity);
+
+	FPredictedInventoryItem& Predicted = PredictedItems.AddDefaulted_GetRef();
+	Predicted.Item = Item;
+	Predicted.Source = Source;
+	Predicted.PredictionId = ActivePredictionId;
+
+	NotifyInventoryChanged(EInventoryChangeType::ICT_Changed, nullptr, ItemClass);
+	return Item;
+}
+
+int32 UInventoryComponent::RemovePredictedItems(const UObject* Source) {
+	const int32 NumRemoved = PredictedItems.RemoveAll([Source](const FPredictedInventoryItem& Predicted) { return Predicted.Source == Source; });
+	if (NumRemoved > 0) {
+		NotifyInventoryChanged(EInventoryChangeType::ICT_Changed);
+	}
+	return NumRemoved;
 }
 
-void UInventoryComponent::ClientRefreshInventory_Implementation() {
-	OnInventoryUpdated.Broadcast();
+void UInventoryComponent::BeginPredictedItems(const uint16 PredictionId) {
+	ActivePredictionId = PredictionId;
+}
+
+void UInventoryComponent::EndPredictedItems() {
+	ActivePredictionId = 0;
+}
+
+void UInventoryComponent::ConfirmPredictedItems(const uint16 PredictionId) {
+	for (FPredictedInventoryItem& Predicted : PredictedItems) {
+		if (Predicted.PredictionId == PredictionId) {
+			Predicted.bConfirmed = true;
+		}
+	}
+}
+
+int32 UInventoryComponent::RemovePredictedItemsFor(const uint16 PredictionId) {
+	const int32 NumRemoved = PredictedItems.RemoveAll([PredictionId](const FPredictedInventoryItem& Predicted) { return Predicted.PredictionId == PredictionId; });
+	if (NumRemoved > 0) {
+		NotifyInventoryChanged(EInventoryChangeType::ICT_Changed);
+	}
+	return NumRemoved;
+}
+
+bool UInventoryComponent::HasPredictedItemsFor(const uint16 PredictionId) const {
+	return PredictedItems.ContainsByPredicate([PredictionId](const FPredictedInventoryItem& Predicted) { return Predicted.PredictionId == PredictionId; });
+}
+
+TArray<UItem*> UInventoryComponent::GetPredictedItems() const {
+	TArray<UItem*> Result;
+	for (const FPredictedInventoryItem& Predicted : PredictedItems) {
+		Result.Add(Predicted.Item);
+	}
+	return Result;
+}
+
+void UInventoryComponent::ReconcilePredictedItems(const UClass* ItemClass) {
+	if (PredictedItems.Num() == 0 || !ItemClass) {
+		return;
+	}
+
+	//Unconfirmed items may still be rejected, so a stack of the same class arriving says nothing about them
+	const int32 Index = PredictedItems.IndexOfByPredicate([ItemClass](const FPredictedInventoryItem& Predicted) { return Predicted.bConfirmed && Predicted.Item->GetClass() == ItemClass; });
+	if (Index != INDEX_NONE) {
+		PredictedItems.RemoveAt(Index);
+	}
+}
+
+void UInventoryComponent::UpdateItemAssetRequests() {
+	UItemStreamingSubsystem* Streaming = GetWorld() && !IsNetMode(NM_DedicatedServer) ? GetWorld()->GetSubsystem<UItemStreamingSubsystem>() : nullptr;
+	if (!Streaming) {
+		return;
+	}
+
+	TSet<const UClass*> HeldClasses;
+	for (const UItem* Item : Items) {
+		if (Item) {
+			HeldClasses.Add(Item->GetClass());
+		}
+	}
+	for (const TPair<const UClass*, int32>& CompactStack : ItemIndex.GetCompactStacks()) {
+		HeldClasses.Add(CompactStack.Key);
+	}
+	for (const FPredictedInventoryItem& Predicted : PredictedItems) {
+		HeldClasses.Add(Predicted.Item->GetClass());
+	}
+
+	for (const UClass* ItemClass : HeldClasses) {
+		if (!StreamedItemClasses.Contains(ItemClass)) {
+			Streaming->RequestItemAssets(const_cast<UClass*>(ItemClass), this, EItemAssetPriority::IAP_Prefetch);
+		}
+	}
+	for (const UClass* ItemClass : StreamedItemClasses) {
+		if (!HeldClasses.Contains(ItemClass)) {
+			Streaming->ReleaseItemAssets(const_cast<UClass*>(ItemClass), this);
+		}
+	}
+
+	StreamedItemClasses = MoveTemp(HeldClasses);
 }
 
 void UInventoryComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-	DOREPLIFETIME(UInventoryComponent, Items);
+	DOREPLIFETIME_CONDITION(UInventoryComponent, Items, COND_Custom);
+	DOREPLIFETIME_CONDITION(UInventoryComponent, InventoryList, COND_Custom);
+}
+
+void UInventoryComponent::PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker) {
+	Super::PreReplication(ChangedPropertyTracker);
+
+	DOREPLIFETIME_ACTIVE_OVERRIDE(UInventoryComponent, Items, !bUseDeltaReplication);
+	DOREPLIFETIME_ACTIVE_OVERRIDE(UInventoryComponent, InventoryList, bUseDeltaReplication);
 }
 
 bool UInventoryComponent::ReplicateSubobjects(UActorChannel *Channel, FOutBunch *Bunch, FReplicationFlags *RepFlags) {
+	SCOPE_CYCLE_COUNTER(STAT_InventoryReplicateSubobjects);
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+
 	bool bWroteSomething = Super::ReplicateSubobjects(Channel, Bunch, RepFlags);
 
 	//Check if the array of items needs to replicate
 	if (Channel->KeyNeedsToReplicate(0, ReplicatedItemsKey)) {
 		for (auto& Item : Items) {
 			if (Channel->KeyNeedsToReplicate(Item->GetUniqueID(), Item->GetRepKey())) {
+				//Subobjects get no PreReplication call of their own, the actor only does that for itself and its components
+				const TSharedPtr<FRepChangedPropertyTracker> ChangedPropertyTracker = Channel->Connection->Driver->FindOrCreateRepChangedPropertyTracker(Item);
+				if (ChangedPropertyTracker.IsValid()) {
+					Item->PreReplication(*ChangedPropertyTracker);
+				}
 				bWroteSomething |= Channel->ReplicateSubobject(Item, *Bunch, *RepFlags);
 			}
 		}
 	}
 
+	ReplicateSubobjectsCycles += FPlatformTime::Cycles64() - StartCycles;
 	return bWroteSomething;
 }
 
-UItem* UInventoryComponent::AddItem(UItem* Item, const int32 Quantity) {
+UItem* UInventoryComponent::AddItem(TSubclassOf<UItem> ItemClass, const int32 Quantity) {
 	if (GetOwner() && GetOwner()->HasAuthority()) {
-		UItem* NewItem = NewObject<UItem>(GetOwner(), Item->GetClass());
-		NewItem->SetWorld(GetWorld());
+		UItem* NewItem = NewInventoryItem(GetOwner(), ItemClass);
 		NewItem->SetQuantity(Quantity);
-		NewItem->SetOwningInventory(this);
-		NewItem->AddToInventory(this);
-		Items.Add(NewItem);
-		NewItem->MarkDirtyForReplication();
-		OnItemAdded.Broadcast(NewItem);
-		OnRep_Items();
+		AttachItem(NewItem);
 
 		return NewItem;
 	}
@@ -178,72 +995,581 @@ UItem* UInventoryComponent::AddItem(UItem* Item, const int32 Quantity) {
 	return nullptr;
 }
 
+uint64 UInventoryComponent::NumItemsAllocated = 0;
+
+UItem* UInventoryComponent::NewInventoryItem(UObject* Outer, TSubclassOf<UItem> ItemClass) {
+	++NumItemsAllocated;
+	INC_DWORD_STAT(STAT_ItemsAllocated);
+	return NewObject<UItem>(Outer, ItemClass);
+}
+
+void UInventoryComponent::AttachItem(UItem* Item) {
+	//Items are always outered to the actor holding them, so they go away with it
+	if (Item->GetOuter() != GetOwner()) {
+		Item->Rename(nullptr, GetOwner(), REN_DontCreateRedirectors | REN_DoNotDirty | REN_ForceNoResetLoaders);
+	}
+
+	Item->SetWorld(GetWorld());
+	Item->SetOwningInventory(this);
+	Item->AddToInventory(this);
+	Items.Add(Item);
+	ItemIndex.AddItem(Item);
+	ItemViews.AddItem(Item);
+	PostItemIndexChanged();
+	Item->MarkDirtyForReplication();
+
+	if (bUseDeltaReplication) {
+		InventoryList.AddEntry(Item);
+		//New items still need their subobject sent once so the entry can resolve it
+		MarkItemsKeyDirty();
+	}
+	OnItemAdded.Broadcast(Item);
+	NotifyInventoryChanged(EInventoryChangeType::ICT_Added, Item);
+}
+
+int32 UInventoryComponent::ReceiveItem(UItem* Item, UInventoryComponent* Source) {
+	int32 ExistingQuantity = 0;
+	if ((Item->IsStackable() && FindStackQuantity(Item->GetClass(), ExistingQuantity)) || UsesCompactStorage(Item->GetClass())) {
+		//Merging into our own stack, the incoming object is only needed again if some of it didn't fit
+		const int32 Quantity = Item->GetQuantity();
+		const int32 QuantityAdded = TryAddItem_Internal(Item, Quantity).AmountGiven;
+		if (QuantityAdded < Quantity && Source) {
+			Source->AttachItem(Item);
+			Item->SetQuantity(Quantity - QuantityAdded);
+		}
+		return QuantityAdded;
+	}
+
+	AttachItem(Item);
+	return Item->GetQuantity();
+}
+
+void UInventoryComponent::TakeItemsForTrade(const TArray<FInventoryItemRequest>& Offer, TArray<UItem*>& OutItems, TArray<FInventoryItemRequest>& OutQuantities) {
+	for (const FInventoryItemRequest& RequestOrView : Offer) {
+		const FInventoryItemRequest Request = ResolveStackView(RequestOrView);
+		if (Request.Item) {
+			if (Request.Quantity >= Request.Item->GetQuantity() && RemoveItem(Request.Item)) {
+				OutItems.Add(Request.Item);
+			} else {
+				OutQuantities.Emplace(Request.Item->GetClass(), ConsumeItem(Request.Item, Request.Quantity));
+			}
+		} else {
+			OutQuantities.Emplace(Request.ItemClass, ConsumeItemOfClass(Request.ItemClass, Request.Quantity));
+		}
+	}
+}
+
+int32 UInventoryComponent::TransferItem(UItem* Item, UInventoryComponent* Destination, const int32 Quantity) {
+	if (Item && Item->IsStackView()) {
+		return TransferItems({ FInventoryItemRequest(Item->GetClass(), Quantity) }, Destination, false)[0];
+	}
+
+	if (!GetOwner() || !GetOwner()->HasAuthority() || !Item || !Destination || Destination == this || !ItemIndex.Contains(Item)) {
+		return 0;
+	}
+
+	const int32 TransferQuantity = FMath::Min(Quantity, Item->GetQuantity());
+	if (TransferQuantity <= 0) {
+		return 0;
+	}
+
+	FInventoryBatchScope SourceScope(this);
+	FInventoryBatchScope DestinationScope(Destination);
+
+	TArray<FItemAddResult> Results;
+	if (TransferQuantity == Item->GetQuantity() && Destination->CanAddAll({ FInventoryItemRequest(Item, TransferQuantity) }, Results)) {
+		RemoveItem(Item);
+		return Destination->ReceiveItem(Item, this);
+	}
+
+	//Only part of the stack is moving or fits, so the destination gets the quantity on a stack of its own
+	const int32 QuantityMoved = Destination->TryAddItem_Internal(Item, TransferQuantity).AmountGiven;
+	if (QuantityMoved > 0) {
+		ConsumeItem(Item, QuantityMoved);
+	}
+	return QuantityMoved;
+}
+
+TArray<int32> UInventoryComponent::TransferItems(const TArray<FInventoryItemRequest>& Requests, UInventoryComponent* Destination, const bool bAllOrNothing /*= true*/) {
+	TArray<int32> MovedQuantities;
+	MovedQuantities.SetNumZeroed(Requests.Num());
+
+	if (!GetOwner() || !GetOwner()->HasAuthority() || !Destination || Destination == this) {
+		return MovedQuantities;
+	}
+
+	if (bAllOrNothing) {
+		TArray<FItemAddResult> Results;
+		if (!CanRemoveAll(Requests) || !Destination->CanAddAll(Requests, Results)) {
+			return MovedQuantities;
+		}
+	}
+
+	FInventoryBatchScope SourceScope(this);
+	FInventoryBatchScope DestinationScope(Destination);
+
+	for (int32 i = 0; i < Requests.Num(); ++i) {
+		const FInventoryItemRequest Request = ResolveStackView(Requests[i]);
+
+		UItem* Item = Request.Item ? Request.Item : ItemIndex.FindFirstOfClass(Request.ItemClass);
+		if (Item) {
+			MovedQuantities[i] = TransferItem(Item, Destination, Request.Quantity);
+		} else if (Request.ItemClass) {
+			//Compact stack, only a quantity has to move
+			int32 StackQuantity = 0;
+			if (ItemIndex.FindCompactStack(Request.ItemClass, StackQuantity)) {
+				const UItem* ItemCDO = Request.ItemClass->GetDefaultObject<UItem>();
+				const int32 QuantityMoved = Destination->TryAddItem_Internal(ItemCDO, FMath::Min(Request.Quantity, StackQuantity)).AmountGiven;
+				MovedQuantities[i] = QuantityMoved > 0 ? ConsumeItemOfClass(Request.ItemClass, QuantityMoved) : 0;
+			}
+		}
+	}
+
+	return MovedQuantities;
+}
+
+bool UInventoryComponent::CommitTrade(UInventoryComponent* InventoryA, const TArray<FInventoryItemRequest>& OfferA, UInventoryComponent* InventoryB, const TArray<FInventoryItemRequest>& OfferB, FText& OutErrorText) {
+	if (!InventoryA || !InventoryB || InventoryA == InventoryB || !InventoryA->GetOwner() || !InventoryA->GetOwner()->HasAuthority()) {
+		OutErrorText = LOCTEXT("TradeInvalidText", "Trade is not valid.");
+		return false;
+	}
+
+	if (!InventoryA->CanRemoveAll(OfferA) || !InventoryB->CanRemoveAll(OfferB)) {
+		OutErrorText = LOCTEXT("TradeMissingItemsText", "One side no longer has the items it offered.");
+		return false;
+	}
+
+	//Each side has to fit what it receives once what it gives away is gone
+	TArray<FItemAddResult> Results;
+	if (!InventoryB->CanAddAll(OfferA, Results, &OfferB) || !InventoryA->CanAddAll(OfferB, Results, &OfferA)) {
+		const FItemAddResult* Failed = Results.FindByPredicate([](const FItemAddResult& Result) { return Result.AmountGiven == 0 && !Result.ErrorText.IsEmpty(); });
+		OutErrorText = Failed ? Failed->ErrorText : LOCTEXT("TradeNoRoomText", "Not enough room to complete the trade.");
+		return false;
+	}
+
+	FInventoryBatchScope ScopeA(InventoryA);
+	FInventoryBatchScope ScopeB(InventoryB);
+
+	//Take both offers out before adding anything, so the freed space is there when the other side's items arrive
+	TArray<UItem*> ItemsFromA, ItemsFromB;
+	TArray<FInventoryItemRequest> QuantitiesFromA, QuantitiesFromB;
+	InventoryA->TakeItemsForTrade(OfferA, ItemsFromA, QuantitiesFromA);
+	InventoryB->TakeItemsForTrade(OfferB, ItemsFromB, QuantitiesFromB);
+
+	//Whole items are given back by object, so remember how much each held when it left
+	TArray<int32> ItemQuantitiesFromA, ItemQuantitiesFromB;
+	for (const UItem* Item : ItemsFromA) {
+		ItemQuantitiesFromA.Add(Item->GetQuantity());
+	}
+	for (const UItem* Item : ItemsFromB) {
+		ItemQuantitiesFromB.Add(Item->GetQuantity());
+	}
+
+	//Everything that arrived somewhere, so a trade that doesn't fully apply can be taken back out
+	struct FTradeDelivery {
+		UInventoryComponent* Destination;
+		TSubclassOf<UItem> ItemClass;
+		//Set when the object itself moved, otherwise Quantity was merged into the destination's stacks
+		UItem* AttachedItem;
+		int32 Quantity;
+	};
+	TArray<FTradeDelivery> Deliveries;
+
+	auto GiveTo = [&Deliveries](UInventoryComponent* Destination, UInventoryComponent* Source, const TArray<UItem*>& MovedItems, const TArray<int32>& MovedItemQuantities, const TArray<FInventoryItemRequest>& MovedQuantities) {
+		bool bGaveAll = true;
+		for (int32 i = 0; i < MovedItems.Num(); ++i) {
+			UItem* Item = MovedItems[i];
+			const int32 QuantityGiven = Destination->ReceiveItem(Item, Source);
+			Deliveries.Add({ Destination, Item->GetClass(), Destination->ContainsItem(Item) ? Item : nullptr, QuantityGiven });
+			bGaveAll &= QuantityGiven == MovedItemQuantities[i];
+		}
+
+		for (const FInventoryItemRequest& Moved : MovedQuantities) {
+			if (Moved.ItemClass && Moved.Quantity > 0) {
+				const int32 QuantityGiven = Destination->TryAddItem_Internal(Moved.ItemClass->GetDefaultObject<UItem>(), Moved.Quantity).AmountGiven;
+				Deliveries.Add({ Destination, Moved.ItemClass, nullptr, QuantityGiven });
+				bGaveAll &= QuantityGiven == Moved.Quantity;
+			}
+		}
+		return bGaveAll;
+	};
+
+	const bool bGaveAllFromA = GiveTo(InventoryB, InventoryA, ItemsFromA, ItemQuantitiesFromA, QuantitiesFromA);
+	const bool bGaveAllFromB = GiveTo(InventoryA, InventoryB, ItemsFromB, ItemQuantitiesFromB, QuantitiesFromB);
+	if (bGaveAllFromA && bGaveAllFromB) {
+		return true;
+	}
+
+	//Validation and application disagreed, so put both inventories back the way they were rather than leave half a trade
+	UE_LOG(LogTrust, Warning, TEXT("Trade between %s and %s validated but didn't fully apply, rolling it back"), *GetNameSafe(InventoryA->GetOwner()), *GetNameSafe(InventoryB->GetOwner()));
+
+	for (const FTradeDelivery& Delivery : Deliveries) {
+		if (Delivery.AttachedItem) {
+			Delivery.Destination->RemoveItem(Delivery.AttachedItem);
+		} else {
+			//A merged quantity can span several stacks, ConsumeItemOfClass only takes from one at a time
+			int32 QuantityLeft = Delivery.Quantity;
+			while (QuantityLeft > 0) {
+				const int32 QuantityTaken = Delivery.Destination->ConsumeItemOfClass(Delivery.ItemClass, QuantityLeft);
+				if (QuantityTaken <= 0) {
+					break;
+				}
+				QuantityLeft -= QuantityTaken;
+			}
+		}
+	}
+
+	auto GiveBack = [](UInventoryComponent* Source, const TArray<UItem*>& MovedItems, const TArray<int32>& MovedItemQuantities, const TArray<FInventoryItemRequest>& MovedQuantities) {
+		for (int32 i = 0; i < MovedItems.Num(); ++i) {
+			//A partly merged item already went back to Source holding the remainder
+			if (!Source->ContainsItem(MovedItems[i])) {
+				Source->AttachItem(MovedItems[i]);
+			}
+			MovedItems[i]->SetQuantity(MovedItemQuantities[i]);
+		}
+
+		for (const FInventoryItemRequest& Moved : MovedQuantities) {
+			if (Moved.ItemClass && Moved.Quantity > 0) {
+				Source->TryAddItem_Internal(Moved.ItemClass->GetDefaultObject<UItem>(), Moved.Quantity);
+			}
+		}
+	};
+
+	GiveBack(InventoryA, ItemsFromA, ItemQuantitiesFromA, QuantitiesFromA);
+	GiveBack(InventoryB, ItemsFromB, ItemQuantitiesFromB, QuantitiesFromB);
+
+	OutErrorText = LOCTEXT("TradeNoRoomText", "Not enough room to complete the trade.");
+	return false;
+}
+
 void UInventoryComponent::OnRep_Items() {
-	OnInventoryUpdated.Broadcast();
+	//Clients only see the final array, so rebuild the lookups from it rather than diffing
+	ItemIndex.Rebuild(Items);
+	ItemViews.Rebuild(Items, CompactStackViews);
+
+	for (auto& Item : Items) {
+		if (Item) {
+			Item->SetOwningInventory(this);
+		}
+	}
 
 	for (auto& Item : Items) {
 		//On the client the world won't be set initially, so it set if not
 		if (Item && !Item->GetWorld()) {
 			OnItemAdded.Broadcast(Item);
 			Item->SetWorld(GetWorld());
+			ReconcilePredictedItems(Item->GetClass());
+			NotifyInventoryChanged(EInventoryChangeType::ICT_Added, Item);
+		}
+	}
+
+	for (auto& Item : ClientLastReceivedItems) {
+		if (Item && !Items.Contains(Item)) {
+			NotifyInventoryChanged(EInventoryChangeType::ICT_Removed, Item);
+		}
+	}
+
+	//A reorder or a late resolving reference still needs the UI to refresh
+	if (!bPendingInventoryUpdate) {
+		NotifyInventoryChanged(EInventoryChangeType::ICT_Changed);
+	}
+
+	ClientLastReceivedItems = Items;
+}
+
+bool UInventoryComponent::UsesCompactStorage(TSubclassOf<UItem> ItemClass) const {
+	//Compact stacks only exist in InventoryList, so they need delta replication to reach clients
+	return bUseDeltaReplication && ItemClass && ItemClass->GetDefaultObject<UItem>()->UsesCompactStorage();
+}
+
+bool UInventoryComponent::FindStackQuantity(TSubclassOf<UItem> ItemClass, int32& OutQuantity) const {
+	if (UItem* Item = ItemIndex.FindFirstOfClass(ItemClass)) {
+		OutQuantity = Item->GetQuantity();
+		return true;
+	}
+	return ItemIndex.FindCompactStack(ItemClass, OutQuantity);
+}
+
+void UInventoryComponent::SetStackQuantity(TSubclassOf<UItem> ItemClass, const int32 NewQuantity) {
+	if (UItem* Item = ItemIndex.FindFirstOfClass(ItemClass)) {
+		Item->SetQuantity(NewQuantity);
+	} else {
+		const UItem* ItemCDO = ItemClass->GetDefaultObject<UItem>();
+		const int32 ClampedQuantity = FMath::Clamp(NewQuantity, 0, ItemCDO->GetMaxStackSize());
+
+		ItemIndex.SetCompactStackQuantity(ItemClass, ClampedQuantity);
+		InventoryList.UpdateCompactEntry(ItemClass, ClampedQuantity);
+		PostItemIndexChanged();
+
+		if (UItem* View = FindCompactStackView(ItemClass)) {
+			View->SetQuantityFromReplication(ClampedQuantity);
 		}
+
+		NotifyInventoryChanged(EInventoryChangeType::ICT_Changed, nullptr, ItemClass);
+	}
+}
+
+void UInventoryComponent::AddCompactStack(TSubclassOf<UItem> ItemClass, const int32 Quantity) {
+	if (GetOwner() && GetOwner()->HasAuthority()) {
+		ItemIndex.AddCompactStack(ItemClass, Quantity);
+		InventoryList.AddCompactEntry(ItemClass, Quantity);
+		PostItemIndexChanged();
+		OnCompactStackAdded.Broadcast(ItemClass);
+
+		NotifyInventoryChanged(EInventoryChangeType::ICT_Added, nullptr, ItemClass);
 	}
 }
 
-FItemAddResult UInventoryComponent::TryAddItem_Internal(UItem* Item) {
+void UInventoryComponent::RemoveCompactStack(TSubclassOf<UItem> ItemClass) {
 	if (GetOwner() && GetOwner()->HasAuthority()) {
-		if (Item->IsStackable()) {
-			//Somehow the items quantity went over the max stack size. This shouldn't ever happen
-			ensure(Item->GetQuantity() <= Item->GetMaxStackSize());
+		ReleaseCompactStackView(ItemClass);
+		ItemIndex.RemoveCompactStack(ItemClass);
+		InventoryList.RemoveCompactEntry(ItemClass);
+		PostItemIndexChanged();
+		OnCompactStackRemoved.Broadcast(ItemClass);
+
+		NotifyInventoryChanged(EInventoryChangeType::ICT_Removed, nullptr, ItemClass);
+	}
+}
+
+UItem* UInventoryComponent::MaterializeCompactStack(TSubclassOf<UItem> ItemClass) {
+	//Only the server can give the stack a replicated item, clients keep showing the view
+	if (!GetOwner() || !GetOwner()->HasAuthority()) {
+		return GetCompactStackView(ItemClass);
+	}
+
+	int32 Quantity = 0;
+	if (!ItemIndex.FindCompactStack(ItemClass, Quantity)) {
+		return nullptr;
+	}
+
+	ReleaseCompactStackView(ItemClass);
+
+	UItem* NewItem = NewInventoryItem(GetOwner(), ItemClass);
+	NewItem->SetWorld(GetWorld());
+	NewItem->SetQuantity(Quantity);
+	NewItem->SetOwningInventory(this);
+
+	ItemIndex.RemoveCompactStack(ItemClass);
+	Items.Add(NewItem);
+	ItemIndex.AddItem(NewItem);
+	ItemViews.AddItem(NewItem);
+	PostItemIndexChanged();
 
-			if (UItem* ExistingItem = FindItem(Item)) {
-				if (ExistingItem->IsStackFull()) {
-					return FItemAddResult::AddedNone(Item->GetQuantity(), FText::Format(LOCTEXT("StackFullText", "Couldn't add %s. Tried adding items to a stack that was full."), Item->GetItemDisplayName()));
+	NewItem->AddToInventory(this);
+	InventoryList.PromoteCompactEntry(ItemClass, NewItem);
+	MarkItemsKeyDirty();
+
+	return NewItem;
+}
+
+void UInventoryComponent::RemoveClientCompactStack(TSubclassOf<UItem> ItemClass) {
+	ReleaseCompactStackView(ItemClass);
+
+	if (ItemIndex.GetCompactStacks().Contains(ItemClass.Get())) {
+		ItemIndex.RemoveCompactStack(ItemClass);
+		PostItemIndexChanged();
+		OnCompactStackRemoved.Broadcast(ItemClass);
+	}
+}
+
+UItem* UInventoryComponent::GetCompactStackView(const UClass* ItemClass) const {
+	int32 Quantity = 0;
+	if (!ItemIndex.FindCompactStack(ItemClass, Quantity)) {
+		return nullptr;
+	}
+
+	if (UItem* View = FindCompactStackView(ItemClass)) {
+		return View;
+	}
+
+	//Views are a cache over the compact stacks, creating one changes nothing a caller of a const lookup could see
+	UInventoryComponent* MutableThis = const_cast<UInventoryComponent*>(this);
+	UItem* View = NewInventoryItem(MutableThis, const_cast<UClass*>(ItemClass));
+	View->MarkAsStackView();
+	View->SetWorld(GetWorld());
+	View->SetQuantity(Quantity);
+	View->SetOwningInventory(MutableThis);
+
+	MutableThis->CompactStackViews.Add(View);
+	ItemViews.AddItem(View);
+	return View;
+}
+
+UItem* UInventoryComponent::FindCompactStackView(const UClass* ItemClass) const {
+	for (UItem* View : CompactStackViews) {
+		if (View->GetClass() == ItemClass) {
+			return View;
+		}
+	}
+	return nullptr;
+}
+
+void UInventoryComponent::CreateCompactStackViews() const {
+	if (CompactStackViews.Num() == ItemIndex.GetCompactStacks().Num()) {
+		return;
+	}
+
+	for (auto& CompactStack : ItemIndex.GetCompactStacks()) {
+		GetCompactStackView(CompactStack.Key);
+	}
+}
+
+void UInventoryComponent::ReleaseCompactStackView(const UClass* ItemClass) {
+	const int32 ViewIndex = CompactStackViews.IndexOfByPredicate([ItemClass](const UItem* View) { return View->GetClass() == ItemClass; });
+	if (ViewIndex == INDEX_NONE) {
+		return;
+	}
+
+	UItem* View = CompactStackViews[ViewIndex];
+	CompactStackViews.RemoveAtSwap(ViewIndex);
+	ItemViews.RemoveItem(View);
+	View->SetOwningInventory(nullptr);
+}
+
+void UInventoryComponent::OnEntryAdded(const FInventoryEntry& Entry) {
+	if (Entry.IsCompact()) {
+		ItemIndex.AddCompactStack(Entry.ItemClass, Entry.Quantity);
+		PostItemIndexChanged();
+		OnCompactStackAdded.Broadcast(Entry.ItemClass);
+		ReconcilePredictedItems(Entry.ItemClass);
+		NotifyInventoryChanged(EInventoryChangeType::ICT_Added, nullptr, Entry.ItemClass);
+		return;
+	}
+
+	UItem* Item = Entry.Item;
+
+	//The item subobject may not have arrived yet, OnEntryChanged picks it up once the reference resolves
+	if (!Item || ItemIndex.Contains(Item)) {
+		return;
+	}
+
+	Item->SetOwningInventory(this);
+	Item->SetWorld(GetWorld());
+	Item->SetQuantityFromReplication(Entry.Quantity);
+	Items.Add(Item);
+	ItemIndex.AddItem(Item);
+	ItemViews.AddItem(Item);
+	PostItemIndexChanged();
+
+	OnItemAdded.Broadcast(Item);
+	ReconcilePredictedItems(Entry.ItemClass);
+	NotifyInventoryChanged(EInventoryChangeType::ICT_Added, Item);
+}
+
+void UInventoryComponent::OnEntryChanged(const FInventoryEntry& Entry) {
+	if (Entry.IsCompact()) {
+		ItemIndex.SetCompactStackQuantity(Entry.ItemClass, Entry.Quantity);
+		PostItemIndexChanged();
+
+		if (UItem* View = FindCompactStackView(Entry.ItemClass)) {
+			View->SetQuantityFromReplication(Entry.Quantity);
+			OnItemChanged.Broadcast(View);
+		}
+
+		ReconcilePredictedItems(Entry.ItemClass);
+		NotifyInventoryChanged(EInventoryChangeType::ICT_Changed, nullptr, Entry.ItemClass);
+		return;
+	}
+
+	UItem* Item = Entry.Item;
+
+	if (!Item) {
+		return;
+	}
+
+	if (!ItemIndex.Contains(Item)) {
+		//Either the item reference just resolved or the server gave a compact stack a UItem, replace whatever stood in for it
+		RemoveClientCompactStack(Entry.ItemClass);
+		OnEntryAdded(Entry);
+		return;
+	}
+
+	Item->SetQuantityFromReplication(Entry.Quantity);
+
+	OnItemChanged.Broadcast(Item);
+	ReconcilePredictedItems(Entry.ItemClass);
+	NotifyInventoryChanged(EInventoryChangeType::ICT_Changed, Item);
+}
+
+void UInventoryComponent::OnEntryRemoved(const FInventoryEntry& Entry) {
+	if (Entry.IsCompact()) {
+		RemoveClientCompactStack(Entry.ItemClass);
+		NotifyInventoryChanged(EInventoryChangeType::ICT_Removed, nullptr, Entry.ItemClass);
+		return;
+	}
+
+	UItem* Item = Entry.Item;
+
+	if (!Item || !ItemIndex.Contains(Item)) {
+		return;
+	}
+
+	Items.RemoveSingle(Item);
+	ItemIndex.RemoveItem(Item);
+	ItemViews.RemoveItem(Item);
+	PostItemIndexChanged();
+
+	OnItemRemoved.Broadcast(Item);
+	NotifyInventoryChanged(EInventoryChangeType::ICT_Removed, Item);
+}
+
+FItemAddResult UInventoryComponent::TryAddItem_Internal(const UItem* Template, const int32 Quantity) {
+	if (GetOwner() && GetOwner()->HasAuthority()) {
+		if (Template->IsStackable()) {
+			//More than a stack holds adds what fits and reports the rest as not added
+			int32 ExistingQuantity = 0;
+			if (FindStackQuantity(Template->GetClass(), ExistingQuantity)) {
+				if (ExistingQuantity >= Template->GetMaxStackSize()) {
+					return FItemAddResult::AddedNone(Quantity, FText::Format(LOCTEXT("StackFullText", "Couldn't add %s. Tried adding items to a stack that was full."), Template->GetItemDisplayName()));
 				} else {
 					//Find the maximum amount of the item we could take due to weight
-					const int32 WeightMaxAddAmount = FMath::FloorToInt((WeightCapacity - GetCurrentWeight()) / Item->GetItemWeight());
-					const int32 QuantityMaxAddAmount = FMath::Min(ExistingItem->GetMaxStackSize() - ExistingItem->GetQuantity(), Item->GetQuantity());
+					const int32 WeightMaxAddAmount = GetWeightMaxAddAmount(Template, WeightCapacity - GetCurrentWeight());
+					const int32 QuantityMaxAddAmount = FMath::Min(Template->GetMaxStackSize() - ExistingQuantity, Quantity);
 					const int32 AddAmount = FMath::Min(WeightMaxAddAmount, QuantityMaxAddAmount);
 
 					if (AddAmount <= 0) {
 						//Already did full stack check, must not have enough weight
-						return FItemAddResult::AddedNone(Item->GetQuantity(), FText::Format(LOCTEXT("StackWeightFullText", "Couldn't add %s, too much weight."), Item->GetItemDisplayName()));
+						return FItemAddResult::AddedNone(Quantity, FText::Format(LOCTEXT("StackWeightFullText", "Couldn't add %s, too much weight."), Template->GetItemDisplayName()));
 					} else {
-						ExistingItem->SetQuantity(ExistingItem->GetQuantity() + AddAmount);
-						return AddAmount >= Item->GetQuantity() ? FItemAddResult::AddedAll(Item->GetQuantity()) : FItemAddResult::AddedSome(Item->GetQuantity(), AddAmount, LOCTEXT("StackAddedSomeFullText", "Couldn't add all of stack to inventory."));
+						SetStackQuantity(Template->GetClass(), ExistingQuantity + AddAmount);
+						return AddAmount >= Quantity ? FItemAddResult::AddedAll(Quantity) : FItemAddResult::AddedSome(Quantity, AddAmount, LOCTEXT("StackAddedSomeFullText", "Couldn't add all of stack to inventory."));
 					}
 				}
 			} else { //we want to add a stackable item that doesn't exist in the inventory
-				if (Items.Num() + 1 > GetCapacity()) {
-					return FItemAddResult::AddedNone(Item->GetQuantity(), FText::Format(LOCTEXT("InventoryCapacityFullText", "Couldn't add %s to Inventory. Inventory is full."), Item->GetItemDisplayName()));
+				if (GetNumStacks() + 1 > GetCapacity()) {
+					return FItemAddResult::AddedNone(Quantity, FText::Format(LOCTEXT("InventoryCapacityFullText", "Couldn't add %s to Inventory. Inventory is full."), Template->GetItemDisplayName()));
 				}
 				
-				const int32 WeightMaxAddAmount = FMath::FloorToInt((WeightCapacity - GetCurrentWeight()) / Item->GetItemWeight());
-				const int32 QuantityMaxAddAmount = FMath::Min(Item->GetMaxStackSize(), Item->GetQuantity());
+				const int32 WeightMaxAddAmount = GetWeightMaxAddAmount(Template, WeightCapacity - GetCurrentWeight());
+				const int32 QuantityMaxAddAmount = FMath::Min(Template->GetMaxStackSize(), Quantity);
 				const int32 AddAmount = FMath::Min(WeightMaxAddAmount, QuantityMaxAddAmount);
 
-				AddItem(Item, AddAmount);
+				if (WeightMaxAddAmount <= 0) {
+					return FItemAddResult::AddedNone(Quantity, FText::Format(LOCTEXT("StackWeightFullText", "Couldn't add %s, too much weight."), Template->GetItemDisplayName()));
+				}
+
+				if (UsesCompactStorage(Template->GetClass())) {
+					AddCompactStack(Template->GetClass(), AddAmount);
+				} else {
+					AddItem(Template->GetClass(), AddAmount);
+				}
 
-				return AddAmount >= Item->GetQuantity() ? FItemAddResult::AddedAll(Item->GetQuantity()) : FItemAddResult::AddedSome(Item->GetQuantity(), AddAmount, LOCTEXT("StackAddedSomeFullText", "Couldn't add all of stack to inventory."));
+				return AddAmount >= Quantity ? FItemAddResult::AddedAll(Quantity) : FItemAddResult::AddedSome(Quantity, AddAmount, LOCTEXT("StackAddedSomeFullText", "Couldn't add all of stack to inventory."));
 			}
 		} else { //item isnt stackable
-			if (Items.Num() + 1 > GetCapacity()) {
-				return FItemAddResult::AddedNone(Item->GetQuantity(), FText::Format(LOCTEXT("InventoryCapacityFullText", "Couldn't add %s to Inventory. Inventory is full."), Item->GetItemDisplayName()));
+			if (GetNumStacks() + 1 > GetCapacity()) {
+				return FItemAddResult::AddedNone(Quantity, FText::Format(LOCTEXT("InventoryCapacityFullText", "Couldn't add %s to Inventory. Inventory is full."), Template->GetItemDisplayName()));
 			}
 
-			//Items with a weight of zero dont require a weight check
-			if (!FMath::IsNearlyZero(Item->GetItemWeight())) {
-				if (GetCurrentWeight() + Item->GetItemWeight() > GetWeightCapacity()) {
-					return FItemAddResult::AddedNone(Item->GetQuantity(), FText::Format(LOCTEXT("StackWeightFullText", "Couldn't add %s, too much weight."), Item->GetItemDisplayName()));
-				}
+			if (GetWeightMaxAddAmount(Template, WeightCapacity - GetCurrentWeight()) < 1) {
+				return FItemAddResult::AddedNone(Quantity, FText::Format(LOCTEXT("StackWeightFullText", "Couldn't add %s, too much weight."), Template->GetItemDisplayName()));
 			}
 
-			//Non-stackables should always have a quantity of 1
-			ensure(Item->GetQuantity() == 1);
-
-			AddItem(Item, 1);
+			//Non-stackables only ever take one, asking for more is a partial add
+			AddItem(Template->GetClass(), 1);
 
-			return FItemAddResult::AddedAll(Item->GetQuantity());
+			return Quantity <= 1 ? FItemAddResult::AddedAll(1) : FItemAddResult::AddedSome(Quantity, 1, FText::Format(LOCTEXT("NotStackableAddedSomeText", "Only one %s could be added, it doesn't stack."), Template->GetItemDisplayName()));
 		}
 	}
 
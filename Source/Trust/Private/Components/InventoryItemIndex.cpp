@@ -0,0 +1,196 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Components/InventoryItemIndex.h"
+
+#include "Items/Item.h"
+
+void FInventoryItemIndex::Reset() {
+	ItemsByClass.Reset();
+	ItemsByAncestorClass.Reset();
+	AccountedQuantities.Reset();
+	CompactQuantities.Reset();
+	TotalWeight = 0.f;
+}
+
+void FInventoryItemIndex::Rebuild(const TArray<UItem*>& Items) {
+	//Compact stacks aren't part of Items, keep them as they are
+	TMap<const UClass*, int32> CompactStacks = MoveTemp(CompactQuantities);
+	Reset();
+
+	for (auto& CompactStack : CompactStacks) {
+		AddCompactStack(CompactStack.Key, CompactStack.Value);
+	}
+
+	for (auto& Item : Items) {
+		AddItem(Item);
+	}
+}
+
+void FInventoryItemIndex::AddItem(UItem* Item) {
+	if (!Item || AccountedQuantities.Contains(Item)) {
+		return;
+	}
+
+	ItemsByClass.FindOrAdd(Item->GetClass()).Add(Item);
+
+	//Register the stack under its whole class chain so child class queries are a single lookup
+	for (const UClass* Class = Item->GetClass(); Class; Class = Class->GetSuperClass()) {
+		ItemsByAncestorClass.FindOrAdd(Class).Add(Item);
+
+		if (Class == UItem::StaticClass()) {
+			break;
+		}
+	}
+
+	AccountedQuantities.Add(Item, Item->GetQuantity());
+	TotalWeight += Item->GetStackWeight();
+}
+
+void FInventoryItemIndex::RemoveItem(UItem* Item) {
+	int32 AccountedQuantity = 0;
+	if (!Item || !AccountedQuantities.RemoveAndCopyValue(Item, AccountedQuantity)) {
+		return;
+	}
+
+	if (TArray<UItem*>* ClassItems = ItemsByClass.Find(Item->GetClass())) {
+		ClassItems->RemoveSingle(Item);
+		if (ClassItems->Num() == 0) {
+			ItemsByClass.Remove(Item->GetClass());
+		}
+	}
+
+	for (const UClass* Class = Item->GetClass(); Class; Class = Class->GetSuperClass()) {
+		if (TArray<UItem*>* AncestorItems = ItemsByAncestorClass.Find(Class)) {
+			AncestorItems->RemoveSingle(Item);
+			if (AncestorItems->Num() == 0) {
+				ItemsByAncestorClass.Remove(Class);
+			}
+		}
+
+		if (Class == UItem::StaticClass()) {
+			break;
+		}
+	}
+
+	TotalWeight -= AccountedQuantity * Item->GetItemWeight();
+
+	//Don't let float error leave a tiny negative weight behind on an empty inventory
+	if (Num() == 0) {
+		TotalWeight = 0.f;
+	}
+}
+
+void FInventoryItemIndex::AddCompactStack(const UClass* ItemClass, const int32 Quantity) {
+	if (!ItemClass || CompactQuantities.Contains(ItemClass)) {
+		return;
+	}
+
+	CompactQuantities.Add(ItemClass, Quantity);
+	TotalWeight += Quantity * ItemClass->GetDefaultObject<UItem>()->GetItemWeight();
+}
+
+void FInventoryItemIndex::SetCompactStackQuantity(const UClass* ItemClass, const int32 Quantity) {
+	if (int32* AccountedQuantity = CompactQuantities.Find(ItemClass)) {
+		TotalWeight += (Quantity - *AccountedQuantity) * ItemClass->GetDefaultObject<UItem>()->GetItemWeight();
+		*AccountedQuantity = Quantity;
+	}
+}
+
+void FInventoryItemIndex::RemoveCompactStack(const UClass* ItemClass) {
+	int32 AccountedQuantity = 0;
+	if (CompactQuantities.RemoveAndCopyValue(ItemClass, AccountedQuantity)) {
+		TotalWeight -= AccountedQuantity * ItemClass->GetDefaultObject<UItem>()->GetItemWeight();
+
+		if (Num() == 0) {
+			TotalWeight = 0.f;
+		}
+	}
+}
+
+bool FInventoryItemIndex::FindCompactStack(const UClass* ItemClass, int32& OutQuantity) const {
+	if (const int32* Quantity = CompactQuantities.Find(ItemClass)) {
+		OutQuantity = *Quantity;
+		return true;
+	}
+	return false;
+}
+
+void FInventoryItemIndex::UpdateItemQuantity(UItem* Item) {
+	if (int32* AccountedQuantity = AccountedQuantities.Find(Item)) {
+		TotalWeight += (Item->GetQuantity() - *AccountedQuantity) * Item->GetItemWeight();
+		*AccountedQuantity = Item->GetQuantity();
+	}
+}
+
+UItem* FInventoryItemIndex::FindFirstOfClass(const UClass* ItemClass) const {
+	if (const TArray<UItem*>* ClassItems = ItemsByClass.Find(ItemClass)) {
+		return ClassItems->Num() > 0 ? (*ClassItems)[0] : nullptr;
+	}
+	return nullptr;
+}
+
+const TArray<UItem*>& FInventoryItemIndex::FindAllOfClass(const UClass* ItemClass) const {
+	static const TArray<UItem*> NoItems;
+
+	if (const TArray<UItem*>* AncestorItems = ItemsByAncestorClass.Find(ItemClass)) {
+		return *AncestorItems;
+	}
+	return NoItems;
+}
+
+bool FInventoryItemIndex::Validate(const TArray<UItem*>& Items, const TMap<const UClass*, int32>& ExpectedCompactStacks, FString& OutError) const {
+	float ExpectedWeight = 0.f;
+	int32 ExpectedNum = 0;
+
+	for (auto& Item : Items) {
+		if (!Item) {
+			continue;
+		}
+
+		++ExpectedNum;
+		ExpectedWeight += Item->GetStackWeight();
+
+		const int32* AccountedQuantity = AccountedQuantities.Find(Item);
+		if (!AccountedQuantity) {
+			OutError = FString::Printf(TEXT("%s is in the inventory but not in the index"), *GetNameSafe(Item));
+			return false;
+		}
+
+		if (*AccountedQuantity != Item->GetQuantity()) {
+			OutError = FString::Printf(TEXT("%s has quantity %d but the index has %d"), *GetNameSafe(Item), Item->GetQuantity(), *AccountedQuantity);
+			return false;
+		}
+
+		if (FindAllOfClass(UItem::StaticClass()).Find(Item) == INDEX_NONE || !ItemsByClass.Contains(Item->GetClass())) {
+			OutError = FString::Printf(TEXT("%s is missing from the class index"), *GetNameSafe(Item));
+			return false;
+		}
+	}
+
+	if (ExpectedNum != AccountedQuantities.Num()) {
+		OutError = FString::Printf(TEXT("Index tracks %d stacks, inventory has %d"), AccountedQuantities.Num(), ExpectedNum);
+		return false;
+	}
+
+	for (auto& CompactStack : ExpectedCompactStacks) {
+		const int32* AccountedQuantity = CompactQuantities.Find(CompactStack.Key);
+		if (!AccountedQuantity || *AccountedQuantity != CompactStack.Value) {
+			OutError = FString::Printf(TEXT("Compact stack of %s has quantity %d but the index has %d"), *GetNameSafe(CompactStack.Key), CompactStack.Value, AccountedQuantity ? *AccountedQuantity : 0);
+			return false;
+		}
+
+		ExpectedWeight += CompactStack.Value * CompactStack.Key->GetDefaultObject<UItem>()->GetItemWeight();
+	}
+
+	if (ExpectedCompactStacks.Num() != CompactQuantities.Num()) {
+		OutError = FString::Printf(TEXT("Index tracks %d compact stacks, inventory has %d"), CompactQuantities.Num(), ExpectedCompactStacks.Num());
+		return false;
+	}
+
+	if (!FMath::IsNearlyEqual(ExpectedWeight, TotalWeight, KINDA_SMALL_NUMBER * FMath::Max(1, ExpectedNum))) {
+		OutError = FString::Printf(TEXT("Index weight is %f, inventory weight is %f"), TotalWeight, ExpectedWeight);
+		return false;
+	}
+
+	return true;
+}
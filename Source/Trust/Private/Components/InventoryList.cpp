@@ -0,0 +1,90 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Components/InventoryList.h"
+
+#include "Components/InventoryComponent.h"
+#include "Items/Item.h"
+
+void FInventoryEntry::PreReplicatedRemove(const FInventoryList& InArraySerializer) {
+	if (InArraySerializer.OwnerComponent) {
+		InArraySerializer.OwnerComponent->OnEntryRemoved(*this);
+	}
+}
+
+void FInventoryEntry::PostReplicatedAdd(const FInventoryList& InArraySerializer) {
+	if (InArraySerializer.OwnerComponent) {
+		InArraySerializer.OwnerComponent->OnEntryAdded(*this);
+	}
+}
+
+void FInventoryEntry::PostReplicatedChange(const FInventoryList& InArraySerializer) {
+	if (InArraySerializer.OwnerComponent) {
+		InArraySerializer.OwnerComponent->OnEntryChanged(*this);
+	}
+}
+
+void FInventoryList::AddEntry(UItem* Item) {
+	if (Item && IndexOfItem(Item) == INDEX_NONE) {
+		FInventoryEntry& NewEntry = Entries.Emplace_GetRef(Item->GetClass(), Item, Item->GetQuantity(), EInventoryEntryFlags::None);
+		MarkItemDirty(NewEntry);
+	}
+}
+
+void FInventoryList::RemoveEntry(UItem* Item) {
+	const int32 EntryIndex = IndexOfItem(Item);
+	if (EntryIndex != INDEX_NONE) {
+		Entries.RemoveAt(EntryIndex);
+		MarkArrayDirty();
+	}
+}
+
+void FInventoryList::UpdateEntry(UItem* Item) {
+	const int32 EntryIndex = IndexOfItem(Item);
+	if (EntryIndex != INDEX_NONE && Entries[EntryIndex].Quantity != Item->GetQuantity()) {
+		Entries[EntryIndex].Quantity = Item->GetQuantity();
+		MarkItemDirty(Entries[EntryIndex]);
+	}
+}
+
+void FInventoryList::AddCompactEntry(TSubclassOf<UItem> ItemClass, const int32 Quantity) {
+	if (ItemClass && IndexOfCompactEntry(ItemClass) == INDEX_NONE) {
+		FInventoryEntry& NewEntry = Entries.Emplace_GetRef(ItemClass, nullptr, Quantity, EInventoryEntryFlags::Compact);
+		MarkItemDirty(NewEntry);
+	}
+}
+
+void FInventoryList::UpdateCompactEntry(TSubclassOf<UItem> ItemClass, const int32 Quantity) {
+	const int32 EntryIndex = IndexOfCompactEntry(ItemClass);
+	if (EntryIndex != INDEX_NONE && Entries[EntryIndex].Quantity != Quantity) {
+		Entries[EntryIndex].Quantity = Quantity;
+		MarkItemDirty(Entries[EntryIndex]);
+	}
+}
+
+void FInventoryList::RemoveCompactEntry(TSubclassOf<UItem> ItemClass) {
+	const int32 EntryIndex = IndexOfCompactEntry(ItemClass);
+	if (EntryIndex != INDEX_NONE) {
+		Entries.RemoveAt(EntryIndex);
+		MarkArrayDirty();
+	}
+}
+
+void FInventoryList::PromoteCompactEntry(TSubclassOf<UItem> ItemClass, UItem* Item) {
+	const int32 EntryIndex = IndexOfCompactEntry(ItemClass);
+	if (EntryIndex != INDEX_NONE && Item) {
+		FInventoryEntry& Entry = Entries[EntryIndex];
+		Entry.Item = Item;
+		Entry.Quantity = Item->GetQuantity();
+		Entry.Flags &= ~(uint8)EInventoryEntryFlags::Compact;
+		MarkItemDirty(Entry);
+	}
+}
+
+int32 FInventoryList::IndexOfItem(const UItem* Item) const {
+	//Pointer compare over at most Capacity entries, cheap enough that an extra map isn't worth keeping in sync
+	return Entries.IndexOfByPredicate([Item](const FInventoryEntry& Entry) { return Entry.Item == Item; });
+}
+
+int32 FInventoryList::IndexOfCompactEntry(const UClass* ItemClass) const {
+	return Entries.IndexOfByPredicate([ItemClass](const FInventoryEntry& Entry) { return Entry.IsCompact() && Entry.ItemClass == ItemClass; });
+}
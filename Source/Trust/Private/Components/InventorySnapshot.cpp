@@ -0,0 +1,258 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Components/InventorySnapshot.h"
+
+#include "Async/Async.h"
+#include "HAL/FileManager.h"
+#include "Items/Item.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "Templates/Atomic.h"
+#include "Trust/Trust.h"
+
+static const uint32 InventorySnapshotMagic = 0x564E4954; //TINV
+
+void FInventorySnapshot::Reset() {
+	Definitions.Reset();
+	Stacks.Reset();
+	Equipment.Reset();
+	DefinitionLookup.Reset();
+}
+
+int32 FInventorySnapshot::AddStack(TSubclassOf<UItem> ItemClass, const int32 Quantity) {
+	const FSoftClassPath Definition(ItemClass.Get());
+
+	int32 DefinitionIndex = INDEX_NONE;
+	if (const int32* ExistingIndex = DefinitionLookup.Find(Definition)) {
+		DefinitionIndex = *ExistingIndex;
+	} else {
+		DefinitionIndex = Definitions.Add(Definition);
+		DefinitionLookup.Add(Definition, DefinitionIndex);
+	}
+
+	FInventorySnapshotStack Stack;
+	Stack.DefinitionIndex = DefinitionIndex;
+	Stack.Quantity = Quantity;
+	return Stacks.Add(Stack);
+}
+
+void FInventorySnapshot::AddEquipment(const uint8 Slot, const int32 StackIndex) {
+	FInventorySnapshotEquipment Equipped;
+	Equipped.Slot = Slot;
+	Equipped.StackIndex = StackIndex;
+	Equipment.Add(Equipped);
+}
+
+TSubclassOf<UItem> FInventorySnapshot::ResolveDefinition(const int32 DefinitionIndex) const {
+	check(IsInGameThread());
+
+	if (Definitions.IsValidIndex(DefinitionIndex)) {
+		return Definitions[DefinitionIndex].TryLoadClass<UItem>();
+	}
+	return nullptr;
+}
+
+bool FInventorySnapshot::ToBytes(TArray<uint8>& OutBytes) const {
+	OutBytes.Reset();
+
+	FMemoryWriter Writer(OutBytes);
+	Writer << const_cast<FInventorySnapshot&>(*this);
+	return !Writer.IsError();
+}
+
+bool FInventorySnapshot::FromBytes(const TArray<uint8>& Bytes) {
+	Reset();
+
+	FMemoryReader Reader(Bytes);
+	Reader << *this;
+
+	if (Reader.IsError()) {
+		Reset();
+		return false;
+	}
+	return true;
+}
+
+bool FInventorySnapshot::operator==(const FInventorySnapshot& Other) const {
+	return Definitions == Other.Definitions && Stacks == Other.Stacks && Equipment == Other.Equipment;
+}
+
+//Reads a count and makes sure the rest of the archive could hold that many elements, so corrupt data can't trigger a huge allocation
+static bool SerializeCount(FArchive& Ar, int32& Count, const int32 MinBytesPerElement) {
+	uint32 PackedCount = (uint32)Count;
+	Ar.SerializeIntPacked(PackedCount);
+
+	if (Ar.IsLoading()) {
+		const int64 RemainingBytes = Ar.TotalSize() - Ar.Tell();
+		if (Ar.IsError() || (int64)PackedCount * MinBytesPerElement > RemainingBytes) {
+			Ar.SetError();
+			return false;
+		}
+		Count = (int32)PackedCount;
+	}
+	return true;
+}
+
+FArchive& operator<<(FArchive& Ar, FInventorySnapshot& Snapshot) {
+	uint32 Magic = InventorySnapshotMagic;
+	uint16 Version = (uint16)EInventorySnapshotVersion::Latest;
+	Ar << Magic;
+	Ar << Version;
+
+	if (Ar.IsLoading() && (Magic != InventorySnapshotMagic || Version == 0 || Version > (uint16)EInventorySnapshotVersion::Latest)) {
+		Ar.SetError();
+		return Ar;
+	}
+
+	int32 NumDefinitions = Snapshot.Definitions.Num();
+	if (!SerializeCount(Ar, NumDefinitions, sizeof(int32))) {
+		return Ar;
+	}
+	if (Ar.IsLoading()) {
+		Snapshot.Definitions.SetNum(NumDefinitions);
+	}
+
+	for (FSoftClassPath& Definition : Snapshot.Definitions) {
+		FString Path = Ar.IsSaving() ? Definition.ToString() : FString();
+		Ar << Path;
+
+		if (Ar.IsLoading()) {
+			Definition = FSoftClassPath(Path);
+		}
+	}
+
+	//Packed ints take at least a byte, so every stack is at least two
+	int32 NumStacks = Snapshot.Stacks.Num();
+	if (!SerializeCount(Ar, NumStacks, 2)) {
+		return Ar;
+	}
+	if (Ar.IsLoading()) {
+		Snapshot.Stacks.SetNum(NumStacks);
+	}
+
+	for (FInventorySnapshotStack& Stack : Snapshot.Stacks) {
+		uint32 DefinitionIndex = (uint32)Stack.DefinitionIndex;
+		uint32 Quantity = (uint32)FMath::Max(Stack.Quantity, 0);
+		Ar.SerializeIntPacked(DefinitionIndex);
+		Ar.SerializeIntPacked(Quantity);
+
+		if (Ar.IsLoading()) {
+			if (DefinitionIndex >= (uint32)NumDefinitions || Quantity > (uint32)MAX_int32) {
+				Ar.SetError();
+				return Ar;
+			}
+			Stack.DefinitionIndex = (int32)DefinitionIndex;
+			Stack.Quantity = (int32)Quantity;
+		}
+	}
+
+	int32 NumEquipment = Snapshot.Equipment.Num();
+	if (!SerializeCount(Ar, NumEquipment, 2)) {
+		return Ar;
+	}
+	if (Ar.IsLoading()) {
+		Snapshot.Equipment.SetNum(NumEquipment);
+	}
+
+	for (FInventorySnapshotEquipment& Equipped : Snapshot.Equipment) {
+		uint32 StackIndex = (uint32)Equipped.StackIndex;
+		Ar << Equipped.Slot;
+		Ar.SerializeIntPacked(StackIndex);
+
+		if (Ar.IsLoading()) {
+			if (StackIndex >= (uint32)NumStacks) {
+				Ar.SetError();
+				return Ar;
+			}
+			Equipped.StackIndex = (int32)StackIndex;
+		}
+	}
+
+	return Ar;
+}
+
+FString FInventorySnapshot::GetSavePath(const FString& SlotName) {
+	return FPaths::ProjectSavedDir() / TEXT("Inventories") / FPaths::MakeValidFileName(SlotName) + TEXT(".inv");
+}
+
+//Writes to one slot happen one at a time and in the order they were started, so an autosave that's slow to serialize
+//can't land on top of the logout save that came after it
+struct FInventorySnapshotSlotWrites {
+	FCriticalSection Lock;
+
+	uint64 LastWrittenSequence = 0;
+};
+
+static FCriticalSection InventorySnapshotSlotsLock;
+static TMap<FString, TSharedRef<FInventorySnapshotSlotWrites, ESPMode::ThreadSafe>> InventorySnapshotSlots;
+static TAtomic<uint64> InventorySnapshotSaveSequence(0);
+
+static TSharedRef<FInventorySnapshotSlotWrites, ESPMode::ThreadSafe> GetSlotWrites(const FString& Path) {
+	FScopeLock ScopeLock(&InventorySnapshotSlotsLock);
+
+	if (const TSharedRef<FInventorySnapshotSlotWrites, ESPMode::ThreadSafe>* Existing = InventorySnapshotSlots.Find(Path)) {
+		return *Existing;
+	}
+	return InventorySnapshotSlots.Add(Path, MakeShared<FInventorySnapshotSlotWrites, ESPMode::ThreadSafe>());
+}
+
+static FString GetTempSavePath(const FString& Path) {
+	return Path + TEXT(".tmp");
+}
+
+void FInventorySnapshot::SaveAsync(FInventorySnapshot&& Snapshot, const FString& SlotName, TFunction<void(bool)> OnComplete /*= nullptr*/) {
+	const uint64 Sequence = ++InventorySnapshotSaveSequence;
+
+	Async(EAsyncExecution::ThreadPool, [Snapshot = MoveTemp(Snapshot), Path = GetSavePath(SlotName), Sequence, OnComplete = MoveTemp(OnComplete)]() {
+		TArray<uint8> Bytes;
+		bool bSaved = Snapshot.ToBytes(Bytes);
+
+		if (bSaved) {
+			const TSharedRef<FInventorySnapshotSlotWrites, ESPMode::ThreadSafe> SlotWrites = GetSlotWrites(Path);
+			FScopeLock SlotLock(&SlotWrites->Lock);
+
+			//A newer snapshot of this slot is already on disk, this one is out of date
+			if (Sequence > SlotWrites->LastWrittenSequence) {
+				//The slot file is only ever replaced by a complete write, a crash midway leaves the old one or the temp file
+				const FString TempPath = GetTempSavePath(Path);
+				bSaved = FFileHelper::SaveArrayToFile(Bytes, *TempPath) && IFileManager::Get().Move(*Path, *TempPath, true, true);
+
+				if (bSaved) {
+					SlotWrites->LastWrittenSequence = Sequence;
+				}
+			}
+		}
+
+		if (!bSaved) {
+			UE_LOG(LogTrust, Warning, TEXT("Failed to save inventory snapshot to %s"), *Path);
+		}
+
+		if (OnComplete) {
+			AsyncTask(ENamedThreads::GameThread, [OnComplete, bSaved]() {
+				OnComplete(bSaved);
+			});
+		}
+	});
+}
+
+bool FInventorySnapshot::Load(const FString& SlotName, FInventorySnapshot& OutSnapshot) {
+	const FString Path = GetSavePath(SlotName);
+
+	//Move replaces the slot by deleting it first, a crash in between leaves only the finished temp file
+	for (const FString& CandidatePath : { Path, GetTempSavePath(Path) }) {
+		TArray<uint8> Bytes;
+		if (!FFileHelper::LoadFileToArray(Bytes, *CandidatePath, FILEREAD_Silent)) {
+			continue;
+		}
+
+		if (OutSnapshot.FromBytes(Bytes)) {
+			return true;
+		}
+		UE_LOG(LogTrust, Warning, TEXT("Inventory snapshot %s is corrupt or from a newer version"), *CandidatePath);
+	}
+
+	return false;
+}
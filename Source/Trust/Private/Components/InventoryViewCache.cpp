@@ -0,0 +1,182 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Components/InventoryViewCache.h"
+
+#include "Algo/BinarySearch.h"
+#include "Items/Item.h"
+
+bool FInventoryView::Accepts(const UItem* Item) const {
+	if (!Item || (FilterClass && !Item->IsA(FilterClass))) {
+		return false;
+	}
+	return !Filter || Filter(Item);
+}
+
+const TArray<UItem*>& FInventoryViewCache::GetView(const EInventorySortMode SortMode, const UClass* FilterClass, const TArray<UItem*>& AllItems, const TArray<UItem*>& StackViews) {
+	TUniquePtr<FInventoryView>& View = ClassViews.FindOrAdd(TPair<EInventorySortMode, const UClass*>(SortMode, FilterClass));
+	if (!View) {
+		View = MakeUnique<FInventoryView>();
+		View->SortMode = SortMode;
+		View->FilterClass = FilterClass;
+	}
+
+	if (View->bNeedsRebuild) {
+		BuildView(*View, AllItems, StackViews);
+	}
+	return View->Items;
+}
+
+void FInventoryViewCache::RegisterView(const FName ViewName, const EInventorySortMode SortMode, TFunction<bool(const UItem*)> Filter) {
+	//A replaced view keeps its array, so pointers to it from GetNamedView see the new contents
+	TUniquePtr<FInventoryView>& View = NamedViews.FindOrAdd(ViewName);
+	if (!View) {
+		View = MakeUnique<FInventoryView>();
+	}
+	View->SortMode = SortMode;
+	View->Filter = MoveTemp(Filter);
+	View->bNeedsRebuild = true;
+}
+
+void FInventoryViewCache::UnregisterView(const FName ViewName) {
+	NamedViews.Remove(ViewName);
+}
+
+const TArray<UItem*>* FInventoryViewCache::GetNamedView(const FName ViewName, const TArray<UItem*>& AllItems, const TArray<UItem*>& StackViews) {
+	const TUniquePtr<FInventoryView>* FoundView = NamedViews.Find(ViewName);
+	if (!FoundView) {
+		return nullptr;
+	}
+
+	FInventoryView* View = FoundView->Get();
+	if (View->bNeedsRebuild) {
+		BuildView(*View, AllItems, StackViews);
+	}
+	return &View->Items;
+}
+
+void FInventoryViewCache::AddItem(UItem* Item) {
+	if (!AddSequences.Contains(Item)) {
+		AddSequences.Add(Item, NextSequence++);
+	}
+
+	ForEachView([this, Item](FInventoryView& View) {
+		if (!View.bNeedsRebuild && View.Accepts(Item)) {
+			InsertSorted(View, Item);
+		}
+	});
+}
+
+void FInventoryViewCache::RemoveItem(UItem* Item) {
+	ForEachView([Item](FInventoryView& View) {
+		if (!View.bNeedsRebuild) {
+			View.Items.RemoveSingle(Item);
+		}
+	});
+
+	AddSequences.Remove(Item);
+}
+
+void FInventoryViewCache::UpdateItemQuantity(UItem* Item) {
+	//Quantity only moves an item in weight views, and in filtered views whose filter may look at it
+	ForEachView([this, Item](FInventoryView& View) {
+		if (View.bNeedsRebuild || (View.SortMode != EInventorySortMode::ISM_Weight && !View.Filter)) {
+			return;
+		}
+
+		//Items not in the inventory yet report quantity changes too, only ones the view could already contain are placed
+		const bool bWasInView = View.Items.RemoveSingle(Item) > 0;
+		if ((bWasInView || View.Filter) && AddSequences.Contains(Item) && View.Accepts(Item)) {
+			InsertSorted(View, Item);
+		}
+	});
+}
+
+void FInventoryViewCache::Rebuild(const TArray<UItem*>& AllItems, const TArray<UItem*>& StackViews) {
+	TMap<const UItem*, uint32> PreviousSequences = MoveTemp(AddSequences);
+	AddSequences.Reset();
+
+	for (const TArray<UItem*>* Source : { &AllItems, &StackViews }) {
+		for (UItem* Item : *Source) {
+			if (Item) {
+				const uint32* PreviousSequence = PreviousSequences.Find(Item);
+				AddSequences.Add(Item, PreviousSequence ? *PreviousSequence : NextSequence++);
+			}
+		}
+	}
+
+	ForEachView([](FInventoryView& View) {
+		View.bNeedsRebuild = true;
+	});
+}
+
+void FInventoryViewCache::Reset() {
+	//Views stay, callers may still hold their arrays
+	AddSequences.Reset();
+
+	ForEachView([](FInventoryView& View) {
+		View.Items.Reset();
+		View.bNeedsRebuild = true;
+	});
+}
+
+void FInventoryViewCache::BuildView(FInventoryView& View, const TArray<UItem*>& AllItems, const TArray<UItem*>& StackViews) const {
+	View.Items.Reset();
+
+	for (const TArray<UItem*>* Source : { &AllItems, &StackViews }) {
+		for (UItem* Item : *Source) {
+			if (View.Accepts(Item)) {
+				View.Items.Add(Item);
+			}
+		}
+	}
+
+	const EInventorySortMode SortMode = View.SortMode;
+	View.Items.Sort([this, SortMode](const UItem& A, const UItem& B) { return Less(SortMode, &A, &B); });
+	View.bNeedsRebuild = false;
+}
+
+void FInventoryViewCache::InsertSorted(FInventoryView& View, UItem* Item) const {
+	const EInventorySortMode SortMode = View.SortMode;
+	const int32 InsertIndex = Algo::UpperBound(View.Items, Item, [this, SortMode](const UItem* A, const UItem* B) { return Less(SortMode, A, B); });
+	View.Items.Insert(Item, InsertIndex);
+}
+
+bool FInventoryViewCache::Less(const EInventorySortMode SortMode, const UItem* A, const UItem* B) const {
+	switch (SortMode) {
+	case EInventorySortMode::ISM_Rarity:
+		if (A->GetRarity() != B->GetRarity()) {
+			return A->GetRarity() > B->GetRarity();
+		}
+		break;
+	case EInventorySortMode::ISM_Weight:
+		//Exact, a tolerance would make equal weights non transitive and break the sort
+		if (A->GetStackWeight() != B->GetStackWeight()) {
+			return A->GetStackWeight() > B->GetStackWeight();
+		}
+		break;
+	case EInventorySortMode::ISM_Name: {
+		const int32 NameOrder = A->GetItemDisplayName().CompareToCaseIgnored(B->GetItemDisplayName());
+		if (NameOrder != 0) {
+			return NameOrder < 0;
+		}
+		break;
+	}
+	case EInventorySortMode::ISM_Recency:
+		break;
+	}
+
+	//Newest first breaks every tie, which keeps the order stable across rebuilds
+	const uint32 SequenceA = GetSequence(A);
+	const uint32 SequenceB = GetSequence(B);
+	if (SequenceA != SequenceB) {
+		return SequenceA > SequenceB;
+	}
+
+	//Only items the cache hasn't been told about share a sequence
+	return A->GetUniqueID() < B->GetUniqueID();
+}
+
+uint32 FInventoryViewCache::GetSequence(const UItem* Item) const {
+	const uint32* Sequence = AddSequences.Find(Item);
+	return Sequence ? *Sequence : 0;
+}
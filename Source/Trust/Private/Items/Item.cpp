@@ -3,7 +3,9 @@
 #include "Items/Item.h"
 
 #include "Components/InventoryComponent.h"
+#include "Engine/World.h"
 #include "Net/UnrealNetwork.h"
+#include "Subsystems/ItemStreamingSubsystem.h"
 
 #define LOCTEXT_NAMESPACE "Item"
 
@@ -14,20 +16,83 @@ UItem::UItem() {
 	bStackable = true;
 	Quantity = 1;
 	MaxStackSize = 2;
+	bCompactStack = false;
 	RepKey = 0;
+	bIsStackView = false;
 }
 
 bool UItem::ShouldShowInInventory() const {
 	return true;
 }
 
+UStaticMesh* UItem::GetPickupMesh() const {
+	//Servers and collision need the real shape, which is worth a hitch on the rare call before it's streamed
+	return PickupMeshAsset.LoadSynchronous();
+}
+
+UStaticMesh* UItem::GetPickupMeshOrPlaceholder() const {
+	if (UStaticMesh* Mesh = PickupMeshAsset.Get()) {
+		return Mesh;
+	}
+
+	const UItemStreamingSubsystem* Streaming = GetWorld() ? GetWorld()->GetSubsystem<UItemStreamingSubsystem>() : nullptr;
+	return Streaming ? Streaming->GetPlaceholderMesh() : nullptr;
+}
+
+UTexture2D* UItem::GetThumbnail() const {
+	if (UTexture2D* Texture = ThumbnailAsset.Get()) {
+		return Texture;
+	}
+
+	const UItemStreamingSubsystem* Streaming = GetWorld() ? GetWorld()->GetSubsystem<UItemStreamingSubsystem>() : nullptr;
+	return Streaming ? Streaming->GetPlaceholderThumbnail() : nullptr;
+}
+
+void UItem::GetVisualAssets(TArray<FSoftObjectPath>& OutAssets) const {
+	OutAssets.Add(PickupMeshAsset.ToSoftObjectPath());
+	OutAssets.Add(ThumbnailAsset.ToSoftObjectPath());
+}
+
 void UItem::SetQuantity(const int32 NewQuantity) {
 	if (NewQuantity != Quantity) {
 		Quantity = FMath::Clamp(NewQuantity, 0, bStackable ? MaxStackSize : 1);
 		MarkDirtyForReplication();
+
+		if (OwningInventory) {
+			OwningInventory->NotifyItemQuantityChanged(this);
+		}
 	}
 }
 
+void UItem::SetQuantityFromReplication(const int32 NewQuantity) {
+	if (NewQuantity != Quantity) {
+		Quantity = NewQuantity;
+		OnRep_Quantity();
+	}
+}
+
+bool UItem::UsesCompactStorage() const {
+	if (!bCompactStack || !bStackable) {
+		return false;
+	}
+
+	//Anything with Blueprint use logic might keep state on the instance, so it always gets a real UItem
+	if (GetClass()->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(UItem, OnUse))) {
+		return false;
+	}
+
+	//There's no telling from reflection whether a native subclass overrides Use, so those have to say so
+	const UClass* NativeClass = GetClass();
+	while (NativeClass && !NativeClass->HasAnyClassFlags(CLASS_Native)) {
+		NativeClass = NativeClass->GetSuperClass();
+	}
+	return NativeClass == UItem::StaticClass() || HasStatelessNativeUse();
+}
+
+bool UItem::HasStatelessNativeUse() const {
+	return false;
+}
+
 void UItem::Use(ATrustCharacter* Character) {}
 
 void UItem::AddToInventory(UInventoryComponent* Inventory) {}
@@ -60,10 +125,18 @@ void UItem::SetOwningInventory(UInventoryComponent* NewOwningInventory) {
 void UItem::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-	DOREPLIFETIME(UItem, Quantity);
+	DOREPLIFETIME_CONDITION(UItem, Quantity, COND_Custom);
+}
+
+void UItem::PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker) {
+	DOREPLIFETIME_ACTIVE_OVERRIDE(UItem, Quantity, !OwningInventory || !OwningInventory->UsesDeltaReplication());
 }
 
 void UItem::OnRep_Quantity() {
+	if (OwningInventory) {
+		OwningInventory->NotifyItemQuantityChanged(this);
+	}
+
 	OnItemModified.Broadcast();
 }
 
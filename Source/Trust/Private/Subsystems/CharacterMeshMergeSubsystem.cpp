@@ -0,0 +1,146 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Subsystems/CharacterMeshMergeSubsystem.h"
+
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/SkeletalMesh.h"
+#include "Engine/World.h"
+#include "Rendering/SkeletalMeshLODRenderData.h"
+#include "Rendering/SkeletalMeshRenderData.h"
+#include "SkeletalMeshMerge.h"
+#include "Trust/Trust.h"
+
+DECLARE_CYCLE_STAT(TEXT("Character Mesh Merge"), STAT_CharacterMeshMerge, STATGROUP_Trust);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Merged Mesh Cache Hits"), STAT_MergedMeshCacheHits, STATGROUP_Trust);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Cached Merged Meshes"), STAT_CachedMergedMeshes, STATGROUP_Trust);
+
+UCharacterMeshMergeSubsystem::UCharacterMeshMergeSubsystem() {
+	MaxCachedMeshes = 64;
+}
+
+bool UCharacterMeshMergeSubsystem::DoesSupportWorldType(EWorldType::Type WorldType) const {
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+USkeletalMesh* UCharacterMeshMergeSubsystem::GetMergedMesh(USkeletalMesh* BaseMesh, const TArray<USkeletalMeshComponent*>& Parts) {
+	if (!BaseMesh) {
+		return nullptr;
+	}
+
+	TArray<USkeletalMesh*> SourceMeshes;
+	TArray<TArray<UMaterialInterface*>> SourceMaterials;
+	SourceMeshes.Add(BaseMesh);
+	SourceMaterials.AddDefaulted();
+	for (const FSkeletalMaterial& Material : BaseMesh->GetMaterials()) {
+		SourceMaterials.Last().Add(Material.MaterialInterface);
+	}
+
+	for (const USkeletalMeshComponent* Part : Parts) {
+		if (Part && Part->SkeletalMesh) {
+			SourceMeshes.Add(Part->SkeletalMesh);
+			TArray<UMaterialInterface*>& Materials = SourceMaterials.AddDefaulted_GetRef();
+			for (int32 i = 0; i < Part->SkeletalMesh->GetMaterials().Num(); ++i) {
+				Materials.Add(Part->GetMaterial(i));
+			}
+		}
+	}
+
+	FMergedMeshKey Key;
+	for (int32 i = 0; i < SourceMeshes.Num(); ++i) {
+		Key.Sources.Add(SourceMeshes[i]);
+		Key.Sources.Append(SourceMaterials[i]);
+	}
+	for (const UObject* Source : Key.Sources) {
+		Key.Hash = HashCombine(Key.Hash, GetTypeHash(Source));
+	}
+
+	if (FCachedMergedMesh* Cached = MergedMeshes.Find(Key)) {
+		Cached->LastUsedFrame = GFrameCounter;
+		INC_DWORD_STAT(STAT_MergedMeshCacheHits);
+		return Cached->Mesh;
+	}
+
+	USkeletalMesh* MergedMesh = MergeMeshes(SourceMeshes, SourceMaterials);
+	if (MergedMesh) {
+		MergedMeshes.Add(Key, { MergedMesh, GFrameCounter });
+		ReferencedMeshes.Add(MergedMesh);
+		INC_DWORD_STAT(STAT_CachedMergedMeshes);
+		TrimCache();
+	}
+	return MergedMesh;
+}
+
+USkeletalMesh* UCharacterMeshMergeSubsystem::MergeMeshes(const TArray<USkeletalMesh*>& SourceMeshes, const TArray<TArray<UMaterialInterface*>>& SourceMaterials) const {
+	SCOPE_CYCLE_COUNTER(STAT_CharacterMeshMerge);
+
+	USkeleton* Skeleton = SourceMeshes[0]->GetSkeleton();
+	for (const USkeletalMesh* SourceMesh : SourceMeshes) {
+		if (SourceMesh->GetSkeleton() != Skeleton) {
+			UE_LOG(LogTrust, Warning, TEXT("Can't merge %s into %s, they use different skeletons"), *SourceMesh->GetName(), *SourceMeshes[0]->GetName());
+			return nullptr;
+		}
+	}
+
+	//Sections worn with the same material share a merged section, the mapping's IDs are the merged sections' indices.
+	//Each source's LOD 0 sections decide it, its other LODs are expected to use the same section layout
+	TArray<FSkelMeshMergeSectionMapping> SectionMapping;
+	TArray<UMaterialInterface*> MergedSectionMaterials;
+	for (int32 i = 0; i < SourceMeshes.Num(); ++i) {
+		const FSkeletalMeshRenderData* RenderData = SourceMeshes[i]->GetResourceForRendering();
+		if (!RenderData || RenderData->LODRenderData.Num() == 0) {
+			UE_LOG(LogTrust, Warning, TEXT("Can't merge %s, it has no render data"), *SourceMeshes[i]->GetName());
+			return nullptr;
+		}
+
+		FSkelMeshMergeSectionMapping& Mapping = SectionMapping.AddDefaulted_GetRef();
+		const TArray<FSkeletalMaterial>& OriginalMaterials = SourceMeshes[i]->GetMaterials();
+		for (const FSkelMeshRenderSection& Section : RenderData->LODRenderData[0].RenderSections) {
+			UMaterialInterface* Worn = SourceMaterials[i].IsValidIndex(Section.MaterialIndex) ? SourceMaterials[i][Section.MaterialIndex] : nullptr;
+			if (!Worn && OriginalMaterials.IsValidIndex(Section.MaterialIndex)) {
+				Worn = OriginalMaterials[Section.MaterialIndex].MaterialInterface;
+			}
+			Mapping.SectionIDs.Add(MergedSectionMaterials.AddUnique(Worn));
+		}
+	}
+
+	USkeletalMesh* MergedMesh = NewObject<USkeletalMesh>(GetTransientPackage(), NAME_None, RF_Transient);
+	MergedMesh->SetSkeleton(Skeleton);
+
+	FSkeletalMeshMerge Merger(MergedMesh, SourceMeshes, SectionMapping, 0);
+	if (!Merger.DoMerge()) {
+		UE_LOG(LogTrust, Warning, TEXT("Merging %d meshes onto %s failed"), SourceMeshes.Num(), *SourceMeshes[0]->GetName());
+		return nullptr;
+	}
+
+	//The merge gives each section the material of the first source section mapped to it, swap in what was worn there
+	TArray<FSkeletalMaterial>& MergedMaterials = MergedMesh->GetMaterials();
+	const FSkeletalMeshRenderData* MergedRenderData = MergedMesh->GetResourceForRendering();
+	if (MergedRenderData && MergedRenderData->LODRenderData.Num() > 0) {
+		const TArray<FSkelMeshRenderSection>& MergedSections = MergedRenderData->LODRenderData[0].RenderSections;
+		for (int32 i = 0; i < MergedSections.Num() && i < MergedSectionMaterials.Num(); ++i) {
+			if (MergedSectionMaterials[i] && MergedMaterials.IsValidIndex(MergedSections[i].MaterialIndex)) {
+				MergedMaterials[MergedSections[i].MaterialIndex].MaterialInterface = MergedSectionMaterials[i];
+			}
+		}
+	}
+
+	return MergedMesh;
+}
+
+void UCharacterMeshMergeSubsystem::TrimCache() {
+	while (MergedMeshes.Num() > MaxCachedMeshes) {
+		const FMergedMeshKey* OldestKey = nullptr;
+		const FCachedMergedMesh* Oldest = nullptr;
+		for (const TPair<FMergedMeshKey, FCachedMergedMesh>& Cached : MergedMeshes) {
+			if (!Oldest || Cached.Value.LastUsedFrame < Oldest->LastUsedFrame) {
+				OldestKey = &Cached.Key;
+				Oldest = &Cached.Value;
+			}
+		}
+
+		//Characters still wearing it keep it alive, the cache just stops handing it out
+		ReferencedMeshes.RemoveSwap(Oldest->Mesh);
+		MergedMeshes.Remove(FMergedMeshKey(*OldestKey));
+		DEC_DWORD_STAT(STAT_CachedMergedMeshes);
+	}
+}
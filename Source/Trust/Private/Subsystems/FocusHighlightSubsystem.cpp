@@ -0,0 +1,113 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Subsystems/FocusHighlightSubsystem.h"
+
+#include "Components/InteractionComponent.h"
+#include "Components/PrimitiveComponent.h"
+#include "Engine/World.h"
+#include "Trust/Trust.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Focus Highlight Requests"), STAT_FocusHighlightRequests, STATGROUP_Trust);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Focus Highlight Primitives Changed"), STAT_FocusHighlightPrimitivesChanged, STATGROUP_Trust);
+
+void UFocusHighlightSubsystem::Initialize(FSubsystemCollectionBase& Collection) {
+	Super::Initialize(Collection);
+
+	PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddUObject(this, &UFocusHighlightSubsystem::OnWorldPostActorTick);
+}
+
+void UFocusHighlightSubsystem::Deinitialize() {
+	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+
+	Super::Deinitialize();
+}
+
+bool UFocusHighlightSubsystem::DoesSupportWorldType(EWorldType::Type WorldType) const {
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UFocusHighlightSubsystem::RequestHighlight(UInteractionComponent* Interactable, const bool bHighlight) {
+	if (Interactable) {
+		PendingHighlights.Add(Interactable, bHighlight);
+		INC_DWORD_STAT(STAT_FocusHighlightRequests);
+	}
+}
+
+void UFocusHighlightSubsystem::OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds) {
+	if (World == GetWorld()) {
+		FlushHighlights();
+	}
+}
+
+void UFocusHighlightSubsystem::FlushHighlights() {
+	if (PendingHighlights.Num() == 0) {
+		return;
+	}
+
+	for (const TPair<TWeakObjectPtr<UInteractionComponent>, bool>& Pending : PendingHighlights) {
+		FAppliedHighlight* Applied = AppliedHighlights.Find(Pending.Key);
+
+		//Focused and unfocused again within the frame, or the other way around, costs nothing
+		if ((Applied != nullptr) == Pending.Value) {
+			continue;
+		}
+
+		if (Applied) {
+			RevertHighlight(*Applied);
+			AppliedHighlights.Remove(Pending.Key);
+		} else if (UInteractionComponent* Interactable = Pending.Key.Get()) {
+			ApplyHighlight(Interactable);
+		}
+	}
+	PendingHighlights.Reset();
+
+	//Interactables destroyed while outlined never ask to be reverted
+	for (auto It = AppliedHighlights.CreateIterator(); It; ++It) {
+		if (!It.Key().IsValid()) {
+			It.RemoveCurrent();
+		}
+	}
+}
+
+void UFocusHighlightSubsystem::ApplyHighlight(UInteractionComponent* Interactable) {
+	FAppliedHighlight& Highlight = AppliedHighlights.Add(Interactable);
+	const int32 StencilValue = Interactable->GetOutlineStencilValue();
+
+	for (const TWeakObjectPtr<UPrimitiveComponent>& PrimitivePtr : Interactable->GetOutlinePrimitives()) {
+		UPrimitiveComponent* Primitive = PrimitivePtr.Get();
+		if (!Primitive) {
+			continue;
+		}
+
+		//Stencils that already match are recorded as untouched, reverting only undoes what the outline changed
+		const bool bChangeStencil = StencilValue > 0 && Primitive->CustomDepthStencilValue != StencilValue;
+		Highlight.Primitives.Add(Primitive);
+		Highlight.PreviousStencils.Add(bChangeStencil ? Primitive->CustomDepthStencilValue : INDEX_NONE);
+		Highlight.PreviousRenderCustomDepth.Add(Primitive->bRenderCustomDepth);
+
+		if (bChangeStencil) {
+			Primitive->SetCustomDepthStencilValue(StencilValue);
+		}
+		if (!Primitive->bRenderCustomDepth) {
+			Primitive->SetRenderCustomDepth(true);
+			INC_DWORD_STAT(STAT_FocusHighlightPrimitivesChanged);
+		}
+	}
+}
+
+void UFocusHighlightSubsystem::RevertHighlight(FAppliedHighlight& Highlight) {
+	for (int32 i = 0; i < Highlight.Primitives.Num(); ++i) {
+		UPrimitiveComponent* Primitive = Highlight.Primitives[i].Get();
+		if (!Primitive) {
+			continue;
+		}
+
+		if (Highlight.PreviousStencils[i] != INDEX_NONE) {
+			Primitive->SetCustomDepthStencilValue(Highlight.PreviousStencils[i]);
+		}
+		if (Primitive->bRenderCustomDepth != Highlight.PreviousRenderCustomDepth[i]) {
+			Primitive->SetRenderCustomDepth(Highlight.PreviousRenderCustomDepth[i]);
+			INC_DWORD_STAT(STAT_FocusHighlightPrimitivesChanged);
+		}
+	}
+}
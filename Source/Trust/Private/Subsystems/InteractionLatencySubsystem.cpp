@@ -0,0 +1,170 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Subsystems/InteractionLatencySubsystem.h"
+
+#include "Engine/World.h"
+#include "GameFramework/GameStateBase.h"
+#include "HAL/IConsoleManager.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "Trust/Trust.h"
+
+CSV_DEFINE_CATEGORY(Interaction, true);
+
+static TAutoConsoleVariable<int32> CVarInteractionLatencyStats(
+	TEXT("Trust.Interaction.LatencyStats"),
+	0,
+	TEXT("If non-zero, clients timestamp interactions and record their round trip to the server in histograms and CSV stats."),
+	ECVF_Cheat);
+
+const float FInteractionLatencyHistogram::BucketBounds[NumBuckets] = { 10.f, 20.f, 35.f, 50.f, 75.f, 100.f, 150.f, 200.f, 300.f, 500.f, 1000.f, FLT_MAX };
+
+FInteractionLatencyHistogram::FInteractionLatencyHistogram() {
+	Reset();
+}
+
+void FInteractionLatencyHistogram::AddSample(const float Milliseconds) {
+	int32 Bucket = 0;
+	while (Milliseconds > BucketBounds[Bucket]) {
+		++Bucket;
+	}
+
+	++Buckets[Bucket];
+	++NumSamples;
+	Sum += Milliseconds;
+	Min = FMath::Min(Min, Milliseconds);
+	Max = FMath::Max(Max, Milliseconds);
+}
+
+void FInteractionLatencyHistogram::Reset() {
+	FMemory::Memzero(Buckets);
+	NumSamples = 0;
+	Sum = 0.f;
+	Min = FLT_MAX;
+	Max = 0.f;
+}
+
+float FInteractionLatencyHistogram::GetPercentile(const float Percentile) const {
+	const int32 Target = FMath::CeilToInt(NumSamples * Percentile);
+	int32 Seen = 0;
+	for (int32 Bucket = 0; Bucket < NumBuckets; ++Bucket) {
+		Seen += Buckets[Bucket];
+		if (Seen >= Target && Seen > 0) {
+			//The open ended last bucket only knows its worst sample
+			return Bucket == NumBuckets - 1 ? Max : BucketBounds[Bucket];
+		}
+	}
+	return 0.f;
+}
+
+FString FInteractionLatencyHistogram::ToString() const {
+	if (NumSamples == 0) {
+		return TEXT("no samples");
+	}
+
+	FString Result = FString::Printf(TEXT("n %d, avg %.1f, min %.1f, p50 <%.0f, p95 <%.0f, max %.1f |"), NumSamples, GetAverage(), Min, GetPercentile(0.5f), GetPercentile(0.95f), Max);
+	for (int32 Bucket = 0; Bucket < NumBuckets; ++Bucket) {
+		Result += FString::Printf(TEXT(" %d"), Buckets[Bucket]);
+	}
+	return Result;
+}
+
+UInteractionLatencySubsystem::UInteractionLatencySubsystem() {
+	NumStaleRequests = 0;
+	NextRequestId = 0;
+}
+
+void UInteractionLatencySubsystem::Deinitialize() {
+	if (RoundTrip.NumSamples > 0) {
+		LogReport();
+	}
+
+	Super::Deinitialize();
+}
+
+bool UInteractionLatencySubsystem::IsEnabled() {
+	return CVarInteractionLatencyStats.GetValueOnGameThread() != 0;
+}
+
+bool UInteractionLatencySubsystem::DoesSupportWorldType(EWorldType::Type WorldType) const {
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+uint16 UInteractionLatencySubsystem::BeginRequest(const float HoldTime) {
+	if (!IsEnabled()) {
+		return 0;
+	}
+
+	const double Now = FPlatformTime::Seconds();
+	PruneStaleRequests(Now);
+
+	//0 means not measured on the wire
+	if (++NextRequestId == 0) {
+		++NextRequestId;
+	}
+
+	FInFlightRequest& Request = InFlightRequests.AddDefaulted_GetRef();
+	Request.RequestId = NextRequestId;
+	Request.PressRealTime = Now;
+	Request.PressServerTime = GetServerTime();
+	Request.HoldTime = HoldTime;
+	return Request.RequestId;
+}
+
+void UInteractionLatencySubsystem::CompleteRequest(const uint16 RequestId, const float ServerReceiveTime, const float ServerInteractTime) {
+	const int32 Index = InFlightRequests.IndexOfByPredicate([RequestId](const FInFlightRequest& Request) { return Request.RequestId == RequestId; });
+	if (Index == INDEX_NONE) {
+		return;
+	}
+
+	const FInFlightRequest Request = InFlightRequests[Index];
+	InFlightRequests.RemoveAtSwap(Index);
+
+	//Hold time is the player's, not latency
+	const float RoundTripMs = FMath::Max(0.f, (float)(FPlatformTime::Seconds() - Request.PressRealTime) - Request.HoldTime) * 1000.f;
+	const float ServerMs = FMath::Max(0.f, ServerInteractTime - ServerReceiveTime - Request.HoldTime) * 1000.f;
+	const float UplinkMs = FMath::Clamp((ServerReceiveTime - Request.PressServerTime) * 1000.f, 0.f, RoundTripMs - ServerMs);
+	const float DownlinkMs = FMath::Max(0.f, RoundTripMs - ServerMs - UplinkMs);
+
+	Uplink.AddSample(UplinkMs);
+	Server.AddSample(ServerMs);
+	Downlink.AddSample(DownlinkMs);
+	RoundTrip.AddSample(RoundTripMs);
+
+	CSV_CUSTOM_STAT(Interaction, UplinkMs, UplinkMs, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(Interaction, ServerMs, ServerMs, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(Interaction, DownlinkMs, DownlinkMs, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(Interaction, RoundTripMs, RoundTripMs, ECsvCustomStatOp::Set);
+
+	UE_LOG(LogTrust, Verbose, TEXT("Interaction %d: uplink %.1f ms, server %.1f ms, downlink %.1f ms, round trip %.1f ms"), RequestId, UplinkMs, ServerMs, DownlinkMs, RoundTripMs);
+}
+
+void UInteractionLatencySubsystem::ResetStats() {
+	InFlightRequests.Reset();
+	Uplink.Reset();
+	Server.Reset();
+	Downlink.Reset();
+	RoundTrip.Reset();
+	NumStaleRequests = 0;
+}
+
+void UInteractionLatencySubsystem::LogReport() const {
+	FString Bounds;
+	for (int32 Bucket = 0; Bucket < FInteractionLatencyHistogram::NumBuckets - 1; ++Bucket) {
+		Bounds += FString::Printf(TEXT(" <%.0f"), FInteractionLatencyHistogram::BucketBounds[Bucket]);
+	}
+
+	UE_LOG(LogTrust, Display, TEXT("Interaction latency (ms), buckets%s >%.0f, %d never completed"), *Bounds, FInteractionLatencyHistogram::BucketBounds[FInteractionLatencyHistogram::NumBuckets - 2], NumStaleRequests);
+	UE_LOG(LogTrust, Display, TEXT("  uplink     %s"), *Uplink.ToString());
+	UE_LOG(LogTrust, Display, TEXT("  server     %s"), *Server.ToString());
+	UE_LOG(LogTrust, Display, TEXT("  downlink   %s"), *Downlink.ToString());
+	UE_LOG(LogTrust, Display, TEXT("  round trip %s"), *RoundTrip.ToString());
+}
+
+float UInteractionLatencySubsystem::GetServerTime() const {
+	const AGameStateBase* GameState = GetWorld()->GetGameState();
+	return GameState ? GameState->GetServerWorldTimeSeconds() : GetWorld()->GetTimeSeconds();
+}
+
+void UInteractionLatencySubsystem::PruneStaleRequests(const double Now) {
+	NumStaleRequests += InFlightRequests.RemoveAllSwap([Now](const FInFlightRequest& Request) { return Now - Request.PressRealTime - Request.HoldTime > 10.0; });
+}
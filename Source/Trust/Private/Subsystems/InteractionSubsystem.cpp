@@ -0,0 +1,161 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Subsystems/InteractionSubsystem.h"
+
+#include "Components/InteractionComponent.h"
+#include "Engine/World.h"
+#include "Trust/Trust.h"
+
+DECLARE_CYCLE_STAT(TEXT("Interaction Registry Query"), STAT_InteractionRegistryQuery, STATGROUP_Trust);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Registered Interactables"), STAT_RegisteredInteractables, STATGROUP_Trust);
+
+UInteractionSubsystem::UInteractionSubsystem() {
+	CellSize = 500.f;
+	MaxInteractionDistance = 0.f;
+	MaxBoundsExtent = 0.f;
+}
+
+bool UInteractionSubsystem::DoesSupportWorldType(EWorldType::Type WorldType) const {
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UInteractionSubsystem::RegisterInteractable(UInteractionComponent* Interactable) {
+	if (!Interactable || RegisteredCells.Contains(Interactable)) {
+		return;
+	}
+
+	FRegisteredInteractable Entry;
+	Entry.Component = Interactable;
+	Entry.Bounds = GetInteractableBounds(Interactable);
+
+	const FIntPoint Cell = GetCell(Entry.Bounds.GetCenter());
+	Cells.FindOrAdd(Cell).Add(Entry);
+	RegisteredCells.Add(Interactable, Cell);
+
+	MaxInteractionDistance = FMath::Max(MaxInteractionDistance, Interactable->GetInteractionDistance());
+	MaxBoundsExtent = FMath::Max(MaxBoundsExtent, Entry.Bounds.GetExtent().Size2D());
+
+	INC_DWORD_STAT(STAT_RegisteredInteractables);
+}
+
+void UInteractionSubsystem::UnregisterInteractable(UInteractionComponent* Interactable) {
+	FIntPoint Cell;
+	if (!RegisteredCells.RemoveAndCopyValue(Interactable, Cell)) {
+		return;
+	}
+
+	if (TArray<FRegisteredInteractable>* CellInteractables = Cells.Find(Cell)) {
+		CellInteractables->RemoveAllSwap([Interactable](const FRegisteredInteractable& Entry) { return Entry.Component == Interactable; });
+
+		if (CellInteractables->Num() == 0) {
+			Cells.Remove(Cell);
+		}
+	}
+
+	DEC_DWORD_STAT(STAT_RegisteredInteractables);
+}
+
+void UInteractionSubsystem::UpdateInteractable(UInteractionComponent* Interactable) {
+	const FIntPoint* OldCell = RegisteredCells.Find(Interactable);
+	if (!OldCell) {
+		return;
+	}
+
+	const FBox NewBounds = GetInteractableBounds(Interactable);
+	const FIntPoint NewCell = GetCell(NewBounds.GetCenter());
+
+	if (NewCell == *OldCell) {
+		for (FRegisteredInteractable& Entry : Cells.FindChecked(NewCell)) {
+			if (Entry.Component == Interactable) {
+				Entry.Bounds = NewBounds;
+				break;
+			}
+		}
+
+		MaxInteractionDistance = FMath::Max(MaxInteractionDistance, Interactable->GetInteractionDistance());
+		MaxBoundsExtent = FMath::Max(MaxBoundsExtent, NewBounds.GetExtent().Size2D());
+	} else {
+		UnregisterInteractable(Interactable);
+		RegisterInteractable(Interactable);
+	}
+}
+
+UInteractionComponent* UInteractionSubsystem::FindInteractableAlongRay(const FVector& Start, const FVector& Direction, const AActor* IgnoredActor, float& OutDistance) const {
+	SCOPE_CYCLE_COUNTER(STAT_InteractionRegistryQuery);
+
+	const FVector RayDirection = Direction.GetSafeNormal();
+	const float QueryRadius = MaxInteractionDistance + MaxBoundsExtent;
+
+	const FIntPoint MinCell = GetCell(Start - FVector(QueryRadius, QueryRadius, 0.f));
+	const FIntPoint MaxCell = GetCell(Start + FVector(QueryRadius, QueryRadius, 0.f));
+
+	UInteractionComponent* ClosestInteractable = nullptr;
+	OutDistance = BIG_NUMBER;
+
+	for (int32 X = MinCell.X; X <= MaxCell.X; ++X) {
+		for (int32 Y = MinCell.Y; Y <= MaxCell.Y; ++Y) {
+			const TArray<FRegisteredInteractable>* CellInteractables = Cells.Find(FIntPoint(X, Y));
+			if (!CellInteractables) {
+				continue;
+			}
+
+			for (const FRegisteredInteractable& Entry : *CellInteractables) {
+				if (!Entry.Component->IsActive() || Entry.Component->GetOwner() == IgnoredActor) {
+					continue;
+				}
+
+				//Only the part of the ray within this interactable's reach matters, it can't be focused from any further
+				const float Reach = Entry.Component->GetInteractionDistance();
+				const FVector End = Start + RayDirection * Reach;
+
+				FVector HitLocation, HitNormal;
+				float HitTime = 0.f;
+				if (Entry.Bounds.IsInside(Start)) {
+					HitTime = 0.f;
+				} else if (!FMath::LineExtentBoxIntersection(Entry.Bounds, Start, End, FVector::ZeroVector, HitLocation, HitNormal, HitTime)) {
+					continue;
+				}
+
+				const float Distance = HitTime * Reach;
+				if (Distance < OutDistance) {
+					OutDistance = Distance;
+					ClosestInteractable = Entry.Component;
+				}
+			}
+		}
+	}
+
+	return ClosestInteractable;
+}
+
+void UInteractionSubsystem::GatherInteractablesInRadius(const FVector& Center, const float Radius, TArray<const FRegisteredInteractable*>& OutInteractables) const {
+	const FIntPoint MinCell = GetCell(Center - FVector(Radius + MaxBoundsExtent, Radius + MaxBoundsExtent, 0.f));
+	const FIntPoint MaxCell = GetCell(Center + FVector(Radius + MaxBoundsExtent, Radius + MaxBoundsExtent, 0.f));
+
+	for (int32 X = MinCell.X; X <= MaxCell.X; ++X) {
+		for (int32 Y = MinCell.Y; Y <= MaxCell.Y; ++Y) {
+			if (const TArray<FRegisteredInteractable>* CellInteractables = Cells.Find(FIntPoint(X, Y))) {
+				for (const FRegisteredInteractable& Entry : *CellInteractables) {
+					if (Entry.Bounds.ComputeSquaredDistanceToPoint(Center) <= FMath::Square(Radius)) {
+						OutInteractables.Add(&Entry);
+					}
+				}
+			}
+		}
+	}
+}
+
+FIntPoint UInteractionSubsystem::GetCell(const FVector& Location) const {
+	return FIntPoint(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize));
+}
+
+FBox UInteractionSubsystem::GetInteractableBounds(const UInteractionComponent* Interactable) {
+	//The root is what the old focus trace hit, the interaction component itself has no bounds
+	const AActor* Owner = Interactable->GetOwner();
+	const USceneComponent* Root = Owner ? Owner->GetRootComponent() : nullptr;
+
+	if (Root && Root != Interactable) {
+		return Root->Bounds.GetBox();
+	}
+	return FBox::BuildAABB(Interactable->GetComponentLocation(), FVector(50.f));
+}
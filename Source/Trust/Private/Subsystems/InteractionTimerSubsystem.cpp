@@ -0,0 +1,132 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Subsystems/InteractionTimerSubsystem.h"
+
+#include "Components/InteractionComponent.h"
+#include "Engine/World.h"
+#include "Trust/Trust.h"
+#include "Trust/TrustCharacter.h"
+
+DECLARE_CYCLE_STAT(TEXT("Interaction Timers Tick"), STAT_InteractionTimersTick, STATGROUP_Trust);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Interactions Completed"), STAT_InteractionsCompleted, STATGROUP_Trust);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Interactions In Flight"), STAT_InteractionsInFlight, STATGROUP_Trust);
+
+UInteractionTimerSubsystem::UInteractionTimerSubsystem() {
+	NextSerial = 0;
+}
+
+void UInteractionTimerSubsystem::StartInteraction(ATrustCharacter* Character, UInteractionComponent* Interactable, const float Duration) {
+	if (!Character || !Interactable) {
+		return;
+	}
+
+	CancelInteraction(Character);
+
+	FScheduledInteraction Scheduled;
+	Scheduled.CompleteTime = GetWorld()->GetTimeSeconds() + Duration;
+	Scheduled.Serial = ++NextSerial;
+	Scheduled.Character = Character;
+	Scheduled.Interactable = Interactable;
+	Schedule.HeapPush(Scheduled);
+
+	FActiveInteraction& Active = ActiveInteractions.Add(Character);
+	Active.Serial = Scheduled.Serial;
+	Active.CompleteTime = Scheduled.CompleteTime;
+	Active.Character = Character;
+	Active.Interactable = Interactable;
+
+	INC_DWORD_STAT(STAT_InteractionsInFlight);
+}
+
+void UInteractionTimerSubsystem::CancelInteraction(const ATrustCharacter* Character) {
+	if (ActiveInteractions.Remove(Character) > 0) {
+		DEC_DWORD_STAT(STAT_InteractionsInFlight);
+		CompactSchedule();
+	}
+}
+
+void UInteractionTimerSubsystem::CancelInteractionsWith(const UInteractionComponent* Interactable) {
+	int32 NumCancelled = 0;
+	for (auto It = ActiveInteractions.CreateIterator(); It; ++It) {
+		if (It.Value().Interactable == Interactable) {
+			It.RemoveCurrent();
+			++NumCancelled;
+		}
+	}
+
+	if (NumCancelled > 0) {
+		DEC_DWORD_STAT_BY(STAT_InteractionsInFlight, NumCancelled);
+		CompactSchedule();
+	}
+}
+
+bool UInteractionTimerSubsystem::IsInteracting(const ATrustCharacter* Character) const {
+	return ActiveInteractions.Contains(Character);
+}
+
+float UInteractionTimerSubsystem::GetRemainingTime(const ATrustCharacter* Character) const {
+	const FActiveInteraction* Active = ActiveInteractions.Find(Character);
+	return Active ? FMath::Max(0.f, (float)(Active->CompleteTime - GetWorld()->GetTimeSeconds())) : 0.f;
+}
+
+void UInteractionTimerSubsystem::Tick(float DeltaTime) {
+	SCOPE_CYCLE_COUNTER(STAT_InteractionTimersTick);
+
+	const double Now = GetWorld()->GetTimeSeconds();
+
+	//Pop everything due first, completing can start or cancel other interactions
+	TArray<FScheduledInteraction, TInlineAllocator<16>> Due;
+	while (Schedule.Num() > 0 && Schedule.HeapTop().CompleteTime <= Now) {
+		FScheduledInteraction Scheduled;
+		Schedule.HeapPop(Scheduled, false);
+
+		const TWeakObjectPtr<const ATrustCharacter> CharacterKey = Scheduled.Character;
+		const FActiveInteraction* Active = ActiveInteractions.Find(CharacterKey);
+		if (Active && Active->Serial == Scheduled.Serial) {
+			ActiveInteractions.Remove(CharacterKey);
+			DEC_DWORD_STAT(STAT_InteractionsInFlight);
+			Due.Add(Scheduled);
+		}
+	}
+
+	for (const FScheduledInteraction& Scheduled : Due) {
+		ATrustCharacter* Character = Scheduled.Character.Get();
+		UInteractionComponent* Interactable = Scheduled.Interactable.Get();
+		if (Character && Interactable) {
+			Interactable->Interact(Character);
+			INC_DWORD_STAT(STAT_InteractionsCompleted);
+		}
+	}
+}
+
+void UInteractionTimerSubsystem::CompactSchedule() {
+	if (Schedule.Num() <= 2 * ActiveInteractions.Num() + 16) {
+		return;
+	}
+
+	Schedule.Reset();
+	for (const TPair<TWeakObjectPtr<const ATrustCharacter>, FActiveInteraction>& Active : ActiveInteractions) {
+		FScheduledInteraction& Scheduled = Schedule.AddDefaulted_GetRef();
+		Scheduled.CompleteTime = Active.Value.CompleteTime;
+		Scheduled.Serial = Active.Value.Serial;
+		Scheduled.Character = Active.Value.Character;
+		Scheduled.Interactable = Active.Value.Interactable;
+	}
+	Schedule.Heapify();
+}
+
+bool UInteractionTimerSubsystem::IsTickable() const {
+	return Schedule.Num() > 0;
+}
+
+ETickableTickType UInteractionTimerSubsystem::GetTickableTickType() const {
+	return HasAnyFlags(RF_ClassDefaultObject) ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+UWorld* UInteractionTimerSubsystem::GetTickableGameObjectWorld() const {
+	return GetWorld();
+}
+
+TStatId UInteractionTimerSubsystem::GetStatId() const {
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UInteractionTimerSubsystem, STATGROUP_Tickables);
+}
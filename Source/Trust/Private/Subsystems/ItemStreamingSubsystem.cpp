@@ -0,0 +1,128 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Subsystems/ItemStreamingSubsystem.h"
+
+#include "Engine/StaticMesh.h"
+#include "Engine/Texture2D.h"
+#include "Engine/World.h"
+#include "Items/Item.h"
+#include "Trust/Trust.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Streamed Item Classes"), STAT_StreamedItemClasses, STATGROUP_Trust);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Item Asset Loads Started"), STAT_ItemAssetLoadsStarted, STATGROUP_Trust);
+
+void UItemStreamingSubsystem::Initialize(FSubsystemCollectionBase& Collection) {
+	Super::Initialize(Collection);
+
+	//Engine content, always resident anyway
+	PlaceholderMesh = LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Cube.Cube"));
+	PlaceholderThumbnail = LoadObject<UTexture2D>(nullptr, TEXT("/Engine/EngineResources/DefaultTexture.DefaultTexture"));
+}
+
+void UItemStreamingSubsystem::Deinitialize() {
+	for (TPair<const UClass*, FItemAssetRequest>& Request : Requests) {
+		if (Request.Value.Handle.IsValid()) {
+			Request.Value.Handle->ReleaseHandle();
+		}
+	}
+	SET_DWORD_STAT(STAT_StreamedItemClasses, 0);
+	Requests.Reset();
+
+	Super::Deinitialize();
+}
+
+bool UItemStreamingSubsystem::DoesSupportWorldType(EWorldType::Type WorldType) const {
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UItemStreamingSubsystem::RequestItemAssets(TSubclassOf<UItem> ItemClass, const UObject* Requester, const EItemAssetPriority Priority) {
+	if (!ItemClass || !Requester || GetWorld()->GetNetMode() == NM_DedicatedServer) {
+		return;
+	}
+
+	FItemAssetRequest* Request = Requests.Find(ItemClass);
+	if (!Request) {
+		Request = &Requests.Add(ItemClass);
+		Request->Priority = Priority;
+		Request->Requesters.Add(Requester);
+		INC_DWORD_STAT(STAT_StreamedItemClasses);
+		StartLoad(ItemClass, *Request);
+		return;
+	}
+
+	Request->Requesters.AddUnique(Requester);
+
+	//A prefetch that hasn't arrived by the time the item is on screen is asked for again at the front of the queue
+	if (Priority > Request->Priority) {
+		Request->Priority = Priority;
+		if (Request->Handle.IsValid() && Request->Handle->IsLoadingInProgress()) {
+			const TSharedPtr<FStreamableHandle> PrefetchHandle = Request->Handle;
+			StartLoad(ItemClass, *Request);
+			PrefetchHandle->ReleaseHandle();
+		}
+	}
+}
+
+void UItemStreamingSubsystem::ReleaseItemAssets(TSubclassOf<UItem> ItemClass, const UObject* Requester) {
+	FItemAssetRequest* Request = Requests.Find(ItemClass);
+	if (!Request) {
+		return;
+	}
+
+	Request->Requesters.RemoveAllSwap([Requester](const TWeakObjectPtr<const UObject>& Held) { return !Held.IsValid() || Held == Requester; });
+	if (Request->Requesters.Num() == 0) {
+		ReleaseRequest(ItemClass);
+	}
+}
+
+void UItemStreamingSubsystem::ReleaseAllItemAssets(const UObject* Requester) {
+	TArray<const UClass*> Released;
+	for (TPair<const UClass*, FItemAssetRequest>& Request : Requests) {
+		Request.Value.Requesters.RemoveAllSwap([Requester](const TWeakObjectPtr<const UObject>& Held) { return !Held.IsValid() || Held == Requester; });
+		if (Request.Value.Requesters.Num() == 0) {
+			Released.Add(Request.Key);
+		}
+	}
+
+	for (const UClass* ItemClass : Released) {
+		ReleaseRequest(ItemClass);
+	}
+}
+
+bool UItemStreamingSubsystem::AreItemAssetsLoaded(TSubclassOf<UItem> ItemClass) const {
+	const FItemAssetRequest* Request = Requests.Find(ItemClass);
+	return Request && (!Request->Handle.IsValid() || Request->Handle->HasLoadCompleted());
+}
+
+void UItemStreamingSubsystem::StartLoad(const UClass* ItemClass, FItemAssetRequest& Request) {
+	TArray<FSoftObjectPath> Assets;
+	ItemClass->GetDefaultObject<UItem>()->GetVisualAssets(Assets);
+	Assets.RemoveAllSwap([](const FSoftObjectPath& Asset) { return Asset.IsNull(); });
+
+	if (Assets.Num() == 0) {
+		Request.Handle.Reset();
+		return;
+	}
+
+	const TAsyncLoadPriority LoadPriority = Request.Priority == EItemAssetPriority::IAP_Visible ? FStreamableManager::AsyncLoadHighPriority : FStreamableManager::DefaultAsyncLoadPriority;
+	const TSubclassOf<UItem> LoadedClass = const_cast<UClass*>(ItemClass);
+	Request.Handle = Streamable.RequestAsyncLoad(Assets, FStreamableDelegate::CreateUObject(this, &UItemStreamingSubsystem::OnItemAssetsStreamed, LoadedClass), LoadPriority);
+	INC_DWORD_STAT(STAT_ItemAssetLoadsStarted);
+}
+
+void UItemStreamingSubsystem::OnItemAssetsStreamed(TSubclassOf<UItem> ItemClass) {
+	if (Requests.Contains(ItemClass)) {
+		OnItemAssetsLoaded.Broadcast(ItemClass);
+	}
+}
+
+void UItemStreamingSubsystem::ReleaseRequest(const UClass* ItemClass) {
+	FItemAssetRequest Request;
+	if (Requests.RemoveAndCopyValue(ItemClass, Request)) {
+		//The assets stay until garbage collection, so releasing and requesting again soon after is cheap
+		if (Request.Handle.IsValid()) {
+			Request.Handle->ReleaseHandle();
+		}
+		DEC_DWORD_STAT(STAT_StreamedItemClasses);
+	}
+}
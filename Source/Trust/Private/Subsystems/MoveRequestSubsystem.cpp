@@ -0,0 +1,281 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Subsystems/MoveRequestSubsystem.h"
+
+#include "AIController.h"
+#include "Blueprint/AIBlueprintHelperLibrary.h"
+#include "Engine/World.h"
+#include "GameFramework/Controller.h"
+#include "GameFramework/Pawn.h"
+#include "HAL/IConsoleManager.h"
+#include "NavigationData.h"
+#include "Navigation/PathFollowingComponent.h"
+#include "NavigationSystem.h"
+#include "Trust/Trust.h"
+
+static TAutoConsoleVariable<int32> CVarThrottleMoveRequests(
+	TEXT("Trust.Move.Throttle"),
+	1,
+	TEXT("0: every move request pathfinds straight away.\n")
+	TEXT("1: move requests are dropped, reuse the current path or are queued and spread across frames."),
+	ECVF_Cheat);
+
+static TAutoConsoleVariable<float> CVarRepathTolerance(
+	TEXT("Trust.Move.RepathTolerance"),
+	100.f,
+	TEXT("Distance a destination has to move from the one being followed before the path is updated."),
+	ECVF_Cheat);
+
+static TAutoConsoleVariable<float> CVarPathReuseTolerance(
+	TEXT("Trust.Move.PathReuseTolerance"),
+	50.f,
+	TEXT("Distance from the followed path within which a new destination cuts the path short instead of pathfinding."),
+	ECVF_Cheat);
+
+static TAutoConsoleVariable<float> CVarMinRepathInterval(
+	TEXT("Trust.Move.MinRepathInterval"),
+	0.25f,
+	TEXT("Seconds a controller waits between pathfinds, newer destinations replace the queued one meanwhile."),
+	ECVF_Cheat);
+
+static TAutoConsoleVariable<int32> CVarMaxPathfindsPerFrame(
+	TEXT("Trust.Move.MaxPathfindsPerFrame"),
+	4,
+	TEXT("Queued move requests pathfound per frame across all controllers, the rest wait for the next frame."),
+	ECVF_Cheat);
+
+DECLARE_CYCLE_STAT(TEXT("Move Requests Tick"), STAT_MoveRequestsTick, STATGROUP_Trust);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Move Pathfinds"), STAT_MovePathfinds, STATGROUP_Trust);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Move Paths Reused"), STAT_MovePathsReused, STATGROUP_Trust);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Move Requests Skipped"), STAT_MoveRequestsSkipped, STATGROUP_Trust);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Move Requests Queued"), STAT_MoveRequestsQueued, STATGROUP_Trust);
+
+bool UMoveRequestSubsystem::DoesSupportWorldType(EWorldType::Type WorldType) const {
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UMoveRequestSubsystem::OnWorldBeginPlay(UWorld& InWorld) {
+	Super::OnWorldBeginPlay(InWorld);
+
+	//The navigation system is only certain to exist by now
+	if (UNavigationSystemV1* NavigationSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(&InWorld)) {
+		NavigationSystem->OnNavigationGenerationFinishedDelegate.AddDynamic(this, &UMoveRequestSubsystem::OnNavigationGenerationFinished);
+	}
+}
+
+void UMoveRequestSubsystem::Deinitialize() {
+	if (UNavigationSystemV1* NavigationSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld())) {
+		NavigationSystem->OnNavigationGenerationFinishedDelegate.RemoveDynamic(this, &UMoveRequestSubsystem::OnNavigationGenerationFinished);
+	}
+
+	Super::Deinitialize();
+}
+
+void UMoveRequestSubsystem::RequestMove(AController* Controller, const FVector& Destination) {
+	if (!Controller) {
+		return;
+	}
+
+	if (CVarThrottleMoveRequests.GetValueOnGameThread() == 0) {
+		Pathfind(Controller, Destination);
+		return;
+	}
+
+	FMoveRequest* Request = Requests.Find(Controller);
+	if (!Request) {
+		//New controllers are rare, a good time to forget those that are gone
+		for (auto It = Requests.CreateIterator(); It; ++It) {
+			if (!It.Key().IsValid()) {
+				It.RemoveCurrent();
+			}
+		}
+		Request = &Requests.Add(Controller);
+	}
+
+	if (IsAlreadyMovingTo(Controller, *Request, Destination)) {
+		Request->bPending = false;
+		++NumSkippedRequests;
+		INC_DWORD_STAT(STAT_MoveRequestsSkipped);
+		return;
+	}
+
+	if (TryReusePath(Controller, Destination)) {
+		Request->IssuedDestination = Destination;
+		Request->bHasIssued = true;
+		Request->bPending = false;
+		Request->bFollowingReusedPath = true;
+		++NumReusedPaths;
+		INC_DWORD_STAT(STAT_MovePathsReused);
+		return;
+	}
+
+	QueueRequest(Controller, *Request, Destination);
+}
+
+void UMoveRequestSubsystem::QueueRequest(AController* Controller, FMoveRequest& Request, const FVector& Destination) {
+	Request.Destination = Destination;
+	if (!Request.bPending) {
+		Request.bPending = true;
+		PendingQueue.AddUnique(Controller);
+		SET_DWORD_STAT(STAT_MoveRequestsQueued, PendingQueue.Num());
+	}
+}
+
+void UMoveRequestSubsystem::OnNavigationGenerationFinished(ANavigationData* NavData) {
+	for (TPair<TWeakObjectPtr<AController>, FMoveRequest>& Request : Requests) {
+		AController* Controller = Request.Key.Get();
+		if (!Controller || !Request.Value.bFollowingReusedPath) {
+			continue;
+		}
+
+		//Arrived or stopped meanwhile, nothing left to fix
+		const UPathFollowingComponent* PathFollowing = Controller->FindComponentByClass<UPathFollowingComponent>();
+		Request.Value.bFollowingReusedPath = false;
+		if (PathFollowing && PathFollowing->GetStatus() == EPathFollowingStatus::Moving) {
+			QueueRequest(Controller, Request.Value, Request.Value.IssuedDestination);
+		}
+	}
+}
+
+bool UMoveRequestSubsystem::IsAlreadyMovingTo(const AController* Controller, const FMoveRequest& Request, const FVector& Destination) const {
+	const UPathFollowingComponent* PathFollowing = Controller->FindComponentByClass<UPathFollowingComponent>();
+	return Request.bHasIssued && PathFollowing && PathFollowing->GetStatus() == EPathFollowingStatus::Moving
+		&& FVector::DistSquared2D(Request.IssuedDestination, Destination) <= FMath::Square(CVarRepathTolerance.GetValueOnGameThread());
+}
+
+bool UMoveRequestSubsystem::TryReusePath(AController* Controller, const FVector& Destination) const {
+	UPathFollowingComponent* PathFollowing = Controller->FindComponentByClass<UPathFollowingComponent>();
+	const APawn* Pawn = Controller->GetPawn();
+	if (!Pawn || !PathFollowing || PathFollowing->GetStatus() != EPathFollowingStatus::Moving) {
+		return false;
+	}
+
+	const FNavPathSharedPtr Path = PathFollowing->GetPath();
+	//A path already invalidated by a navmesh change is about to be replaced, cutting it short would keep it stale
+	if (!Path.IsValid() || !Path->IsValid() || !Path->IsUpToDate() || Path->IsPartial()) {
+		return false;
+	}
+
+	//Only what's still ahead of the pawn counts, starting from where it is now
+	const TArray<FNavPathPoint>& PathPoints = Path->GetPathPoints();
+	const int32 NextIndex = PathFollowing->GetNextPathIndex();
+	if (!PathPoints.IsValidIndex(NextIndex)) {
+		return false;
+	}
+
+	const float ReuseToleranceSquared = FMath::Square(CVarPathReuseTolerance.GetValueOnGameThread());
+	FVector SegmentStart = Pawn->GetNavAgentLocation();
+	for (int32 i = NextIndex; i < PathPoints.Num(); ++i) {
+		const FVector SegmentEnd = PathPoints[i].Location;
+		const FVector ClosestPoint = FMath::ClosestPointOnSegment(Destination, SegmentStart, SegmentEnd);
+
+		if (FVector::DistSquared(ClosestPoint, Destination) <= ReuseToleranceSquared) {
+			TArray<FVector> TrimmedPoints;
+			TrimmedPoints.Add(Pawn->GetNavAgentLocation());
+			for (int32 j = NextIndex; j < i; ++j) {
+				TrimmedPoints.Add(PathPoints[j].Location);
+			}
+			TrimmedPoints.Add(ClosestPoint);
+
+			FNavPathSharedPtr TrimmedPath = MakeShareable(new FNavigationPath(TrimmedPoints));
+			TrimmedPath->SetNavigationDataUsed(Path->GetNavigationDataUsed());
+
+			FAIMoveRequest MoveRequest(ClosestPoint);
+			MoveRequest.SetUsePathfinding(true);
+			return PathFollowing->RequestMove(MoveRequest, TrimmedPath).IsValid();
+		}
+
+		SegmentStart = SegmentEnd;
+	}
+
+	return false;
+}
+
+void UMoveRequestSubsystem::Pathfind(AController* Controller, const FVector& Destination) {
+	if (AAIController* AIController = Cast<AAIController>(Controller)) {
+		AIController->MoveToLocation(Destination);
+	} else {
+		UAIBlueprintHelperLibrary::SimpleMoveToLocation(Controller, Destination);
+	}
+
+	++NumPathfinds;
+	INC_DWORD_STAT(STAT_MovePathfinds);
+}
+
+void UMoveRequestSubsystem::Tick(float DeltaTime) {
+	SCOPE_CYCLE_COUNTER(STAT_MoveRequestsTick);
+
+	const double Now = GetWorld()->GetTimeSeconds();
+	const float MinRepathInterval = CVarMinRepathInterval.GetValueOnGameThread();
+	int32 Budget = FMath::Max(CVarMaxPathfindsPerFrame.GetValueOnGameThread(), 1);
+
+	for (int32 i = 0; i < PendingQueue.Num() && Budget > 0;) {
+		AController* Controller = PendingQueue[i].Get();
+		FMoveRequest* Request = Controller ? Requests.Find(Controller) : nullptr;
+		if (!Request || !Request->bPending) {
+			PendingQueue.RemoveAt(i);
+			continue;
+		}
+
+		//Still waiting out its interval, keeps its place in the queue
+		if (Now - Request->LastPathfindTime < MinRepathInterval) {
+			++i;
+			continue;
+		}
+
+		Pathfind(Controller, Request->Destination);
+		Request->LastPathfindTime = Now;
+		Request->IssuedDestination = Request->Destination;
+		Request->bHasIssued = true;
+		Request->bPending = false;
+		Request->bFollowingReusedPath = false;
+		PendingQueue.RemoveAt(i);
+		--Budget;
+	}
+
+	SET_DWORD_STAT(STAT_MoveRequestsQueued, PendingQueue.Num());
+}
+
+void UMoveRequestSubsystem::LogStats(const bool bReset) {
+	const double Now = GetWorld()->GetTimeSeconds();
+	const double Seconds = FMath::Max(Now - StatsStartTime, 0.001);
+
+	UE_LOG(LogTrust, Display, TEXT("Move requests over %.1f s (throttle %s): %.1f nav queries/s, %d pathfinds, %d paths reused, %d requests skipped, %d queued"),
+		Seconds, CVarThrottleMoveRequests.GetValueOnGameThread() != 0 ? TEXT("on") : TEXT("off"), NumPathfinds / Seconds, NumPathfinds, NumReusedPaths, NumSkippedRequests, PendingQueue.Num());
+
+	if (bReset) {
+		NumPathfinds = 0;
+		NumReusedPaths = 0;
+		NumSkippedRequests = 0;
+		StatsStartTime = Now;
+	}
+}
+
+bool UMoveRequestSubsystem::IsTickable() const {
+	return PendingQueue.Num() > 0;
+}
+
+ETickableTickType UMoveRequestSubsystem::GetTickableTickType() const {
+	return HasAnyFlags(RF_ClassDefaultObject) ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+UWorld* UMoveRequestSubsystem::GetTickableGameObjectWorld() const {
+	return GetWorld();
+}
+
+TStatId UMoveRequestSubsystem::GetStatId() const {
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UMoveRequestSubsystem, STATGROUP_Tickables);
+}
+
+#if !UE_BUILD_SHIPPING
+static void LogMoveRequestStats(const TArray<FString>& Args, UWorld* World) {
+	if (UMoveRequestSubsystem* MoveRequests = World ? World->GetSubsystem<UMoveRequestSubsystem>() : nullptr) {
+		MoveRequests->LogStats(Args.Num() > 0 && Args[0] == TEXT("reset"));
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs MoveRequestStatsCommand(
+	TEXT("Trust.Move.Stats"),
+	TEXT("Logs nav queries per second from move requests since the last reset. Args: [reset]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&LogMoveRequestStats));
+#endif
@@ -0,0 +1,92 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Widgets/InteractionPromptPool.h"
+
+#include "Components/InteractionComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "Widgets/InteractionWidget.h"
+
+void UInteractionPromptPool::Initialize(APlayerController* InOwningPlayer, TSubclassOf<UInteractionWidget> InDefaultPromptClass) {
+	OwningPlayer = InOwningPlayer;
+	DefaultPromptClass = InDefaultPromptClass;
+}
+
+UInteractionWidget* UInteractionPromptPool::ShowPrompt(UInteractionComponent* Interactable) {
+	if (!Interactable || !OwningPlayer) {
+		return nullptr;
+	}
+
+	if (UInteractionWidget* ExistingPrompt = Interactable->GetPromptWidget()) {
+		return ExistingPrompt;
+	}
+
+	const TSubclassOf<UInteractionWidget> PromptClass = Interactable->GetPromptWidgetClass() ? Interactable->GetPromptWidgetClass() : DefaultPromptClass;
+	if (!PromptClass) {
+		return nullptr;
+	}
+
+	UInteractionWidget* Prompt = nullptr;
+	const int32 IdleIndex = IdlePrompts.IndexOfByPredicate([&PromptClass](const UInteractionWidget* IdlePrompt) { return IdlePrompt->GetClass() == PromptClass; });
+	if (IdleIndex != INDEX_NONE) {
+		Prompt = IdlePrompts[IdleIndex];
+		IdlePrompts.RemoveAtSwap(IdleIndex);
+	} else {
+		Prompt = CreateWidget<UInteractionWidget>(OwningPlayer, PromptClass);
+		if (!Prompt) {
+			return nullptr;
+		}
+
+		//Centered on the interactable, like the screen space widget component it replaces
+		Prompt->SetAlignmentInViewport(FVector2D(0.5f, 0.5f));
+		Prompt->AddToPlayerScreen();
+	}
+
+	ActivePrompts.Add(Prompt);
+	Interactable->SetPromptWidget(Prompt);
+	Prompt->UpdateInteractionWidget(Interactable);
+	Prompt->SetVisibility(ESlateVisibility::HitTestInvisible);
+
+	UpdatePrompts();
+	return Prompt;
+}
+
+void UInteractionPromptPool::HidePrompt(UInteractionComponent* Interactable) {
+	const int32 ActiveIndex = ActivePrompts.IndexOfByPredicate([Interactable](const UInteractionWidget* Prompt) { return Prompt->OwningInteractionComponent == Interactable; });
+	if (ActiveIndex != INDEX_NONE) {
+		ReleasePrompt(ActiveIndex);
+	}
+}
+
+void UInteractionPromptPool::UpdatePrompts() {
+	for (int32 i = ActivePrompts.Num() - 1; i >= 0; --i) {
+		UInteractionWidget* Prompt = ActivePrompts[i];
+		const UInteractionComponent* Interactable = Prompt->OwningInteractionComponent;
+		if (!IsValid(Interactable)) {
+			ReleasePrompt(i);
+			continue;
+		}
+
+		FVector2D ScreenPosition;
+		if (OwningPlayer->ProjectWorldLocationToScreen(Interactable->GetComponentLocation(), ScreenPosition, true)) {
+			Prompt->SetPositionInViewport(ScreenPosition);
+			Prompt->SetVisibility(ESlateVisibility::HitTestInvisible);
+		} else {
+			//Behind the camera
+			Prompt->SetVisibility(ESlateVisibility::Collapsed);
+		}
+	}
+}
+
+void UInteractionPromptPool::ReleasePrompt(const int32 ActiveIndex) {
+	UInteractionWidget* Prompt = ActivePrompts[ActiveIndex];
+	ActivePrompts.RemoveAtSwap(ActiveIndex);
+
+	if (UInteractionComponent* Interactable = Prompt->OwningInteractionComponent) {
+		if (Interactable->GetPromptWidget() == Prompt) {
+			Interactable->SetPromptWidget(nullptr);
+		}
+	}
+
+	Prompt->SetVisibility(ESlateVisibility::Collapsed);
+	IdlePrompts.Add(Prompt);
+}
@@ -3,7 +3,45 @@
 
 #include "Widgets/InteractionWidget.h"
 
+#include "Engine/World.h"
+
+UInteractionWidget::UInteractionWidget(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer) {
+	InteractProgressStartTime = -1.f;
+	InteractProgressDuration = 0.f;
+}
+
 void UInteractionWidget::UpdateInteractionWidget(UInteractionComponent* InteractionComponent) {
+	//Pooled prompts move between interactables, a hold on the previous one doesn't carry over
+	if (OwningInteractionComponent != InteractionComponent) {
+		InteractProgressStartTime = -1.f;
+	}
+
 	OwningInteractionComponent = InteractionComponent;
 	OnUpdateInteractionWidget();
 }
+
+float UInteractionWidget::GetInteractProgress() const {
+	if (InteractProgressStartTime < 0.f || InteractProgressDuration <= 0.f || !GetWorld()) {
+		return 0.f;
+	}
+	return FMath::Clamp((GetWorld()->GetTimeSeconds() - InteractProgressStartTime) / InteractProgressDuration, 0.f, 1.f);
+}
+
+void UInteractionWidget::BeginInteractProgress(const float StartTime, const float Duration) {
+	InteractProgressStartTime = StartTime;
+	InteractProgressDuration = Duration;
+	OnInteractProgressStarted(Duration);
+}
+
+void UInteractionWidget::EndInteractProgress(const bool bCompleted) {
+	if (InteractProgressStartTime < 0.f) {
+		return;
+	}
+
+	InteractProgressStartTime = -1.f;
+	if (bCompleted) {
+		OnInteractProgressCompleted();
+	} else {
+		OnInteractProgressCancelled();
+	}
+}
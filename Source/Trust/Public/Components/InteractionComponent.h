@@ -1,7 +1,7 @@
 #pragma once
 
 #include "CoreMinimal.h"
-#include "Components/WidgetComponent.h"
+#include "Components/SceneComponent.h"
 #include "InteractionComponent.generated.h"
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnBeginInteract, class ATrustCharacter*, Character);
@@ -9,10 +9,16 @@ DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnEndInteract, class ATrustCharacte
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnBeginFocus, class ATrustCharacter*, Character);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnEndFocus, class ATrustCharacter*, Character);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnInteract, class ATrustCharacter*, Character);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnPredictInteract, class ATrustCharacter*, Character);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnPredictedInteractRejected, class ATrustCharacter*, Character);
 
 
+/**
+ * Marks its owner as something players can focus and interact with. Carries no widget of its own, the local player's
+ * UInteractionPromptPool shows a prompt at this component's location while it is focused.
+ */
 UCLASS(ClassGroup = (Custom), meta = (BlueprintSpawnableComponent))
-class TRUST_API UInteractionComponent : public UWidgetComponent {
+class TRUST_API UInteractionComponent : public USceneComponent {
 	GENERATED_BODY()
 
 public:
@@ -34,6 +40,14 @@ public:
 
     UPROPERTY(EditDefaultsOnly, BlueprintAssignable)
     FOnInteract OnInteract;
+
+    /**Fired on the interacting client when it predicts the interaction. Pickups add their provisional stack here through
+     * UInventoryComponent::AddPredictedItem, with their owner as the source*/
+    UPROPERTY(EditDefaultsOnly, BlueprintAssignable)
+    FOnPredictInteract OnPredictInteract;
+
+    UPROPERTY(EditDefaultsOnly, BlueprintAssignable)
+    FOnPredictedInteractRejected OnPredictedInteractRejected;
     
 protected:
     UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Interaction")
@@ -50,10 +64,28 @@ protected:
     
     UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Interaction")
     bool bAllowMultipleInteractions;
+
+    /**The interacting client hides the owner straight away instead of waiting for the server. Only for instant
+     * interactions whose owner is destroyed when they succeed, like pickups. OnInteract listeners that don't go through
+     * with it call RefuseInteract, anything refused or left standing is rolled back*/
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Interaction")
+    bool bPredictInteraction;
+
+    /**Prompt shown while focused, the player controller's default prompt if not set*/
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Interaction")
+    TSubclassOf<class UInteractionWidget> PromptWidgetClass;
+    
+    /**Custom depth stencil written to the owner's primitives while focused, 0 leaves their own stencil alone*/
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Interaction", meta = (ClampMin = 0, ClampMax = 255))
+    int32 OutlineStencilValue;
     
     UPROPERTY()
     TArray<ATrustCharacter*> Interactors;
 
+    /**World time each interactor started holding at, published once so progress never has to ask the interactor's timer*/
+    UPROPERTY()
+    TMap<ATrustCharacter*, float> InteractStartTimes;
+
 public:
     void RefreshWidget();
     
@@ -63,11 +95,31 @@ public:
     void BeginInteract(class ATrustCharacter *Character);
     void EndInteract(class ATrustCharacter *Character);
 
-    void Interact(class ATrustCharacter *Character);
+    /**Fires OnInteract if Character can interact. True if it fired and no listener refused it*/
+    bool Interact(class ATrustCharacter *Character);
+
+    /**For OnInteract listeners, marks the interaction being fired as not carried out, like a pickup that didn't fit*/
+    UFUNCTION(BlueprintCallable, Category = "Interaction")
+    void RefuseInteract();
+
+    FORCEINLINE bool IsInteractionPredicted() const { return bPredictInteraction; }
 
+    bool CanPredictInteract(class ATrustCharacter *Character) const;
+
+    /**Client only. Hides the owner as if the interaction already succeeded and lets listeners predict its result*/
+    void PredictInteract(class ATrustCharacter *Character);
+
+    /**Client only. Shows the owner again after the server rejected the predicted interaction*/
+    void RollbackPredictedInteract(class ATrustCharacter *Character);
+
+    /**Hold progress of the first interactor. Prompts should prefer UInteractionWidget::GetInteractProgress*/
     UFUNCTION(BlueprintPure, Category = "Interaction")
     float GetInteractPercentage();
 
+    /**Hold progress of the given interactor, 0 if it isn't holding*/
+    UFUNCTION(BlueprintPure, Category = "Interaction")
+    float GetInteractPercentageFor(class ATrustCharacter *Character) const;
+
     UFUNCTION(BlueprintPure, Category = "Interaction")
     float GetInteractionDistance() const;
 
@@ -84,8 +136,52 @@ public:
     UFUNCTION(BlueprintCallable, Category = "Interaction")
     void SetInteractableActionText(const FText &NewActionText);
 
+    FORCEINLINE int32 GetOutlineStencilValue() const { return OutlineStencilValue; }
+
+    FORCEINLINE TSubclassOf<class UInteractionWidget> GetPromptWidgetClass() const { return PromptWidgetClass; }
+
+    /**The pooled prompt currently showing this interactable, if it is focused by a local player*/
+    UFUNCTION(BlueprintPure, Category = "Interaction")
+    class UInteractionWidget* GetPromptWidget() const;
+
+    //Only the prompt pool assigns and clears prompts
+    void SetPromptWidget(class UInteractionWidget* NewPromptWidget);
+
+    /**The owner's primitives that get outlined on focus. Gathered once and gathered again when the owner's components change*/
+    const TArray<TWeakObjectPtr<UPrimitiveComponent>>& GetOutlinePrimitives();
+
+    //Call after swapping meshes on the owner without adding or removing a component
+    void InvalidateOutlinePrimitives();
+
 protected:
+    virtual void OnRegister() override;
+    virtual void OnUnregister() override;
+    virtual void OnUpdateTransform(EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport = ETeleportType::None) override;
+    virtual void Activate(bool bReset = false) override;
     virtual void Deactivate() override;
 
     bool CanInteract(class ATrustCharacter *Character) const;
+
+private:
+    void SetOutlined(const bool bOutlined);
+
+    //Shows or hides the local player's prompt for this interactable, if the character is locally controlled
+    void SetPromptVisible(class ATrustCharacter *Character, const bool bVisible);
+
+    //Stops tracking the interactor's hold and tells a locally controlled interactor's prompt how it ended
+    void FinishInteractProgress(class ATrustCharacter *Character, const bool bCompleted);
+
+    TWeakObjectPtr<class UInteractionWidget> PromptWidget;
+
+    uint8 bOwnerHiddenByPrediction : 1;
+
+    uint8 bOwnerCollisionBeforePrediction : 1;
+
+    //Set by RefuseInteract while OnInteract is broadcasting
+    uint8 bInteractRefused : 1;
+
+    TArray<TWeakObjectPtr<UPrimitiveComponent>> OutlinePrimitives;
+
+    //Owner component count OutlinePrimitives was gathered at, INDEX_NONE when it has to be gathered again
+    int32 OutlineOwnerComponentCount;
 };
@@ -5,16 +5,112 @@
 #include "CoreMinimal.h"
 #include "Trust/Public/Items/Item.h"
 #include "Components/ActorComponent.h"
+#include "Components/InventoryItemIndex.h"
+#include "Components/InventoryList.h"
+#include "Components/InventorySnapshot.h"
+#include "Components/InventoryViewCache.h"
 #include "InventoryComponent.generated.h"
 
 
-//Called when the inventory is changed and the UI needs an update. 
+//Called when the inventory is changed and the UI needs an update. Changes are collected and broadcast at most once per frame
 DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnInventoryUpdated);
 
 /**Called on server when an item is added to this inventory*/
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnItemAdded, class UItem*, Item);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnItemRemoved, class UItem*, Item);
 
+/**Called on clients using delta replication when a single stack in this inventory changes*/
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnItemChanged, class UItem*, Item);
+
+/**Compact stacks have no UItem, so adding or removing one is reported by class instead of through OnItemAdded and OnItemRemoved*/
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnCompactStackAdded, TSubclassOf<class UItem>, ItemClass);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnCompactStackRemoved, TSubclassOf<class UItem>, ItemClass);
+
+UENUM(BlueprintType)
+enum class EInventoryChangeType : uint8 {
+	ICT_Added UMETA(DisplayName = "Added"),
+	ICT_Removed UMETA(DisplayName = "Removed"),
+	ICT_Changed UMETA(DisplayName = "Changed"),
+	ICT_Capacity UMETA(DisplayName = "Capacity")
+};
+
+//Everything that changed in an inventory since the last OnInventoryChanged, merged so each item only shows up once
+USTRUCT(BlueprintType)
+struct FInventoryChangeSummary {
+
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(BlueprintReadOnly, Category = "Inventory Change Summary")
+	TArray<UItem*> AddedItems;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Inventory Change Summary")
+	TArray<UItem*> RemovedItems;
+
+	//Items whose quantity changed that weren't also added or removed in the same window
+	UPROPERTY(BlueprintReadOnly, Category = "Inventory Change Summary")
+	TArray<UItem*> ChangedItems;
+
+	//Class of every stack touched, including compact stacks and refreshes that didn't say which item changed
+	UPROPERTY(BlueprintReadOnly, Category = "Inventory Change Summary")
+	TArray<TSubclassOf<UItem>> ChangedClasses;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Inventory Change Summary")
+	bool bCapacityChanged = false;
+
+	//How many individual changes were merged into this summary
+	UPROPERTY(BlueprintReadOnly, Category = "Inventory Change Summary")
+	int32 NumChanges = 0;
+
+	void Record(const EInventoryChangeType ChangeType, UItem* Item, TSubclassOf<UItem> ItemClass);
+
+	void Reset();
+
+	FORCEINLINE bool HasStructuralChanges() const { return AddedItems.Num() > 0 || RemovedItems.Num() > 0; }
+};
+
+/**Called once per notification window with everything that changed in it*/
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnInventoryChanged, const FInventoryChangeSummary&, Summary);
+
+//Running totals for the notification scheduler. Requested minus broadcast is how many notifications were coalesced
+USTRUCT(BlueprintType)
+struct FInventoryNotificationCounters {
+
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(BlueprintReadOnly, Category = "Inventory Notification Counters")
+	int32 NotificationsRequested = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Inventory Notification Counters")
+	int32 NotificationsBroadcast = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Inventory Notification Counters")
+	int32 ClientRefreshesRequested = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Inventory Notification Counters")
+	int32 ClientRefreshesSent = 0;
+};
+
+/**A stack the client shows before the server confirms it, see UInventoryComponent::AddPredictedItem*/
+USTRUCT()
+struct FPredictedInventoryItem {
+	GENERATED_BODY()
+
+public:
+	UPROPERTY()
+	UItem* Item = nullptr;
+
+	//What granted the item, usually a pickup, so a rejected interaction rolls back only its own items
+	TWeakObjectPtr<const UObject> Source;
+
+	//The character's prediction that added the item, 0 if it was added outside of one
+	uint16 PredictionId = 0;
+
+	//Set once the server confirmed PredictionId, only then does a stack of the item's class arriving replace it
+	bool bConfirmed = false;
+};
+
 // TODO: Move to own file
 UENUM(BlueprintType)
 enum class EItemAddResult : uint8 {
@@ -78,6 +174,26 @@ public:
 };
 
 
+//One entry of a batched add or remove. Item takes priority over ItemClass when both are set
+USTRUCT(BlueprintType)
+struct FInventoryItemRequest {
+
+	GENERATED_BODY()
+
+public:
+	FInventoryItemRequest() {};
+	FInventoryItemRequest(TSubclassOf<UItem> InItemClass, const int32 InQuantity) : ItemClass(InItemClass), Quantity(InQuantity) {};
+	FInventoryItemRequest(UItem* InItem, const int32 InQuantity) : Item(InItem), Quantity(InQuantity) {};
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Inventory Item Request")
+	TSubclassOf<UItem> ItemClass;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Inventory Item Request")
+	UItem* Item = nullptr;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Inventory Item Request")
+	int32 Quantity = 1;
+};
 
 UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
 class TRUST_API UInventoryComponent : public UActorComponent {
@@ -90,6 +206,22 @@ private:
 	UPROPERTY()
 	int32 ReplicatedItemsKey;
 
+	//While above zero, UI notifications, client refreshes and replication key bumps are held back until the batch ends
+	int32 BatchDepth;
+
+	//Changes since the last flush, handed to OnInventoryChanged when the notification tick runs
+	UPROPERTY(Transient)
+	FInventoryChangeSummary PendingChanges;
+
+	FInventoryNotificationCounters NotificationCounters;
+
+	//Running total of the time spent in ReplicateSubobjects, for the benchmarks to turn into a cost per frame
+	uint64 ReplicateSubobjectsCycles;
+
+	uint8 bPendingInventoryUpdate : 1;
+	uint8 bPendingClientRefresh : 1;
+	uint8 bPendingItemsKeyBump : 1;
+
 protected:
 	UPROPERTY(BlueprintAssignable, Category = "Inventory")
 	FOnInventoryUpdated OnInventoryUpdated;
@@ -100,6 +232,23 @@ protected:
 	UPROPERTY(BlueprintAssignable, Category = "Inventory")
 	FOnItemRemoved OnItemRemoved;
 
+	UPROPERTY(BlueprintAssignable, Category = "Inventory")
+	FOnItemChanged OnItemChanged;
+
+	UPROPERTY(BlueprintAssignable, Category = "Inventory")
+	FOnCompactStackAdded OnCompactStackAdded;
+
+	UPROPERTY(BlueprintAssignable, Category = "Inventory")
+	FOnCompactStackRemoved OnCompactStackRemoved;
+
+	/**Like OnInventoryUpdated, but says what changed. Both fire at most once per notification window*/
+	UPROPERTY(BlueprintAssignable, Category = "Inventory")
+	FOnInventoryChanged OnInventoryChanged;
+
+	/**Seconds to collect changes before notifying the UI and refreshing clients. Zero notifies once at the end of the frame*/
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Inventory", meta = (ClampMin = 0))
+	float NotificationInterval;
+
 	//The maximum weight the inventory can hold. For players, backpacks and other items increase this limit
     UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Inventory")
     float WeightCapacity;
@@ -108,41 +257,165 @@ protected:
     UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Inventory", meta = (ClampMin = 0, ClampMax = 200))
     int32 Capacity;
 
+    /**If true the inventory replicates per stack deltas through InventoryList instead of resending the whole Items array*/
+    UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Inventory|Replication")
+    bool bUseDeltaReplication;
+
     /**The items currently in our inventory*/
     UPROPERTY(ReplicatedUsing = OnRep_Items, VisibleAnywhere, Category = "Inventory")
     TArray<UItem*> Items;
 
+    /**Delta replicated mirror of Items, only kept up to date when bUseDeltaReplication is set. Also the only storage for compact stacks*/
+    UPROPERTY(Replicated)
+    FInventoryList InventoryList;
+
+    /**Stack views, UItem stand ins for compact stacks, created the first time a lookup returns the stack. They are kept
+     * out of Items and ItemIndex, where the stack stays compact, and mirror its quantity*/
+    UPROPERTY(Transient)
+    TArray<UItem*> CompactStackViews;
+
 	UPROPERTY()
     TArray<UItem*> ClientLastReceivedItems;
 
+	/**Client only. Provisional stacks, oldest first. Confirmed ones are dropped when the server's inventory arrives with their class*/
+	UPROPERTY(Transient)
+	TArray<FPredictedInventoryItem> PredictedItems;
+
+	//Prediction that provisional stacks added right now belong to, see BeginPredictedItems
+	uint16 ActivePredictionId;
+
+	/**Class lookups and running weight for Items, kept up to date on every add, remove and quantity change*/
+	FInventoryItemIndex ItemIndex;
+
+	//Classes whose visuals this inventory holds a streaming request on
+	TSet<const UClass*> StreamedItemClasses;
+
+	/**Sorted and filtered views for UI, built on first use and patched alongside ItemIndex*/
+	mutable FInventoryViewCache ItemViews;
+
 public:
 	UFUNCTION(BlueprintCallable, Category = "Inventory")
     FItemAddResult TryAddItem(UItem* Item);
 
+	/**Asking for more than one stack holds adds what fits and reports a partial add of the full Quantity*/
 	UFUNCTION(BlueprintCallable, Category = "Inventory")
     FItemAddResult TryAddItemFromClass(TSubclassOf<UItem> ItemClass, const int32 Quantity = 1);
 
+	/**Adds every request with a single capacity and weight check, one replication update and one OnInventoryUpdated.
+	 * With bAllOrNothing nothing is added unless every request fits completely*/
+	UFUNCTION(BlueprintCallable, Category = "Inventory")
+	TArray<FItemAddResult> TryAddItems(const TArray<FInventoryItemRequest>& Requests, const bool bAllOrNothing = false);
+
+	/**Consumes every request with one replication update and one OnInventoryUpdated. Returns the quantity removed per request.
+	 * With bAllOrNothing nothing is removed unless the inventory holds enough for every request*/
+	UFUNCTION(BlueprintCallable, Category = "Inventory")
+	TArray<int32> RemoveItems(const TArray<FInventoryItemRequest>& Requests, const bool bAllOrNothing = false);
+
+	/**Server only. Moves up to Quantity of Item into Destination. A whole stack that doesn't merge into one of Destination's stacks
+	 * moves as the same UItem, so nothing is reallocated and per item state survives. Returns the quantity moved*/
+	UFUNCTION(BlueprintCallable, Category = "Inventory")
+	int32 TransferItem(UItem* Item, UInventoryComponent* Destination, const int32 Quantity);
+
+	/**Moves every request into Destination with one replication update per inventory. Returns the quantity moved per request.
+	 * With bAllOrNothing nothing moves unless this inventory holds every request and Destination can fit all of it*/
+	UFUNCTION(BlueprintCallable, Category = "Inventory")
+	TArray<int32> TransferItems(const TArray<FInventoryItemRequest>& Requests, UInventoryComponent* Destination, const bool bAllOrNothing = true);
+
+	/**Server only. Swaps OfferA from InventoryA with OfferB from InventoryB, or changes nothing if either side is missing what it
+	 * offered or can't fit what it receives once its own offer is gone*/
+	UFUNCTION(BlueprintCallable, Category = "Inventory")
+	static bool CommitTrade(UInventoryComponent* InventoryA, const TArray<FInventoryItemRequest>& OfferA, UInventoryComponent* InventoryB, const TArray<FInventoryItemRequest>& OfferB, FText& OutErrorText);
+
+	/**Holds back notifications and replication bumps until the matching EndBatchUpdate. Prefer FInventoryBatchScope*/
+	void BeginBatchUpdate();
+
+	void EndBatchUpdate();
+
 	int32 ConsumeItem(UItem* Item);
 	
 	int32 ConsumeItem(UItem* Item, const int32 Quantity);
 
-	void MarkDirtyForReplication() { ReplicatedItemsKey++; }
+	/**Consumes from the first stack of ItemClass. Works on compact stacks without creating a UItem for them*/
+	int32 ConsumeItemOfClass(TSubclassOf<UItem> ItemClass, const int32 Quantity);
+
+	void MarkDirtyForReplication();
+
+	/**Called by items in this inventory whenever their quantity changes so the cached weight stays correct*/
+	void NotifyItemQuantityChanged(UItem* Item);
+
+#if !UE_BUILD_SHIPPING
+	/**Recomputes the cached lookups and weight from scratch and logs any mismatch*/
+	bool ValidateItemIndex() const;
+#endif
 
 	UFUNCTION(BlueprintCallable, Category = "Inventory")
 	bool RemoveItem(UItem* Item);
 
+	/**Copies every stack into OutSnapshot, compact stacks included, without creating UItems for them.
+	 * OutStackIndices receives the snapshot stack index of each captured UItem*/
+	void CaptureSnapshot(FInventorySnapshot& OutSnapshot, TMap<const UItem*, int32>* OutStackIndices = nullptr) const;
+
+	/**Server only. Replaces the contents with Snapshot as one batch. OutItems receives the created UItem per snapshot stack,
+	 * null for compact stacks and stacks that no longer resolve or fit*/
+	bool RestoreSnapshot(const FInventorySnapshot& Snapshot, TArray<UItem*>* OutItems = nullptr);
+
 	UFUNCTION(BlueprintPure, Category = "Inventory")
 	bool HasItem(TSubclassOf <UItem> ItemClass, const int32 Quantity = 1) const;
 
 	UFUNCTION(BlueprintPure, Category = "Inventory")
 	UItem* FindItem(UItem* Item) const;
 
+	/**True if Item itself is one of this inventory's stacks, not just an item of the same class*/
+	FORCEINLINE bool ContainsItem(const UItem* Item) const { return Item && (ItemIndex.Contains(Item) || (Item->IsStackView() && FindCompactStackView(Item->GetClass()) == Item)); }
+
+	FORCEINLINE bool UsesDeltaReplication() const { return bUseDeltaReplication; }
+
+	/**A compact stack is returned as its stack view, see IsStackView. Using, dropping, removing or moving the view acts on the stack*/
 	UFUNCTION(BlueprintPure, Category = "Inventory")
 	UItem* FindItemByClass(TSubclassOf<class UItem> ItemClass) const;
 
+	/**Like FindItemByClass, but on the server a compact stack of ItemClass becomes a real replicated UItem. Clients get the view*/
+	UFUNCTION(BlueprintCallable, Category = "Inventory")
+	UItem* FindOrMaterializeItemByClass(TSubclassOf<class UItem> ItemClass);
+
+	/**Client only. Shows Quantity of ItemClass as a provisional stack right away, until replication brings a stack of that
+	 * class or RemovePredictedItems rolls it back. Provisional stacks aren't in Items, UI lists them from GetPredictedItems*/
+	UFUNCTION(BlueprintCallable, Category = "Inventory|Prediction")
+	UItem* AddPredictedItem(TSubclassOf<UItem> ItemClass, const int32 Quantity, const UObject* Source);
+
+	/**Rolls back every provisional stack Source granted. Returns how many were removed*/
+	UFUNCTION(BlueprintCallable, Category = "Inventory|Prediction")
+	int32 RemovePredictedItems(const UObject* Source);
+
+	/**Client only. Provisional stacks added until EndPredictedItems belong to PredictionId and are confirmed or rolled back with it*/
+	void BeginPredictedItems(const uint16 PredictionId);
+
+	void EndPredictedItems();
+
+	/**The server carried out PredictionId, so its provisional stacks are replaced as the server's stacks of their classes arrive*/
+	void ConfirmPredictedItems(const uint16 PredictionId);
+
+	/**Returns how many provisional stacks were removed*/
+	int32 RemovePredictedItemsFor(const uint16 PredictionId);
+
+	bool HasPredictedItemsFor(const uint16 PredictionId) const;
+
+	UFUNCTION(BlueprintPure, Category = "Inventory|Prediction")
+	TArray<UItem*> GetPredictedItems() const;
+
+	/**Stacks of ItemClass or a child of it, compact stacks as their stack views. GetStacksOfClass lists them without creating anything*/
 	UFUNCTION(BlueprintPure, Category = "Inventory")
 	TArray<UItem*> FindItemsByClass(TSubclassOf<class UItem> ItemClass) const;
 
+	/**Materializes every compact stack of ItemClass or a child of it, then returns what FindItemsByClass would*/
+	UFUNCTION(BlueprintCallable, Category = "Inventory")
+	TArray<UItem*> FindOrMaterializeItemsByClass(TSubclassOf<class UItem> ItemClass);
+
+	/**Every stack of ItemClass or a child of it as class and quantity, with Item set for stacks that have a UItem.
+	 * Compact stacks are listed as they are, so this never creates objects*/
+	UFUNCTION(BlueprintPure, Category = "Inventory")
+	TArray<FInventoryItemRequest> GetStacksOfClass(TSubclassOf<class UItem> ItemClass) const;
+
 	UFUNCTION(BlueprintPure, Category = "Inventory")
     float GetCurrentWeight() const;
 
@@ -158,11 +431,37 @@ public:
     UFUNCTION(BlueprintPure, Category = "Inventory")
     FORCEINLINE int32 GetCapacity() const { return Capacity; }
 
+    /**Every stack, compact stacks as their stack views, see FindItemsByClass*/
     UFUNCTION(BlueprintPure, Category = "Inventory")
-    FORCEINLINE TArray<UItem*> GetInventoryItems() const { return Items; }
+    TArray<UItem*> GetInventoryItems() const;
 
+    /**Items of FilterClass, or all items, sorted by SortMode. Kept sorted as the inventory changes, so after the first call
+     * for a sort and class this costs nothing and copies nothing. Like FindItemsByClass, compact stacks show up as their
+     * stack views*/
+    const TArray<UItem*>& GetItemView(const EInventorySortMode SortMode, TSubclassOf<UItem> FilterClass = nullptr) const;
+
+    /**Blueprint access to GetItemView. Blueprint copies the result either way, but no sorting happens on the call*/
+    UFUNCTION(BlueprintPure, Category = "Inventory")
+    TArray<UItem*> GetSortedItems(const EInventorySortMode SortMode, TSubclassOf<UItem> FilterClass) const;
+
+    /**Adds a view with an arbitrary filter, maintained the same way as GetItemView. Replaces any view already named ViewName*/
+    void RegisterItemView(const FName ViewName, const EInventorySortMode SortMode, TFunction<bool(const UItem*)> Filter);
+
+    void UnregisterItemView(const FName ViewName);
+
+    /**Null if no view is registered under ViewName*/
+    const TArray<UItem*>* GetNamedItemView(const FName ViewName) const;
+
+    /**Number of stacks in the inventory, including compact stacks that have no UItem yet*/
+    UFUNCTION(BlueprintPure, Category = "Inventory")
+    FORCEINLINE int32 GetNumStacks() const { return ItemIndex.Num(); }
+
+    UFUNCTION(BlueprintPure, Category = "Inventory")
+    FORCEINLINE FInventoryNotificationCounters GetNotificationCounters() const { return NotificationCounters; }
+
+    /**Sent at most once per notification window for quantity changes that don't touch the Items array*/
     UFUNCTION(Client, Reliable)
-    void ClientRefreshInventory();
+    void ClientRefreshInventory(const TArray<TSubclassOf<UItem>>& ChangedClasses);
 
 private:
 	UFUNCTION()
@@ -171,14 +470,120 @@ private:
     UFUNCTION()
     void ItemRemoved(UItem* Item);
 	
-	UItem* AddItem(UItem* Item, const int32 Quantity);
+	UItem* AddItem(TSubclassOf<UItem> ItemClass, const int32 Quantity);
+
+	/**Every UItem an inventory creates comes from here, so the Items Allocated stat covers adds, materializing, views and predictions*/
+	static UItem* NewInventoryItem(UObject* Outer, TSubclassOf<UItem> ItemClass);
 
-	FItemAddResult TryAddItem_Internal(UItem* Item);
+	/**Running total behind Items Allocated, stat counters reset every frame so the benchmarks read this instead*/
+	static uint64 NumItemsAllocated;
+
+	/**Puts an existing item into Items. The item must not be in any other inventory*/
+	void AttachItem(UItem* Item);
+
+	/**Adds an item just removed from Source. Keeps the object unless it merges into a stack here, whatever doesn't fit
+	 * goes back to Source on the same object. Returns the quantity added*/
+	int32 ReceiveItem(UItem* Item, UInventoryComponent* Source);
+
+	/**Removes a validated trade offer. Whole stacks come out as items, everything else as class and quantity*/
+	void TakeItemsForTrade(const TArray<FInventoryItemRequest>& Offer, TArray<UItem*>& OutItems, TArray<FInventoryItemRequest>& OutQuantities);
+
+	/**Template only supplies the class and its settings, so an items class default object works as well as a real item.
+	 * Quantity may be more than a stack holds, the result then says how much of it was added*/
+	FItemAddResult TryAddItem_Internal(const UItem* Template, const int32 Quantity);
+
+	bool UsesCompactStorage(TSubclassOf<UItem> ItemClass) const;
+
+	bool FindStackQuantity(TSubclassOf<UItem> ItemClass, int32& OutQuantity) const;
+
+	void SetStackQuantity(TSubclassOf<UItem> ItemClass, const int32 NewQuantity);
+
+	void AddCompactStack(TSubclassOf<UItem> ItemClass, const int32 Quantity);
+
+	void RemoveCompactStack(TSubclassOf<UItem> ItemClass);
+
+	/**Gives a compact stack a UItem. On the server it becomes a normal replicated item, on clients a local view*/
+	UItem* MaterializeCompactStack(TSubclassOf<UItem> ItemClass);
+
+	/**Materializes every compact stack of ItemClass or a child of it*/
+	void MaterializeCompactStacks(const UClass* ItemClass);
+
+	/**Client only, drops a compact stack replication removed or gave a UItem, and its view*/
+	void RemoveClientCompactStack(TSubclassOf<UItem> ItemClass);
+
+	/**The compact stack's view, created if the stack has none yet. Null if there is no compact stack of exactly ItemClass*/
+	UItem* GetCompactStackView(const UClass* ItemClass) const;
+
+	UItem* FindCompactStackView(const UClass* ItemClass) const;
+
+	void CreateCompactStackViews() const;
+
+	/**Detaches the view once its compact stack is gone or became a real item. Anyone still holding it acts on the class*/
+	void ReleaseCompactStackView(const UClass* ItemClass);
+
+	void PostItemIndexChanged() const;
+
+	/**Everything that used to call OnRep_Items, ClientRefreshInventory or bump ReplicatedItemsKey directly goes through these so batches can merge them.
+	 * Key bumps apply when the batch ends, notifications and client refreshes wait for the next notification tick*/
+	void NotifyInventoryChanged(const EInventoryChangeType ChangeType, UItem* Item = nullptr, TSubclassOf<UItem> ItemClass = nullptr);
+
+	void RequestClientRefresh(TSubclassOf<UItem> ItemClass);
+
+	void MarkItemsKeyDirty();
+
+	void FlushItemsKey();
+
+	void ScheduleNotificationFlush();
+
+	void FlushPendingNotifications();
+
+	/**OutgoingRequests are treated as already removed, for exchanges where both sides give something up*/
+	bool CanAddAll(const TArray<FInventoryItemRequest>& Requests, TArray<FItemAddResult>& OutResults, const TArray<FInventoryItemRequest>* OutgoingRequests = nullptr) const;
+
+	bool CanRemoveAll(const TArray<FInventoryItemRequest>& Requests) const;
 	
 	UFUNCTION()
     void OnRep_Items();
+
+	//Replication brought a stack of ItemClass, so the oldest confirmed provisional stack of that class is no longer needed.
+	//The confirm RPC goes out while the server handles the interaction, ahead of the inventory changes it replicates
+	void ReconcilePredictedItems(const UClass* ItemClass);
+
+	/**Prefetches the visuals of classes that entered the inventory and releases those of classes that left it*/
+	void UpdateItemAssetRequests();
+
+	friend struct FInventoryEntry;
+	friend struct FInventoryBenchmark;
+
+	void OnEntryAdded(const FInventoryEntry& Entry);
+	void OnEntryChanged(const FInventoryEntry& Entry);
+	void OnEntryRemoved(const FInventoryEntry& Entry);
 	
 protected:
+	virtual void PostInitProperties() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
 	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+	virtual void PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker) override;
     virtual bool ReplicateSubobjects(UActorChannel *Channel, FOutBunch *Bunch, FReplicationFlags *RepFlags) override;
 };
+
+/**Batches every inventory change made while in scope into one notification and replication update*/
+struct FInventoryBatchScope {
+
+public:
+	explicit FInventoryBatchScope(UInventoryComponent* InInventory) : Inventory(InInventory) {
+		if (Inventory) {
+			Inventory->BeginBatchUpdate();
+		}
+	}
+
+	~FInventoryBatchScope() {
+		if (Inventory) {
+			Inventory->EndBatchUpdate();
+		}
+	}
+
+private:
+	UInventoryComponent* Inventory;
+};
@@ -0,0 +1,70 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UItem;
+
+/**
+ * Lookup tables kept next to UInventoryComponent::Items so that class lookups and
+ * weight queries don't have to walk every stack. The inventory owns the item references,
+ * this only mirrors them and must be told about every add, remove and quantity change.
+ */
+struct TRUST_API FInventoryItemIndex {
+
+public:
+	FInventoryItemIndex() : TotalWeight(0.f) {}
+
+	void Reset();
+
+	void Rebuild(const TArray<UItem*>& Items);
+
+	void AddItem(UItem* Item);
+
+	void RemoveItem(UItem* Item);
+
+	//Applies the difference between the items current quantity and the quantity the index last saw
+	void UpdateItemQuantity(UItem* Item);
+
+	bool Contains(const UItem* Item) const { return AccountedQuantities.Contains(Item); }
+
+	//Compact stacks have no UItem, they are tracked by class and quantity only
+	void AddCompactStack(const UClass* ItemClass, const int32 Quantity);
+
+	void SetCompactStackQuantity(const UClass* ItemClass, const int32 Quantity);
+
+	void RemoveCompactStack(const UClass* ItemClass);
+
+	bool FindCompactStack(const UClass* ItemClass, int32& OutQuantity) const;
+
+	FORCEINLINE const TMap<const UClass*, int32>& GetCompactStacks() const { return CompactQuantities; }
+
+	//First stack whose class is exactly ItemClass
+	UItem* FindFirstOfClass(const UClass* ItemClass) const;
+
+	//Every stack whose class is ItemClass or a child of it, in inventory order
+	const TArray<UItem*>& FindAllOfClass(const UClass* ItemClass) const;
+
+	FORCEINLINE float GetTotalWeight() const { return TotalWeight; }
+
+	//Number of stacks, with or without a UItem
+	FORCEINLINE int32 Num() const { return AccountedQuantities.Num() + CompactQuantities.Num(); }
+
+	//Recomputes everything from Items and the expected compact stacks and compares it against the incremental state. Returns false and fills OutError on mismatch
+	bool Validate(const TArray<UItem*>& Items, const TMap<const UClass*, int32>& ExpectedCompactStacks, FString& OutError) const;
+
+private:
+	//Stacks keyed by their exact class
+	TMap<const UClass*, TArray<UItem*>> ItemsByClass;
+
+	//Stacks keyed by their class and every parent class up to UItem
+	TMap<const UClass*, TArray<UItem*>> ItemsByAncestorClass;
+
+	//The quantity each stack had when its weight was last added to TotalWeight
+	TMap<const UItem*, int32> AccountedQuantities;
+
+	TMap<const UClass*, int32> CompactQuantities;
+
+	float TotalWeight;
+};
@@ -0,0 +1,97 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Items/Item.h"
+#include "Net/Serialization/FastArraySerializer.h"
+#include "InventoryList.generated.h"
+
+class UInventoryComponent;
+
+enum class EInventoryEntryFlags : uint8 {
+	None = 0,
+	//The stack has no UItem, only ItemClass and Quantity
+	Compact = 1 << 0
+};
+ENUM_CLASS_FLAGS(EInventoryEntryFlags);
+
+/**One stack in a delta replicated inventory. ReplicationID stays the same for the lifetime of the stack*/
+USTRUCT()
+struct FInventoryEntry : public FFastArraySerializerItem {
+
+	GENERATED_BODY()
+
+public:
+	FInventoryEntry() : Item(nullptr), Quantity(0), Flags(0) {}
+	FInventoryEntry(TSubclassOf<UItem> InItemClass, UItem* InItem, const int32 InQuantity, const EInventoryEntryFlags InFlags)
+		: ItemClass(InItemClass), Item(InItem), Quantity(InQuantity), Flags((uint8)InFlags) {}
+
+	UPROPERTY()
+	TSubclassOf<UItem> ItemClass;
+
+	//Null for compact stacks
+	UPROPERTY()
+	UItem* Item;
+
+	//Mirrors Item->Quantity so that a quantity change only resends this entry, not the item subobject
+	UPROPERTY()
+	int32 Quantity;
+
+	UPROPERTY()
+	uint8 Flags;
+
+	FORCEINLINE bool IsCompact() const { return EnumHasAnyFlags((EInventoryEntryFlags)Flags, EInventoryEntryFlags::Compact); }
+
+	void PreReplicatedRemove(const struct FInventoryList& InArraySerializer);
+	void PostReplicatedAdd(const struct FInventoryList& InArraySerializer);
+	void PostReplicatedChange(const struct FInventoryList& InArraySerializer);
+};
+
+/**Fast array mirror of UInventoryComponent::Items, only sends the entries that were added, changed or removed*/
+USTRUCT()
+struct FInventoryList : public FFastArraySerializer {
+
+	GENERATED_BODY()
+
+public:
+	FInventoryList() : OwnerComponent(nullptr) {}
+
+	UPROPERTY()
+	TArray<FInventoryEntry> Entries;
+
+	UPROPERTY(NotReplicated)
+	UInventoryComponent* OwnerComponent;
+
+	void AddEntry(UItem* Item);
+
+	void RemoveEntry(UItem* Item);
+
+	//Copies the items current quantity into its entry and marks only that entry for replication
+	void UpdateEntry(UItem* Item);
+
+	void AddCompactEntry(TSubclassOf<UItem> ItemClass, const int32 Quantity);
+
+	void UpdateCompactEntry(TSubclassOf<UItem> ItemClass, const int32 Quantity);
+
+	void RemoveCompactEntry(TSubclassOf<UItem> ItemClass);
+
+	//Gives a compact stack its UItem. The entry keeps its ReplicationID so clients see a change, not a remove and add
+	void PromoteCompactEntry(TSubclassOf<UItem> ItemClass, UItem* Item);
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms) {
+		return FFastArraySerializer::FastArrayDeltaSerialize<FInventoryEntry, FInventoryList>(Entries, DeltaParms, *this);
+	}
+
+private:
+	int32 IndexOfItem(const UItem* Item) const;
+
+	int32 IndexOfCompactEntry(const UClass* ItemClass) const;
+};
+
+template<>
+struct TStructOpsTypeTraits<FInventoryList> : public TStructOpsTypeTraitsBase2<FInventoryList> {
+	enum {
+		WithNetDeltaSerializer = true,
+	};
+};
@@ -0,0 +1,81 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/SubclassOf.h"
+#include "UObject/SoftObjectPath.h"
+
+class UItem;
+
+enum class EInventorySnapshotVersion : uint16 {
+	Initial = 1,
+
+	//Add new versions above this line
+	VersionPlusOne,
+	Latest = VersionPlusOne - 1
+};
+
+/**One stack in an inventory snapshot*/
+struct FInventorySnapshotStack {
+	//Index into FInventorySnapshot::Definitions
+	int32 DefinitionIndex = 0;
+
+	int32 Quantity = 0;
+
+	FORCEINLINE bool operator==(const FInventorySnapshotStack& Other) const { return DefinitionIndex == Other.DefinitionIndex && Quantity == Other.Quantity; }
+};
+
+/**An equipped item, stored as the stack it was equipped from*/
+struct FInventorySnapshotEquipment {
+	//EEquippableSlot value
+	uint8 Slot = 0;
+
+	//Index into FInventorySnapshot::Stacks
+	int32 StackIndex = 0;
+
+	FORCEINLINE bool operator==(const FInventorySnapshotEquipment& Other) const { return Slot == Other.Slot && StackIndex == Other.StackIndex; }
+};
+
+/**Compact, versioned binary copy of an inventory and its equipment. Stacks are stored as an item definition plus a quantity,
+ * so capturing and writing never go through UObject serialization and reading never creates UObjects*/
+struct TRUST_API FInventorySnapshot {
+
+public:
+	//Item class paths, each written once however many stacks use it. Class redirects keep old snapshots loading after a rename
+	TArray<FSoftClassPath> Definitions;
+
+	TArray<FInventorySnapshotStack> Stacks;
+
+	TArray<FInventorySnapshotEquipment> Equipment;
+
+	void Reset();
+
+	//Returns the index of the new stack
+	int32 AddStack(TSubclassOf<UItem> ItemClass, const int32 Quantity);
+
+	void AddEquipment(const uint8 Slot, const int32 StackIndex);
+
+	//Loads the class if needed, so game thread only
+	TSubclassOf<UItem> ResolveDefinition(const int32 DefinitionIndex) const;
+
+	bool ToBytes(TArray<uint8>& OutBytes) const;
+
+	bool FromBytes(const TArray<uint8>& Bytes);
+
+	bool operator==(const FInventorySnapshot& Other) const;
+
+	friend FArchive& operator<<(FArchive& Ar, FInventorySnapshot& Snapshot);
+
+	static FString GetSavePath(const FString& SlotName);
+
+	/**Serializes and writes the snapshot on a worker thread. OnComplete runs on the game thread. The slot file is replaced
+	 * through a temp file, and saves to the same slot are written in the order they were started*/
+	static void SaveAsync(FInventorySnapshot&& Snapshot, const FString& SlotName, TFunction<void(bool)> OnComplete = nullptr);
+
+	static bool Load(const FString& SlotName, FInventorySnapshot& OutSnapshot);
+
+private:
+	//Only used while capturing, not serialized
+	TMap<FSoftClassPath, int32> DefinitionLookup;
+};
@@ -0,0 +1,102 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "InventoryViewCache.generated.h"
+
+class UItem;
+
+UENUM(BlueprintType)
+enum class EInventorySortMode : uint8 {
+	//Highest rarity first
+	ISM_Rarity UMETA(DisplayName = "Rarity"),
+	//Heaviest stack first
+	ISM_Weight UMETA(DisplayName = "Weight"),
+	//Display name, A to Z
+	ISM_Name UMETA(DisplayName = "Name"),
+	//Most recently added first
+	ISM_Recency UMETA(DisplayName = "Recency")
+};
+
+/**One sorted, filtered copy of the inventory's items*/
+struct FInventoryView {
+
+public:
+	EInventorySortMode SortMode = EInventorySortMode::ISM_Recency;
+
+	//Only items of this class or a child of it, all items if null
+	const UClass* FilterClass = nullptr;
+
+	TFunction<bool(const UItem*)> Filter;
+
+	TArray<UItem*> Items;
+
+	//Set when the view can't be patched and has to be sorted from scratch on next access
+	bool bNeedsRebuild = true;
+
+	bool Accepts(const UItem* Item) const;
+};
+
+/**
+ * Sorted and filtered views of UInventoryComponent::Items for UI. A view is built the first time it is asked for
+ * and then patched on every add, remove and quantity change, so reopening or re-sorting a large inventory doesn't
+ * sort anything. Like FInventoryItemIndex, the inventory owns the items and must report every change.
+ * Views are kept on the heap so the arrays handed out stay put while other views are added, they live as long as
+ * the cache, or until unregistered for named views. StackViews are the inventory's stand ins for compact stacks,
+ * listed next to AllItems.
+ */
+struct TRUST_API FInventoryViewCache {
+
+public:
+	FInventoryViewCache() : NextSequence(0) {}
+
+	const TArray<UItem*>& GetView(const EInventorySortMode SortMode, const UClass* FilterClass, const TArray<UItem*>& AllItems, const TArray<UItem*>& StackViews);
+
+	//Views with arbitrary filters have to be registered under a name, a TFunction can't be used to look one up
+	void RegisterView(const FName ViewName, const EInventorySortMode SortMode, TFunction<bool(const UItem*)> Filter);
+
+	void UnregisterView(const FName ViewName);
+
+	//Null if no view was registered under ViewName
+	const TArray<UItem*>* GetNamedView(const FName ViewName, const TArray<UItem*>& AllItems, const TArray<UItem*>& StackViews);
+
+	void AddItem(UItem* Item);
+
+	void RemoveItem(UItem* Item);
+
+	void UpdateItemQuantity(UItem* Item);
+
+	//For when Items was replaced wholesale. Items already seen keep their recency
+	void Rebuild(const TArray<UItem*>& AllItems, const TArray<UItem*>& StackViews);
+
+	void Reset();
+
+private:
+	void BuildView(FInventoryView& View, const TArray<UItem*>& AllItems, const TArray<UItem*>& StackViews) const;
+
+	void InsertSorted(FInventoryView& View, UItem* Item) const;
+
+	bool Less(const EInventorySortMode SortMode, const UItem* A, const UItem* B) const;
+
+	uint32 GetSequence(const UItem* Item) const;
+
+	template<typename FunctionType>
+	void ForEachView(FunctionType Function) {
+		for (auto& View : ClassViews) {
+			Function(*View.Value);
+		}
+		for (auto& View : NamedViews) {
+			Function(*View.Value);
+		}
+	}
+
+	TMap<TPair<EInventorySortMode, const UClass*>, TUniquePtr<FInventoryView>> ClassViews;
+
+	TMap<FName, TUniquePtr<FInventoryView>> NamedViews;
+
+	//Order items were added in, for the recency sort and to keep every other sort stable
+	TMap<const UItem*, uint32> AddSequences;
+
+	uint32 NextSequence;
+};
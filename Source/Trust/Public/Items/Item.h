@@ -7,6 +7,7 @@
 #include "Item.generated.h"
 
 class ATrustCharacter;
+class IRepChangedPropertyTracker;
 DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnItemModified);
 
 UENUM(BlueprintType)
@@ -32,11 +33,14 @@ protected:
 	UPROPERTY(Transient)
 	UWorld* World;
 
+    /**Soft so loading the item class doesn't load its art, UItemStreamingSubsystem streams it in when it's needed.
+     * Was the hard PickupMesh, DefaultEngine.ini redirects saved values here. Blueprints read GetPickupMeshOrPlaceholder*/
     UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Item")
-	UStaticMesh *PickupMesh;
+	TSoftObjectPtr<UStaticMesh> PickupMeshAsset;
 
+    /**Was the hard Thumbnail, redirected the same way. Blueprints read GetThumbnail*/
     UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Item")
-    UTexture2D *Thumbnail;
+    TSoftObjectPtr<UTexture2D> ThumbnailAsset;
 
     UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Item")
     FText ItemDisplayName;
@@ -59,6 +63,12 @@ protected:
     UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Item", meta = (ClampMin = 2, EditCondition = bStackable))
     int32 MaxStackSize;
 
+    /**Inventories using delta replication store stacks of this item as class + quantity and only create a UItem when one is asked for.
+     * Only for commodity items like ammo or crafting materials that have no per instance state. Ignored if OnUse is implemented,
+     * or if a native subclass doesn't return true from HasStatelessNativeUse*/
+    UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Item", meta = (EditCondition = bStackable))
+    bool bCompactStack;
+
     UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Item")
     TSubclassOf<class UItemTooltipWidget> ItemTooltip;
 
@@ -71,6 +81,9 @@ protected:
 	UPROPERTY(ReplicatedUsing = OnRep_Quantity, EditAnywhere, Category = "Item", meta = (UIMin = 1, EditCondition = bStackable))
 	int32 Quantity;
 
+	//Transient stand in the inventory hands out for a compact stack, never replicated or indexed
+	bool bIsStackView;
+
 public:
 	virtual UWorld* GetWorld() const override;
 	
@@ -82,11 +95,26 @@ public:
 
 	void SetOwningInventory(UInventoryComponent* NewOwningInventory);
 
+	/**Called by the owning inventory before the item replicates. Delta replicated inventories already send Quantity in their entries*/
+	void PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker);
+
 	virtual void AddToInventory(UInventoryComponent *Inventory);
 	
 	UFUNCTION(BlueprintCallable, Category = "Item")
 	void SetQuantity(const int32 NewQuantity);
 
+	/**Applies a quantity received through the owning inventory's delta replication as if Quantity itself had replicated*/
+	void SetQuantityFromReplication(const int32 NewQuantity);
+
+	bool UsesCompactStorage() const;
+
+	/**Native subclasses return true to allow bCompactStack, promising their Use keeps no state on the item between calls*/
+	virtual bool HasStatelessNativeUse() const;
+
+	FORCEINLINE bool IsStackView() const { return bIsStackView; }
+
+	FORCEINLINE void MarkAsStackView() { bIsStackView = true; }
+
 	UFUNCTION(BlueprintPure, Category = "Item")
 	virtual bool ShouldShowInInventory() const;
 
@@ -116,8 +144,27 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Item")
 	FORCEINLINE FText GetItemDisplayName() const { return ItemDisplayName; }
 
+	UFUNCTION(BlueprintPure, Category = "Item")
+	FORCEINLINE EItemRarity GetRarity() const { return Rarity; }
+
+	/**The real pickup mesh, loaded on the spot if it hasn't been streamed in. For servers, collision and anything else
+	 * that can't make do with a stand in*/
+	UFUNCTION(BlueprintCallable, Category = "Item")
+	UStaticMesh* GetPickupMesh() const;
+
+	/**For visuals only. The pickup mesh if it's streamed in, otherwise the placeholder, callers showing the placeholder
+	 * request the item's assets from UItemStreamingSubsystem and swap in the real mesh on OnItemAssetsLoaded*/
 	UFUNCTION(BlueprintCallable, Category = "Item")
-	FORCEINLINE UStaticMesh* GetPickupMesh() const { return PickupMesh; }
+	UStaticMesh* GetPickupMeshOrPlaceholder() const;
+
+	/**The thumbnail if it's streamed in, otherwise the placeholder. Swapped the same way as GetPickupMeshOrPlaceholder*/
+	UFUNCTION(BlueprintPure, Category = "Item")
+	UTexture2D* GetThumbnail() const;
+
+	FORCEINLINE const TSoftObjectPtr<UStaticMesh>& GetPickupMeshAsset() const { return PickupMeshAsset; }
+
+	/**Every asset needed to show this item, streamed together. Subclasses with more art, like armor meshes, add theirs*/
+	virtual void GetVisualAssets(TArray<FSoftObjectPath>& OutAssets) const;
 	
 private:
 	UFUNCTION()
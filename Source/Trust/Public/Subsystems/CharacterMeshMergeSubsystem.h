@@ -0,0 +1,63 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CharacterMeshMergeSubsystem.generated.h"
+
+class UMaterialInterface;
+class USkeletalMesh;
+class USkeletalMeshComponent;
+
+/**
+ * Merges a character's body and armor parts into one skeletal mesh, so a character renders in one skinned draw per
+ * material and updates one component instead of one per part. Merged meshes are cached by the set of meshes and
+ * materials they were built from, characters wearing the same loadout share one. Source meshes need Allow CPU Access
+ * for merging to work in cooked builds.
+ */
+UCLASS()
+class TRUST_API UCharacterMeshMergeSubsystem : public UWorldSubsystem {
+	GENERATED_BODY()
+
+public:
+	UCharacterMeshMergeSubsystem();
+
+	/**Returns BaseMesh merged with every part that has a mesh, wearing the parts' materials. Null if they can't be merged*/
+	USkeletalMesh* GetMergedMesh(USkeletalMesh* BaseMesh, const TArray<USkeletalMeshComponent*>& Parts);
+
+	FORCEINLINE int32 Num() const { return MergedMeshes.Num(); }
+
+protected:
+	virtual bool DoesSupportWorldType(EWorldType::Type WorldType) const override;
+
+private:
+	struct FMergedMeshKey {
+		//Meshes in merge order, each followed by the materials it's worn with
+		TArray<const UObject*> Sources;
+
+		uint32 Hash = 0;
+
+		FORCEINLINE bool operator==(const FMergedMeshKey& Other) const { return Hash == Other.Hash && Sources == Other.Sources; }
+
+		friend FORCEINLINE uint32 GetTypeHash(const FMergedMeshKey& Key) { return Key.Hash; }
+	};
+
+	struct FCachedMergedMesh {
+		USkeletalMesh* Mesh;
+
+		uint64 LastUsedFrame;
+	};
+
+	USkeletalMesh* MergeMeshes(const TArray<USkeletalMesh*>& SourceMeshes, const TArray<TArray<UMaterialInterface*>>& SourceMaterials) const;
+
+	//Drops the least recently used merged meshes once there are more than MaxCachedMeshes
+	void TrimCache();
+
+	UPROPERTY()
+	TArray<USkeletalMesh*> ReferencedMeshes;
+
+	TMap<FMergedMeshKey, FCachedMergedMesh> MergedMeshes;
+
+	int32 MaxCachedMeshes;
+};
@@ -0,0 +1,56 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "FocusHighlightSubsystem.generated.h"
+
+class UInteractionComponent;
+
+/**
+ * Applies focus outlines for interaction components once per frame, after all actors ticked. Focus can move across
+ * several interactables in one frame, only the state each one ends the frame in touches its primitives' render state,
+ * and primitives already in that state are left alone.
+ */
+UCLASS()
+class TRUST_API UFocusHighlightSubsystem : public UWorldSubsystem {
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	virtual void Deinitialize() override;
+
+	/**Queues the interactable's outline to be shown or hidden at the end of the frame, the last request of the frame wins*/
+	void RequestHighlight(UInteractionComponent* Interactable, const bool bHighlight);
+
+	/**Applies all queued requests now instead of at the end of the frame*/
+	void FlushHighlights();
+
+protected:
+	virtual bool DoesSupportWorldType(EWorldType::Type WorldType) const override;
+
+private:
+	struct FAppliedHighlight {
+		TArray<TWeakObjectPtr<UPrimitiveComponent>> Primitives;
+
+		//Stencil each primitive had before the outline changed it, INDEX_NONE if it was left alone
+		TArray<int32> PreviousStencils;
+
+		//Whether each primitive already rendered custom depth, those keep rendering it once the outline is gone
+		TArray<bool> PreviousRenderCustomDepth;
+	};
+
+	void OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+
+	void ApplyHighlight(UInteractionComponent* Interactable);
+
+	void RevertHighlight(FAppliedHighlight& Highlight);
+
+	TMap<TWeakObjectPtr<UInteractionComponent>, bool> PendingHighlights;
+
+	TMap<TWeakObjectPtr<UInteractionComponent>, FAppliedHighlight> AppliedHighlights;
+
+	FDelegateHandle PostActorTickHandle;
+};
@@ -0,0 +1,112 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "InteractionLatencySubsystem.generated.h"
+
+/**Latency samples in fixed millisecond buckets, enough for percentiles without keeping every sample*/
+struct TRUST_API FInteractionLatencyHistogram {
+	static constexpr int32 NumBuckets = 12;
+
+	//Upper bound of each bucket in ms, the last one takes everything slower
+	static const float BucketBounds[NumBuckets];
+
+	FInteractionLatencyHistogram();
+
+	void AddSample(const float Milliseconds);
+
+	void Reset();
+
+	/**Upper bound of the bucket the Percentile (0-1) sample falls in*/
+	float GetPercentile(const float Percentile) const;
+
+	FORCEINLINE float GetAverage() const { return NumSamples > 0 ? Sum / NumSamples : 0.f; }
+
+	FString ToString() const;
+
+	int32 Buckets[NumBuckets];
+
+	int32 NumSamples;
+
+	float Sum;
+
+	float Min;
+
+	float Max;
+};
+
+/**
+ * Measures interactions from the key press on the client to the server firing OnInteract and the result arriving back,
+ * split into uplink, server and downlink stages. The stages are cut with the replicated server clock, so the split is an
+ * estimate while the round trip is exact. Stages go to per-session histograms and the CSV profiler's Interaction category.
+ * Only runs while Trust.Interaction.LatencyStats is set.
+ */
+UCLASS()
+class TRUST_API UInteractionLatencySubsystem : public UWorldSubsystem {
+	GENERATED_BODY()
+
+public:
+	UInteractionLatencySubsystem();
+
+	virtual void Deinitialize() override;
+
+	static bool IsEnabled();
+
+	/**Client only. Timestamps a key press, returns the id to send with the interaction or 0 when stats are off*/
+	uint16 BeginRequest(const float HoldTime);
+
+	/**Client only. The server fired OnInteract for the request, times are in server world seconds*/
+	void CompleteRequest(const uint16 RequestId, const float ServerReceiveTime, const float ServerInteractTime);
+
+	void ResetStats();
+
+	void LogReport() const;
+
+	FORCEINLINE const FInteractionLatencyHistogram& GetUplink() const { return Uplink; }
+
+	FORCEINLINE const FInteractionLatencyHistogram& GetServer() const { return Server; }
+
+	FORCEINLINE const FInteractionLatencyHistogram& GetDownlink() const { return Downlink; }
+
+	FORCEINLINE const FInteractionLatencyHistogram& GetRoundTrip() const { return RoundTrip; }
+
+	/**Requests that never completed, because the server rejected or cancelled them or they were lost*/
+	FORCEINLINE int32 GetNumStaleRequests() const { return NumStaleRequests; }
+
+	FORCEINLINE int32 GetNumInFlightRequests() const { return InFlightRequests.Num(); }
+
+protected:
+	virtual bool DoesSupportWorldType(EWorldType::Type WorldType) const override;
+
+private:
+	struct FInFlightRequest {
+		uint16 RequestId;
+
+		double PressRealTime;
+
+		float PressServerTime;
+
+		float HoldTime;
+	};
+
+	float GetServerTime() const;
+
+	//Requests the server rejected or cancelled never complete
+	void PruneStaleRequests(const double Now);
+
+	TArray<FInFlightRequest> InFlightRequests;
+
+	FInteractionLatencyHistogram Uplink;
+
+	FInteractionLatencyHistogram Server;
+
+	FInteractionLatencyHistogram Downlink;
+
+	FInteractionLatencyHistogram RoundTrip;
+
+	int32 NumStaleRequests;
+
+	uint16 NextRequestId;
+};
@@ -0,0 +1,68 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "InteractionSubsystem.generated.h"
+
+class UInteractionComponent;
+
+/**An interactable in the registry grid, with the bounds the focus ray is tested against*/
+struct FRegisteredInteractable {
+
+public:
+	UInteractionComponent* Component = nullptr;
+
+	FBox Bounds = FBox(ForceInit);
+};
+
+/**
+ * Per world uniform grid of active interaction components, so focus checks only look at the few interactables near
+ * the player instead of tracing 5000 units and searching the hit actor's components. Components add and remove
+ * themselves when they are activated, deactivated or moved, so the registry never holds a stale pointer.
+ */
+UCLASS()
+class TRUST_API UInteractionSubsystem : public UWorldSubsystem {
+	GENERATED_BODY()
+
+public:
+	UInteractionSubsystem();
+
+	void RegisterInteractable(UInteractionComponent* Interactable);
+
+	void UnregisterInteractable(UInteractionComponent* Interactable);
+
+	//Call after an interactable moved or changed its interaction distance
+	void UpdateInteractable(UInteractionComponent* Interactable);
+
+	/**Closest interactable whose bounds the ray from Start along Direction enters within that interactable's interaction distance.
+	 * OutDistance is the distance from Start to where the ray enters its bounds. Only bounds are tested, so callers trace up to
+	 * OutDistance to make sure nothing blocks the view*/
+	UInteractionComponent* FindInteractableAlongRay(const FVector& Start, const FVector& Direction, const AActor* IgnoredActor, float& OutDistance) const;
+
+	void GatherInteractablesInRadius(const FVector& Center, const float Radius, TArray<const FRegisteredInteractable*>& OutInteractables) const;
+
+	FORCEINLINE int32 Num() const { return RegisteredCells.Num(); }
+
+	/**Bounds an interactable is focused and reached by, its owner's root component bounds*/
+	static FBox GetInteractableBounds(const UInteractionComponent* Interactable);
+
+protected:
+	virtual bool DoesSupportWorldType(EWorldType::Type WorldType) const override;
+
+private:
+	FIntPoint GetCell(const FVector& Location) const;
+
+	/**Edge length of a grid cell. Around the largest interaction distance keeps a query to a handful of cells*/
+	float CellSize;
+
+	TMap<FIntPoint, TArray<FRegisteredInteractable>> Cells;
+
+	TMap<const UInteractionComponent*, FIntPoint> RegisteredCells;
+
+	//Largest interaction distance and bounds extent ever registered, a query has to reach this far to not miss anything
+	float MaxInteractionDistance;
+
+	float MaxBoundsExtent;
+};
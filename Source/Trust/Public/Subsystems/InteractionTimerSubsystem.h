@@ -0,0 +1,78 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "InteractionTimerSubsystem.generated.h"
+
+class ATrustCharacter;
+class UInteractionComponent;
+
+/**
+ * Every hold interaction in flight in the world, in one min heap ordered by completion time. Due interactions are
+ * completed together once per tick instead of each character running its own timer. A character holds at most one
+ * interaction, cancelling it only drops the character's live entry and the stale heap node is skipped when it's popped.
+ */
+UCLASS()
+class TRUST_API UInteractionTimerSubsystem : public UWorldSubsystem, public FTickableGameObject {
+	GENERATED_BODY()
+
+public:
+	UInteractionTimerSubsystem();
+
+	/**Completes Character's interaction with Interactable after Duration seconds, replacing any interaction it was holding*/
+	void StartInteraction(ATrustCharacter* Character, UInteractionComponent* Interactable, const float Duration);
+
+	void CancelInteraction(const ATrustCharacter* Character);
+
+	/**Cancels every interaction held on Interactable, for when it's deactivated or destroyed*/
+	void CancelInteractionsWith(const UInteractionComponent* Interactable);
+
+	bool IsInteracting(const ATrustCharacter* Character) const;
+
+	/**Seconds until Character's interaction completes, 0 if it isn't interacting*/
+	float GetRemainingTime(const ATrustCharacter* Character) const;
+
+	FORCEINLINE int32 Num() const { return ActiveInteractions.Num(); }
+
+	//FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	virtual TStatId GetStatId() const override;
+
+private:
+	struct FScheduledInteraction {
+		double CompleteTime;
+
+		uint32 Serial;
+
+		TWeakObjectPtr<ATrustCharacter> Character;
+
+		TWeakObjectPtr<UInteractionComponent> Interactable;
+
+		FORCEINLINE bool operator<(const FScheduledInteraction& Other) const { return CompleteTime < Other.CompleteTime; }
+	};
+
+	struct FActiveInteraction {
+		uint32 Serial;
+
+		double CompleteTime;
+
+		TWeakObjectPtr<ATrustCharacter> Character;
+
+		TWeakObjectPtr<UInteractionComponent> Interactable;
+	};
+
+	//Rebuilds the heap from the live interactions once cancelled nodes make up most of it
+	void CompactSchedule();
+
+	TArray<FScheduledInteraction> Schedule;
+
+	TMap<TWeakObjectPtr<const ATrustCharacter>, FActiveInteraction> ActiveInteractions;
+
+	uint32 NextSerial;
+};
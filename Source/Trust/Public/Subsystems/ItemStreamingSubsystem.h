@@ -0,0 +1,89 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/StreamableManager.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ItemStreamingSubsystem.generated.h"
+
+class UItem;
+class UStaticMesh;
+class UTexture2D;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnItemAssetsLoaded, TSubclassOf<UItem>, ItemClass);
+
+UENUM(BlueprintType)
+enum class EItemAssetPriority : uint8 {
+	//Likely to be seen soon, like an item entering an inventory or a pickup becoming relevant
+	IAP_Prefetch UMETA(DisplayName = "Prefetch"),
+	//On screen now and showing a placeholder
+	IAP_Visible UMETA(DisplayName = "Visible")
+};
+
+/**
+ * Streams item visuals in on demand. Each item class's assets are loaded while anything holds a request on it and
+ * released for garbage collection once the last requester lets go. Until they arrive items show placeholders.
+ * Dedicated servers never load item visuals.
+ */
+UCLASS()
+class TRUST_API UItemStreamingSubsystem : public UWorldSubsystem {
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	virtual void Deinitialize() override;
+
+	/**Starts loading ItemClass's visuals and holds them for Requester. Requesting again only raises the priority*/
+	UFUNCTION(BlueprintCallable, Category = "Items|Streaming")
+	void RequestItemAssets(TSubclassOf<UItem> ItemClass, const UObject* Requester, const EItemAssetPriority Priority = EItemAssetPriority::IAP_Prefetch);
+
+	UFUNCTION(BlueprintCallable, Category = "Items|Streaming")
+	void ReleaseItemAssets(TSubclassOf<UItem> ItemClass, const UObject* Requester);
+
+	/**Releases everything Requester holds, for when it's destroyed*/
+	void ReleaseAllItemAssets(const UObject* Requester);
+
+	UFUNCTION(BlueprintPure, Category = "Items|Streaming")
+	bool AreItemAssetsLoaded(TSubclassOf<UItem> ItemClass) const;
+
+	FORCEINLINE UStaticMesh* GetPlaceholderMesh() const { return PlaceholderMesh; }
+
+	FORCEINLINE UTexture2D* GetPlaceholderThumbnail() const { return PlaceholderThumbnail; }
+
+	FORCEINLINE int32 Num() const { return Requests.Num(); }
+
+	/**Broadcast when a class's visuals finish loading, so anything showing placeholders can swap them out*/
+	UPROPERTY(BlueprintAssignable, Category = "Items|Streaming")
+	FOnItemAssetsLoaded OnItemAssetsLoaded;
+
+protected:
+	virtual bool DoesSupportWorldType(EWorldType::Type WorldType) const override;
+
+private:
+	struct FItemAssetRequest {
+		TSharedPtr<FStreamableHandle> Handle;
+
+		TArray<TWeakObjectPtr<const UObject>> Requesters;
+
+		EItemAssetPriority Priority;
+	};
+
+	void StartLoad(const UClass* ItemClass, FItemAssetRequest& Request);
+
+	void OnItemAssetsStreamed(TSubclassOf<UItem> ItemClass);
+
+	void ReleaseRequest(const UClass* ItemClass);
+
+	FStreamableManager Streamable;
+
+	//Keyed by exact class, item classes stay loaded while items of them exist
+	TMap<const UClass*, FItemAssetRequest> Requests;
+
+	UPROPERTY()
+	UStaticMesh* PlaceholderMesh;
+
+	UPROPERTY()
+	UTexture2D* PlaceholderThumbnail;
+};
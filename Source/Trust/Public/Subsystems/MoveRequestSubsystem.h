@@ -0,0 +1,88 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "MoveRequestSubsystem.generated.h"
+
+class AController;
+class ANavigationData;
+
+/**
+ * Every click to move request in the world goes through here instead of pathfinding straight away. A destination
+ * within tolerance of the one being followed is dropped, one lying on the current path reuses the path cut short there,
+ * anything else waits for the controller's minimum repath interval and then for a free slot in the per frame budget,
+ * so many controllers asking at once are spread across frames. A controller only ever waits on its latest destination.
+ * A cut short path is a plain copy of the points that nothing keeps up to date, so when navigation data is rebuilt
+ * everyone following one is queued to pathfind properly.
+ */
+UCLASS()
+class TRUST_API UMoveRequestSubsystem : public UWorldSubsystem, public FTickableGameObject {
+	GENERATED_BODY()
+
+public:
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+
+	virtual void Deinitialize() override;
+
+	/**Moves Controller's pawn to Destination, now or in a later frame*/
+	void RequestMove(AController* Controller, const FVector& Destination);
+
+	void LogStats(const bool bReset);
+
+	//FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	virtual TStatId GetStatId() const override;
+
+protected:
+	virtual bool DoesSupportWorldType(EWorldType::Type WorldType) const override;
+
+private:
+	struct FMoveRequest {
+		FVector Destination = FVector::ZeroVector;
+
+		//Goal of the path the controller is following
+		FVector IssuedDestination = FVector::ZeroVector;
+
+		double LastPathfindTime = -BIG_NUMBER;
+
+		bool bPending = false;
+
+		bool bHasIssued = false;
+
+		//Following a path cut short by TryReusePath rather than one from pathfinding
+		bool bFollowingReusedPath = false;
+	};
+
+	/**Still following a path to within tolerance of Destination*/
+	bool IsAlreadyMovingTo(const AController* Controller, const FMoveRequest& Request, const FVector& Destination) const;
+
+	/**Cuts the followed path short where it passes Destination, instead of pathfinding again. The result is repathed once navigation data changes*/
+	bool TryReusePath(AController* Controller, const FVector& Destination) const;
+
+	void Pathfind(AController* Controller, const FVector& Destination);
+
+	void QueueRequest(AController* Controller, FMoveRequest& Request, const FVector& Destination);
+
+	/**Reused paths have no corridor and aren't observed by the navigation data, so they are replaced once it changes*/
+	UFUNCTION()
+	void OnNavigationGenerationFinished(ANavigationData* NavData);
+
+	TMap<TWeakObjectPtr<AController>, FMoveRequest> Requests;
+
+	//Controllers with a pending destination, oldest first
+	TArray<TWeakObjectPtr<AController>> PendingQueue;
+
+	int32 NumPathfinds = 0;
+
+	int32 NumReusedPaths = 0;
+
+	int32 NumSkippedRequests = 0;
+
+	double StatsStartTime = 0.0;
+};
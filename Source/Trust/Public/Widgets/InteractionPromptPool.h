@@ -0,0 +1,45 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/NoExportTypes.h"
+#include "InteractionPromptPool.generated.h"
+
+class UInteractionComponent;
+class UInteractionWidget;
+
+/**
+ * The few interaction prompts a local player can see at once. Prompts are created on first use and reused from then
+ * on, while shown they follow their interactable's location on screen every tick.
+ */
+UCLASS()
+class TRUST_API UInteractionPromptPool : public UObject {
+	GENERATED_BODY()
+
+public:
+	void Initialize(APlayerController* InOwningPlayer, TSubclassOf<UInteractionWidget> InDefaultPromptClass);
+
+	/**Assigns a prompt to the interactable and shows it, reusing an idle prompt of the same class if there is one*/
+	UInteractionWidget* ShowPrompt(UInteractionComponent* Interactable);
+
+	void HidePrompt(UInteractionComponent* Interactable);
+
+	/**Moves shown prompts to their interactables' screen positions and hides those whose interactable is gone*/
+	void UpdatePrompts();
+
+private:
+	void ReleasePrompt(const int32 ActiveIndex);
+
+	UPROPERTY()
+	APlayerController* OwningPlayer;
+
+	UPROPERTY()
+	TSubclassOf<UInteractionWidget> DefaultPromptClass;
+
+	UPROPERTY()
+	TArray<UInteractionWidget*> ActivePrompts;
+
+	UPROPERTY()
+	TArray<UInteractionWidget*> IdlePrompts;
+};
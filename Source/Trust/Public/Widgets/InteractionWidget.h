@@ -11,12 +11,40 @@ UCLASS()
 class TRUST_API UInteractionWidget : public UUserWidget {
 	GENERATED_BODY()
 public:
+	UInteractionWidget(const FObjectInitializer& ObjectInitializer);
+
 	UFUNCTION(BlueprintCallable, Category = "Interaction")
 	void UpdateInteractionWidget(class UInteractionComponent *InteractionComponent);
 
 	UFUNCTION(BlueprintImplementableEvent)
 	void OnUpdateInteractionWidget();
 
+	/**Local player's hold progress from the published start time and duration, no interactor or timer lookups*/
+	UFUNCTION(BlueprintPure, Category = "Interaction")
+	float GetInteractProgress() const;
+
+	void BeginInteractProgress(const float StartTime, const float Duration);
+
+	void EndInteractProgress(const bool bCompleted);
+
+	/**The local player started holding. Play a progress animation at 1 / Duration speed instead of binding to progress every frame*/
+	UFUNCTION(BlueprintImplementableEvent)
+	void OnInteractProgressStarted(const float Duration);
+
+	UFUNCTION(BlueprintImplementableEvent)
+	void OnInteractProgressCancelled();
+
+	UFUNCTION(BlueprintImplementableEvent)
+	void OnInteractProgressCompleted();
+
 	UPROPERTY(BlueprintReadOnly, Category = "Interaction", meta = (ExposeOnSpawn))
 	class UInteractionComponent *OwningInteractionComponent;
+
+protected:
+	//World time the local player started holding, negative when not holding
+	UPROPERTY(BlueprintReadOnly, Category = "Interaction")
+	float InteractProgressStartTime;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Interaction")
+	float InteractProgressDuration;
 };
@@ -5,3 +5,5 @@
 #include "CoreMinimal.h"
 
 DECLARE_LOG_CATEGORY_EXTERN(LogTrust, Log, All);
+
+DECLARE_STATS_GROUP(TEXT("Trust"), STATGROUP_Trust, STATCAT_Advanced);
@@ -3,17 +3,69 @@
 #include "TrustCharacter.h"
 
 #include "DrawDebugHelpers.h"
+#include "Trust.h"
 #include "TrustPlayerController.h"
 #include "Camera/CameraComponent.h"
 #include "Components/CapsuleComponent.h"
 #include "Components/InteractionComponent.h"
 #include "Components/InventoryComponent.h"
+#include "Components/InventorySnapshot.h"
 #include "GameFramework/CharacterMovementComponent.h"
 #include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h"
 #include "GameFramework/SpringArmComponent.h"
 #include "Items/ArmorItem.h"
+#include "Net/UnrealNetwork.h"
+#include "Subsystems/CharacterMeshMergeSubsystem.h"
+#include "Subsystems/InteractionLatencySubsystem.h"
+#include "Subsystems/InteractionSubsystem.h"
+#include "Subsystems/InteractionTimerSubsystem.h"
 #include "World/Pickup.h"
 
+static TAutoConsoleVariable<int32> CVarUseInteractionRegistry(
+	TEXT("Trust.Interaction.UseRegistry"),
+	1,
+	TEXT("If non-zero, focus checks query the interactable registry and only trace up to the interactable it finds."),
+	ECVF_Cheat);
+
+static TAutoConsoleVariable<int32> CVarAsyncInteractionTraces(
+	TEXT("Trust.Interaction.AsyncTraces"),
+	0,
+	TEXT("0: client focus checks trace synchronously every tick.\n")
+	TEXT("1: cursor and focus traces are requested asynchronously and applied the next frame, off the game thread."),
+	ECVF_Cheat);
+
+static TAutoConsoleVariable<float> CVarServerInteractionSlack(
+	TEXT("Trust.Interaction.ServerDistanceSlack"),
+	50.f,
+	TEXT("Distance in units the server accepts beyond an interactable's InteractionDistance, on top of the latency allowance."),
+	ECVF_Cheat);
+
+static TAutoConsoleVariable<int32> CVarServerInteractionVisibility(
+	TEXT("Trust.Interaction.ServerVisibilityCheck"),
+	0,
+	TEXT("If non-zero, the server also traces to targets in reach and rejects them if something else blocks the view."),
+	ECVF_Cheat);
+
+static TAutoConsoleVariable<int32> CVarAllowMergedMeshes(
+	TEXT("Trust.Character.MergedMeshes"),
+	1,
+	TEXT("If zero, characters render their armor as separate part components even if they're set to merge them."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarLogPickupLatency(
+	TEXT("Trust.Interaction.LogPickupLatency"),
+	0,
+	TEXT("If non-zero, logs how long each predicted interaction took to show and how long the server took to confirm it."),
+	ECVF_Cheat);
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Predicted Interactions Rolled Back"), STAT_PredictedInteractionsRolledBack, STATGROUP_Trust);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Server Interaction Targets Rejected"), STAT_ServerInteractionTargetsRejected, STATGROUP_Trust);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Server Interaction Traces"), STAT_ServerInteractionTraces, STATGROUP_Trust);
+DECLARE_CYCLE_STAT(TEXT("Interaction Sync Traces"), STAT_InteractionSyncTraces, STATGROUP_Trust);
+DECLARE_CYCLE_STAT(TEXT("Interaction Async Trace Requests"), STAT_InteractionAsyncTraceRequests, STATGROUP_Trust);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Interaction Async Traces"), STAT_InteractionAsyncTraces, STATGROUP_Trust);
+
 ATrustCharacter::ATrustCharacter() {
 	// Set size for player capsule
 	GetCapsuleComponent()->InitCapsuleSize(42.f, 96.0f);
@@ -47,16 +99,23 @@ ATrustCharacter::ATrustCharacter() {
 	PrimaryActorTick.bStartWithTickEnabled = true;
 	
 // Trust	
-	HeadMesh = PlayerMeshes.Add(EEquippableSlot::EIS_Head, CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("HeadMesh")));
-    ChestMesh = PlayerMeshes.Add(EEquippableSlot::EIS_Chest, CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("ChestMesh")));
-    LegsMesh = PlayerMeshes.Add(EEquippableSlot::EIS_Legs, CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("LegsMesh")));
-    FeetMesh = PlayerMeshes.Add(EEquippableSlot::EIS_Feet, CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("FeetMesh")));
-    HandsMesh = PlayerMeshes.Add(EEquippableSlot::EIS_Hands, CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("HandsMesh")));
-
-	for (const auto &PlayerMesh : PlayerMeshes) {
-    	USkeletalMeshComponent *MeshComponent = PlayerMesh.Value;
-    	MeshComponent->SetupAttachment(GetMesh());
-    	MeshComponent->SetMasterPoseComponent(GetMesh());
+	check(StaticEnum<EEquippableSlot>()->GetMaxEnumValue() <= NumEquipmentSlots);
+	PlayerMeshes.SetNumZeroed(NumEquipmentSlots);
+	EquippedItems.SetNumZeroed(NumEquipmentSlots);
+	EquippedClasses.SetNum(NumEquipmentSlots);
+	AppliedEquippedClasses.SetNum(NumEquipmentSlots);
+
+	HeadMesh = PlayerMeshes[(int32)EEquippableSlot::EIS_Head] = CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("HeadMesh"));
+    ChestMesh = PlayerMeshes[(int32)EEquippableSlot::EIS_Chest] = CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("ChestMesh"));
+    LegsMesh = PlayerMeshes[(int32)EEquippableSlot::EIS_Legs] = CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("LegsMesh"));
+    FeetMesh = PlayerMeshes[(int32)EEquippableSlot::EIS_Feet] = CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("FeetMesh"));
+    HandsMesh = PlayerMeshes[(int32)EEquippableSlot::EIS_Hands] = CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("HandsMesh"));
+
+	for (USkeletalMeshComponent *MeshComponent : PlayerMeshes) {
+		if (MeshComponent) {
+    		MeshComponent->SetupAttachment(GetMesh());
+    		MeshComponent->SetMasterPoseComponent(GetMesh());
+		}
     }
 	
 	PlayerInventory = CreateDefaultSubobject<UInventoryComponent>("Inventory");
@@ -65,9 +124,33 @@ ATrustCharacter::ATrustCharacter() {
 	
 	InteractionCheckDistance = 5000.f;
     InteractionCheckFrequency = 0.f;
+	PredictedInteractionTimeout = 2.f;
+	LastPredictionId = 0;
+	LatencyRequestId = 0;
+	LatencyRequestReceiveTime = 0.f;
 
 	bIsAiming = false;
 	bIsCombatMode = false;
+
+	AimYawSendRate = 20.f;
+	AimYawInterpSpeed = 12.f;
+	ReplicatedAimYaw = 0;
+	PendingAimYaw = 0;
+	SentAimYaw = 0;
+	LastAimYawSendTime = -BIG_NUMBER;
+	LastAimYawChangeTime = 0.f;
+	bAimYawSettled = true;
+	LastAimYawReceiveTime = -BIG_NUMBER;
+
+	bMergeArmorMeshes = false;
+	bMergedMeshDirty = false;
+	bUsingMergedMesh = false;
+	BaseBodyMesh = nullptr;
+
+	bCursorTracePending = false;
+	bFocusTracePending = false;
+	CursorTraceDelegate.BindUObject(this, &ATrustCharacter::OnCursorTraceDone);
+	FocusTraceDelegate.BindUObject(this, &ATrustCharacter::OnFocusTraceDone);
 }
 
 void ATrustCharacter::SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) {
@@ -79,97 +162,344 @@ void ATrustCharacter::SetupPlayerInputComponent(class UInputComponent* PlayerInp
 	PlayerInputComponent->BindAction("Interact", IE_Released, this, &ATrustCharacter::EndInteract);
 }
 
+void ATrustCharacter::BeginPlay() {
+	Super::BeginPlay();
+
+	if (ShouldMergeArmorMeshes()) {
+		BaseBodyMesh = GetMesh()->SkeletalMesh;
+		RefreshMergedMesh();
+	}
+}
+
 void ATrustCharacter::Tick(float DeltaSeconds) {
     Super::Tick(DeltaSeconds);
 	
-	// if (bIsCombatMode && CurrentPlayerController) {
-	// 	FHitResult TraceHitResult;
-	// 	CurrentPlayerController->GetHitResultUnderCursor(ECC_Visibility, true, TraceHitResult);
-	// 	
-	// 	FRotator PlayerRot = UKismetMathLibrary::FindLookAtRotation(GetActorLocation(), TraceHitResult.Location);
-	// 	FRotator NewRotation = GetActorRotation();
-	// 	NewRotation.Yaw = PlayerRot.Yaw;
-	// 	SetRotation(NewRotation);
-	// 	// UE_LOG(LogLevel, Warning, TEXT("Mouse loc: %s"), *NewRotation.ToString());
-	// }
+	if (bIsCombatMode && IsLocallyControlled()) {
+		UpdateCursorAim();
+	}
 
+	if (!HasAuthority() && IsLocallyControlled()) {
+		FlushAimYaw();
+	} else if (GetLocalRole() == ROLE_SimulatedProxy) {
+		UpdateSimulatedAim(DeltaSeconds);
+	}
 	
 	// const bool bIsInteractingOnServer = (HasAuthority() && IsInteracting());
 	// || bIsInteractingOnServer
+	if (PredictedInteractions.Num() > 0) {
+		UpdatePredictedInteractions();
+	}
+
 	if (!HasAuthority() && GetWorld()->TimeSince(InteractionData.LastInteractionCheckTime) > InteractionCheckFrequency) {
-		if (Cast<ATrustPlayerController>(GetController())) {
-			const FVector MousePos = GetMousePosition();
-			PerformInteractionCheck(MousePos);
+		if (const ATrustPlayerController* PlayerController = Cast<ATrustPlayerController>(GetController())) {
+			if (CVarAsyncInteractionTraces.GetValueOnGameThread() != 0) {
+				PerformAsyncInteractionCheck(PlayerController);
+			} else {
+				const FVector MousePos = GetMousePosition();
+				PerformInteractionCheck(MousePos);
+			}
 		}
 	}
 }
 
 void ATrustCharacter::ToggleCombat() {
 	bIsCombatMode = !bIsCombatMode;
+	ApplyCombatMode(bIsCombatMode);
+	if (!HasAuthority()) {
+		ServerSetCombatMode(bIsCombatMode);
+	}
+
 	OnCombatModeToggled(bIsCombatMode);
 }
 
+void ATrustCharacter::ServerSetCombatMode_Implementation(const bool bCombat) {
+	bIsCombatMode = bCombat;
+	ApplyCombatMode(bCombat);
+}
+
+void ATrustCharacter::ApplyCombatMode(const bool bCombat) {
+	//Aim decides where the character faces in combat, movement would keep turning it back
+	GetCharacterMovement()->bOrientRotationToMovement = !bCombat;
+}
+
+void ATrustCharacter::UpdateCursorAim() {
+	const ATrustPlayerController* PlayerController = Cast<ATrustPlayerController>(GetController());
+	FHitResult TraceHitResult;
+	if (!PlayerController || !PlayerController->GetCachedHitResultUnderCursor(ECC_Visibility, true, TraceHitResult) || !TraceHitResult.bBlockingHit) {
+		return;
+	}
+
+	const FVector ToCursor = TraceHitResult.Location - GetActorLocation();
+	if (ToCursor.SizeSquared2D() > KINDA_SMALL_NUMBER) {
+		FRotator NewRotation = GetActorRotation();
+		NewRotation.Yaw = ToCursor.Rotation().Yaw;
+		SetRotation(NewRotation);
+	}
+}
+
 void ATrustCharacter::ToggleAiming() {
 	bIsAiming = !bIsAiming;
 	OnAimToggled(bIsAiming);
 }
 
 void ATrustCharacter::SetRotation(FRotator NewRotation) {
-	if (!HasAuthority()) {
-		Server_SetRotation(NewRotation);
+	SetActorRotation(NewRotation);
+
+	const uint16 QuantizedYaw = FRotator::CompressAxisToShort(NewRotation.Yaw);
+	if (HasAuthority()) {
+		ReplicatedAimYaw = QuantizedYaw;
+	} else if (QuantizedYaw != PendingAimYaw) {
+		PendingAimYaw = QuantizedYaw;
+		LastAimYawChangeTime = GetWorld()->GetTimeSeconds();
+		bAimYawSettled = false;
+		FlushAimYaw();
+	}
+}
+
+void ATrustCharacter::FlushAimYaw() {
+	const float Now = GetWorld()->GetTimeSeconds();
+	if (Now - LastAimYawSendTime < 1.f / AimYawSendRate) {
+		return;
+	}
+
+	if (PendingAimYaw != SentAimYaw) {
+		ServerSetAimYaw(PendingAimYaw);
+		SentAimYaw = PendingAimYaw;
+		LastAimYawSendTime = Now;
+	} else if (!bAimYawSettled && Now - LastAimYawChangeTime > 4.f / AimYawSendRate) {
+		ServerSetAimYaw(PendingAimYaw);
+		bAimYawSettled = true;
+		LastAimYawSendTime = Now;
 	}
+}
 
+void ATrustCharacter::ServerSetAimYaw_Implementation(const uint16 QuantizedYaw) {
+	FRotator NewRotation = GetActorRotation();
+	NewRotation.Yaw = FRotator::DecompressAxisFromShort(QuantizedYaw);
 	SetActorRotation(NewRotation);
+	ReplicatedAimYaw = QuantizedYaw;
 }
 
-void ATrustCharacter::Server_SetRotation_Implementation(FRotator NewRotation) {
-	SetRotation(NewRotation);
+void ATrustCharacter::OnRep_AimYaw() {
+	LastAimYawReceiveTime = GetWorld()->GetTimeSeconds();
 }
 
-void ATrustCharacter::Interact() {
-	GetWorldTimerManager().ClearTimer(TimerHandle_Interact);
+void ATrustCharacter::UpdateSimulatedAim(float DeltaSeconds) {
+	//Once aim updates stop, movement replication owns the rotation again
+	if (GetWorld()->TimeSince(LastAimYawReceiveTime) > 0.5f) {
+		return;
+	}
+
+	const FRotator CurrentRotation = GetActorRotation();
+	FRotator TargetRotation = CurrentRotation;
+	TargetRotation.Yaw = FRotator::DecompressAxisFromShort(ReplicatedAimYaw);
+	if (!CurrentRotation.Equals(TargetRotation, 0.1f)) {
+		SetActorRotation(FMath::RInterpTo(CurrentRotation, TargetRotation, DeltaSeconds, AimYawInterpSpeed));
+	}
+}
+
+bool ATrustCharacter::Interact() {
+	if (UInteractionTimerSubsystem* InteractionTimers = GetInteractionTimers()) {
+		InteractionTimers->CancelInteraction(this);
+	}
 
     if (UInteractionComponent* Interactable = GetInteractable()) {
-    	Interactable->Interact(this);
+    	return Interactable->Interact(this);
     }
+    return false;
 }
 
 void ATrustCharacter::BeginInteraction() {
-	const FVector MousePos = GetMousePosition();
+	//The client already knows what it's focusing, the server only has to check it
+	UInteractionComponent* Target = GetInteractable();
+	const bool bPredict = !HasAuthority() && Target && Target->CanPredictInteract(this);
+
+	//Zero means nothing was predicted, so it's skipped when the id wraps
+	uint16 PredictionId = 0;
+	if (bPredict) {
+		PredictionId = ++LastPredictionId != 0 ? LastPredictionId : ++LastPredictionId;
+	}
 
 	if (!HasAuthority()) {
-    	ServerBeginInteraction(MousePos);
+		UInteractionLatencySubsystem* LatencyStats = GetWorld()->GetSubsystem<UInteractionLatencySubsystem>();
+		const uint16 RequestId = LatencyStats && Target ? LatencyStats->BeginRequest(Target->GetInteractionTime()) : 0;
+    	ServerBeginInteraction(Target, RequestId, PredictionId);
+    } else {
+    	PerformInteractionCheck(GetMousePosition());
     }
 
-	BeginInteraction(MousePos);
+	BeginFocusedInteraction();
+
+	if (bPredict) {
+		PredictInteraction(Target, PredictionId);
+	}
 }
 
-void ATrustCharacter::BeginInteraction(FVector MousePos) {
-	if (HasAuthority()) {
-		PerformInteractionCheck(MousePos);
+void ATrustCharacter::PredictInteraction(UInteractionComponent* Interactable, const uint16 PredictionId) {
+	FPredictedInteraction& Predicted = PredictedInteractions.AddDefaulted_GetRef();
+	Predicted.Interactable = Interactable;
+	Predicted.PredictionId = PredictionId;
+	Predicted.bConfirmed = false;
+	Predicted.PredictedTime = GetWorld()->GetRealTimeSeconds();
+	Predicted.ConfirmedTime = 0.f;
+
+	//Provisional items the interactable's listeners add belong to this prediction
+	PlayerInventory->BeginPredictedItems(PredictionId);
+	Interactable->PredictInteract(this);
+	PlayerInventory->EndPredictedItems();
+
+	if (CVarLogPickupLatency.GetValueOnGameThread() != 0) {
+		UE_LOG(LogTrust, Display, TEXT("Predicted %s, shown after 0 ms"), *GetNameSafe(Interactable->GetOwner()));
 	}
-	
+}
+
+void ATrustCharacter::UpdatePredictedInteractions() {
+	const float Now = GetWorld()->GetRealTimeSeconds();
+
+	for (int32 i = PredictedInteractions.Num() - 1; i >= 0; --i) {
+		const FPredictedInteraction& Predicted = PredictedInteractions[i];
+
+		if (Predicted.bConfirmed) {
+			//Provisional items normally go as the server's stacks arrive, anything left after the timeout never will
+			if (!PlayerInventory->HasPredictedItemsFor(Predicted.PredictionId) || Now - Predicted.ConfirmedTime > PredictedInteractionTimeout) {
+				PlayerInventory->RemovePredictedItemsFor(Predicted.PredictionId);
+				PredictedInteractions.RemoveAtSwap(i);
+			}
+		} else if (Now - Predicted.PredictedTime > PredictedInteractionTimeout) {
+			UE_LOG(LogTrust, Warning, TEXT("Predicted interaction with %s wasn't answered within %.1f s, rolling it back"), *GetNameSafe(Predicted.Interactable.IsValid() ? Predicted.Interactable->GetOwner() : nullptr), PredictedInteractionTimeout);
+			RollbackPredictedInteraction(i);
+		}
+	}
+}
+
+void ATrustCharacter::RollbackPredictedInteraction(const int32 Index) {
+	const FPredictedInteraction Predicted = PredictedInteractions[Index];
+	PredictedInteractions.RemoveAtSwap(Index);
+
+	if (UInteractionComponent* Interactable = Predicted.Interactable.Get()) {
+		Interactable->RollbackPredictedInteract(this);
+	}
+
+	PlayerInventory->RemovePredictedItemsFor(Predicted.PredictionId);
+	INC_DWORD_STAT(STAT_PredictedInteractionsRolledBack);
+}
+
+void ATrustCharacter::ClientConfirmPredictedInteraction_Implementation(const uint16 PredictionId) {
+	FPredictedInteraction* Predicted = PredictedInteractions.FindByPredicate([PredictionId](const FPredictedInteraction& Candidate) { return Candidate.PredictionId == PredictionId; });
+	if (Predicted && !Predicted->bConfirmed) {
+		Predicted->bConfirmed = true;
+		Predicted->ConfirmedTime = GetWorld()->GetRealTimeSeconds();
+		PlayerInventory->ConfirmPredictedItems(PredictionId);
+
+		if (CVarLogPickupLatency.GetValueOnGameThread() != 0) {
+			UE_LOG(LogTrust, Display, TEXT("Predicted interaction confirmed by the server after %.0f ms"), (Predicted->ConfirmedTime - Predicted->PredictedTime) * 1000.f);
+		}
+	}
+}
+
+void ATrustCharacter::ClientRejectPredictedInteraction_Implementation(const uint16 PredictionId) {
+	const int32 Index = PredictedInteractions.IndexOfByPredicate([PredictionId](const FPredictedInteraction& Predicted) { return Predicted.PredictionId == PredictionId; });
+	if (Index != INDEX_NONE) {
+		if (CVarLogPickupLatency.GetValueOnGameThread() != 0) {
+			UE_LOG(LogTrust, Display, TEXT("Predicted interaction rejected by the server after %.0f ms"), (GetWorld()->GetRealTimeSeconds() - PredictedInteractions[Index].PredictedTime) * 1000.f);
+		}
+		RollbackPredictedInteraction(Index);
+	}
+}
+
+bool ATrustCharacter::BeginFocusedInteraction() {
 	InteractionData.bInteractionHeld = true;
 	
 	if (UInteractionComponent* Interactable = GetInteractable()) {
 		Interactable->BeginInteract(this);
 
 		if (FMath::IsNearlyZero(Interactable->GetInteractionTime())) {
-			Interact();
-		} else {
-			GetWorldTimerManager().SetTimer(TimerHandle_Interact, this, &ATrustCharacter::Interact, Interactable->GetInteractionTime(), false);
+			return Interact();
+		} else if (UInteractionTimerSubsystem* InteractionTimers = GetInteractionTimers()) {
+			InteractionTimers->StartInteraction(this, Interactable, Interactable->GetInteractionTime());
 		}
 	}
+	return false;
 }
 
-void ATrustCharacter::ServerBeginInteraction_Implementation(FVector MousePos) {
-	BeginInteraction(MousePos);
+void ATrustCharacter::ServerBeginInteraction_Implementation(UInteractionComponent* Target, const uint16 InLatencyRequestId, const uint16 PredictionId) {
+	LatencyRequestId = InLatencyRequestId;
+	LatencyRequestReceiveTime = GetWorld()->GetTimeSeconds();
+
+	if (!Target || !ValidateInteractionTarget(Target)) {
+		LatencyRequestId = 0;
+		CouldntFindInteractable();
+		if (PredictionId != 0) {
+			ClientRejectPredictedInteraction(PredictionId);
+		}
+		return;
+	}
+
+	if (Target != GetInteractable()) {
+		FoundNewInteractable(Target);
+	}
+
+	const bool bInteracted = BeginFocusedInteraction();
+
+	//Every prediction gets an answer from the interaction's own outcome. The client already hid the owner, so one whose
+	//owner is still standing can't be confirmed either, the client would never see it again
+	if (PredictionId != 0) {
+		const AActor* TargetOwner = Target->GetOwner();
+		const bool bOwnerRemoved = !IsValid(TargetOwner) || TargetOwner->IsPendingKillPending();
+		if (bInteracted && bOwnerRemoved) {
+			ClientConfirmPredictedInteraction(PredictionId);
+		} else {
+			ClientRejectPredictedInteraction(PredictionId);
+		}
+	}
 }
 
-bool ATrustCharacter::ServerBeginInteraction_Validate(FVector MousePos) {
+bool ATrustCharacter::ServerBeginInteraction_Validate(UInteractionComponent* Target, const uint16 InLatencyRequestId, const uint16 PredictionId) {
 	return true;
 }
 
+bool ATrustCharacter::ValidateInteractionTarget(UInteractionComponent* Target) const {
+	AActor* TargetOwner = Target->GetOwner();
+	if (!Target->IsActive() || !TargetOwner || TargetOwner == this) {
+		INC_DWORD_STAT(STAT_ServerInteractionTargetsRejected);
+		return false;
+	}
+
+	const FVector Start = GetActorLocation();
+	const FBox TargetBounds = UInteractionSubsystem::GetInteractableBounds(Target);
+	const float Distance = FMath::Sqrt(TargetBounds.ComputeSquaredDistanceToPoint(Start));
+	const float Reach = Target->GetInteractionDistance();
+	const float MaxReach = Reach + GetInteractionLatencyAllowance();
+
+	if (Distance > MaxReach) {
+		INC_DWORD_STAT(STAT_ServerInteractionTargetsRejected);
+		UE_LOG(LogTrust, Verbose, TEXT("%s rejected interaction with %s, %.0f units away with %.0f reach"), *GetName(), *TargetOwner->GetName(), Distance, MaxReach);
+		return false;
+	}
+
+	//Clearly in reach, nothing else to check unless the view has to be clear as well
+	if (Distance <= Reach && CVarServerInteractionVisibility.GetValueOnGameThread() == 0) {
+		return true;
+	}
+
+	FHitResult TraceHit;
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(ServerInteractionTrace));
+	QueryParams.AddIgnoredActor(this);
+	const FVector End = Start + (TargetBounds.GetCenter() - Start).GetSafeNormal() * MaxReach;
+	INC_DWORD_STAT(STAT_ServerInteractionTraces);
+
+	const bool bHitTarget = GetWorld()->LineTraceSingleByChannel(TraceHit, Start, End, ECC_Visibility, QueryParams) && TraceHit.GetActor() == TargetOwner;
+	if (!bHitTarget) {
+		INC_DWORD_STAT(STAT_ServerInteractionTargetsRejected);
+	}
+	return bHitTarget;
+}
+
+float ATrustCharacter::GetInteractionLatencyAllowance() const {
+	const float PingSeconds = GetPlayerState() ? GetPlayerState()->ExactPing / 1000.f : 0.f;
+	return GetCharacterMovement()->GetMaxSpeed() * PingSeconds + CVarServerInteractionSlack.GetValueOnGameThread();
+}
+
 
 void ATrustCharacter::EndInteract() {
 	if (!HasAuthority()) {
@@ -178,7 +508,9 @@ void ATrustCharacter::EndInteract() {
 
 	InteractionData.bInteractionHeld = false;
 
-	GetWorldTimerManager().ClearTimer(TimerHandle_Interact);
+	if (UInteractionTimerSubsystem* InteractionTimers = GetInteractionTimers()) {
+		InteractionTimers->CancelInteraction(this);
+	}
 
 	if (UInteractionComponent* Interactable = GetInteractable()) {
 		Interactable->EndInteract(this);
@@ -186,19 +518,40 @@ void ATrustCharacter::EndInteract() {
 }
 
 void ATrustCharacter::ServerEndInteraction_Implementation() {
+	//A hold interaction let go early never reaches OnInteract
+	LatencyRequestId = 0;
 	EndInteract();
 }
 
+void ATrustCharacter::NotifyInteractFired() {
+	if (HasAuthority() && LatencyRequestId != 0) {
+		ClientInteractionLatencyAck(LatencyRequestId, LatencyRequestReceiveTime, GetWorld()->GetTimeSeconds());
+		LatencyRequestId = 0;
+	}
+}
+
+void ATrustCharacter::ClientInteractionLatencyAck_Implementation(const uint16 RequestId, const float ServerReceiveTime, const float ServerInteractTime) {
+	if (UInteractionLatencySubsystem* LatencyStats = GetWorld()->GetSubsystem<UInteractionLatencySubsystem>()) {
+		LatencyStats->CompleteRequest(RequestId, ServerReceiveTime, ServerInteractTime);
+	}
+}
+
 bool ATrustCharacter::ServerEndInteraction_Validate() {
 	return true;
 }
 
 bool ATrustCharacter::IsInteracting() const {
-	return GetWorldTimerManager().IsTimerActive(TimerHandle_Interact);
+	const UInteractionTimerSubsystem* InteractionTimers = GetInteractionTimers();
+	return InteractionTimers && InteractionTimers->IsInteracting(this);
 }
 
 float ATrustCharacter::GetRemainingInteractTime() const {
-	return GetWorldTimerManager().GetTimerRemaining(TimerHandle_Interact);
+	const UInteractionTimerSubsystem* InteractionTimers = GetInteractionTimers();
+	return InteractionTimers ? InteractionTimers->GetRemainingTime(this) : 0.f;
+}
+
+UInteractionTimerSubsystem* ATrustCharacter::GetInteractionTimers() const {
+	return GetWorld() ? GetWorld()->GetSubsystem<UInteractionTimerSubsystem>() : nullptr;
 }
 
 void ATrustCharacter::PerformInteractionCheck(FVector MousePos) {
@@ -215,9 +568,41 @@ void ATrustCharacter::PerformInteractionCheck(FVector MousePos) {
 	FHitResult TraceHit;
 	FCollisionQueryParams QueryParams;
 	QueryParams.AddIgnoredActor(this);
+
+	//The registry already knows every active interactable nearby, so only the stretch of the ray up to the one it picks
+	//needs tracing, to make sure no wall stands in between
+	if (UInteractionSubsystem* Registry = GetInteractionRegistry()) {
+		float Distance = 0.f;
+		UInteractionComponent* InteractionComponent = Registry->FindInteractableAlongRay(Start, InteractVector, this, Distance);
+		if (!InteractionComponent) {
+			CouldntFindInteractable();
+			return;
+		}
+
+		bool bHit = false;
+		if (Distance > KINDA_SMALL_NUMBER) {
+			SCOPE_CYCLE_COUNTER(STAT_InteractionSyncTraces);
+			const FVector CandidateEnd = Start + InteractVector.GetSafeNormal() * Distance;
+			bHit = GetWorld()->LineTraceSingleByChannel(TraceHit, Start, CandidateEnd, ECC_Visibility, QueryParams);
+		}
+
+		HandleFocusCandidateConfirmed(Start, InteractionComponent, bHit ? &TraceHit : nullptr);
+		return;
+	}
+
 	// DrawDebugLine(GetWorld(), Start, End, FColor::Purple, false, 2.f);
-	if (GetWorld()->LineTraceSingleByChannel(TraceHit, Start, End, ECC_Visibility, QueryParams)) {
-		AActor* TraceHitActor = TraceHit.GetActor();
+	bool bHit;
+	{
+		SCOPE_CYCLE_COUNTER(STAT_InteractionSyncTraces);
+		bHit = GetWorld()->LineTraceSingleByChannel(TraceHit, Start, End, ECC_Visibility, QueryParams);
+	}
+
+	HandleInteractionTraceHit(Start, bHit ? &TraceHit : nullptr);
+}
+
+void ATrustCharacter::HandleInteractionTraceHit(const FVector& Start, const FHitResult* TraceHit) {
+	if (TraceHit) {
+		AActor* TraceHitActor = TraceHit->GetActor();
 		if (TraceHitActor) {
 			// UE_LOG(LogLevel, Warning, TEXT("Found: %s"), *TraceHitActor->GetName());
 
@@ -226,7 +611,7 @@ void ATrustCharacter::PerformInteractionCheck(FVector MousePos) {
 			
 			if (InteractionComponent) {
 				
-            	float Distance = (Start - TraceHit.ImpactPoint).Size();
+            	float Distance = (Start - TraceHit->ImpactPoint).Size();
             	
             	if (InteractionComponent != GetInteractable() && Distance <= InteractionComponent->GetInteractionDistance()) {
             		FoundNewInteractable(InteractionComponent);
@@ -242,10 +627,107 @@ void ATrustCharacter::PerformInteractionCheck(FVector MousePos) {
 	CouldntFindInteractable();
 }
 
+void ATrustCharacter::HandleFocusCandidateConfirmed(const FVector& Start, UInteractionComponent* Candidate, const FHitResult* ConfirmHit) {
+	if (!ConfirmHit || ConfirmHit->GetActor() == Candidate->GetOwner()) {
+		if (Candidate != GetInteractable()) {
+			FoundNewInteractable(Candidate);
+		}
+		return;
+	}
+
+	//Whatever blocks the view is also the first thing a full trace would hit, let the trace rules decide
+	HandleInteractionTraceHit(Start, ConfirmHit);
+}
+
+void ATrustCharacter::PerformAsyncInteractionCheck(const ATrustPlayerController* PlayerController) {
+	SCOPE_CYCLE_COUNTER(STAT_InteractionAsyncTraceRequests);
+
+	//Last frame's cursor hit drives this frame's focus, the sync path would have traced for both right here.
+	//A miss leaves the location at zero, like the hit result GetMousePosition would return
+	FHitResult CursorHit;
+	if (PlayerController->GetLastHitResultUnderCursor(ECC_Visibility, true, CursorHit)) {
+		const FVector MousePosition = CursorHit.Location;
+		if (!bFocusTracePending) {
+			InteractionData.LastInteractionCheckTime = GetWorld()->GetTimeSeconds();
+
+			const FVector Start = GetActorLocation();
+			const FVector InteractVector = MousePosition - Start;
+			FVector End = Start + InteractVector.GetSafeNormal() * InteractionCheckDistance;
+
+			//With the registry the trace only confirms nothing blocks the view to the interactable it picks, same as the sync check
+			bool bNeedsTrace = true;
+			FocusTraceCandidate = nullptr;
+			if (UInteractionSubsystem* Registry = GetInteractionRegistry()) {
+				float Distance = 0.f;
+				UInteractionComponent* Candidate = Registry->FindInteractableAlongRay(Start, InteractVector, this, Distance);
+				bNeedsTrace = Candidate && Distance > KINDA_SMALL_NUMBER;
+
+				if (!Candidate) {
+					CouldntFindInteractable();
+				} else if (!bNeedsTrace) {
+					HandleFocusCandidateConfirmed(Start, Candidate, nullptr);
+				} else {
+					FocusTraceCandidate = Candidate;
+					End = Start + InteractVector.GetSafeNormal() * Distance;
+				}
+			}
+
+			if (bNeedsTrace) {
+				FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(InteractionFocusTrace));
+				QueryParams.AddIgnoredActor(this);
+				GetWorld()->AsyncLineTraceByChannel(EAsyncTraceType::Single, Start, End, ECC_Visibility, QueryParams, FCollisionResponseParams::DefaultResponseParam, &FocusTraceDelegate);
+				bFocusTracePending = true;
+				INC_DWORD_STAT(STAT_InteractionAsyncTraces);
+			}
+		}
+	}
+
+	FVector CursorOrigin, CursorDirection;
+	if (!bCursorTracePending && PlayerController->DeprojectMousePositionToWorld(CursorOrigin, CursorDirection)) {
+		//Same query GetHitResultUnderCursor makes
+		const FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(ClickableTrace), true);
+		const FVector CursorEnd = CursorOrigin + CursorDirection * PlayerController->HitResultTraceDistance;
+		GetWorld()->AsyncLineTraceByChannel(EAsyncTraceType::Single, CursorOrigin, CursorEnd, ECC_Visibility, QueryParams, FCollisionResponseParams::DefaultResponseParam, &CursorTraceDelegate);
+		bCursorTracePending = true;
+		INC_DWORD_STAT(STAT_InteractionAsyncTraces);
+	}
+}
+
+void ATrustCharacter::OnCursorTraceDone(const FTraceHandle& TraceHandle, FTraceDatum& TraceDatum) {
+	bCursorTracePending = false;
+
+	//Published as this frame's complex cursor hit, so aiming reads it from the cache instead of tracing again. Click to move
+	//traces simple collision, like it always did, and keeps its own entry
+	if (ATrustPlayerController* PlayerController = Cast<ATrustPlayerController>(GetController())) {
+		const bool bHit = TraceDatum.OutHits.Num() > 0 && TraceDatum.OutHits[0].bBlockingHit;
+		PlayerController->PublishHitResultUnderCursor(ECC_Visibility, true, bHit ? TraceDatum.OutHits[0] : FHitResult());
+	}
+}
+
+void ATrustCharacter::OnFocusTraceDone(const FTraceHandle& TraceHandle, FTraceDatum& TraceDatum) {
+	bFocusTracePending = false;
+
+	UInteractionComponent* Candidate = FocusTraceCandidate.Get();
+	FocusTraceCandidate = nullptr;
+
+	if (GetController()) {
+		const bool bHit = TraceDatum.OutHits.Num() > 0 && TraceDatum.OutHits[0].bBlockingHit;
+		if (Candidate) {
+			HandleFocusCandidateConfirmed(TraceDatum.Start, Candidate, bHit ? &TraceDatum.OutHits[0] : nullptr);
+		} else {
+			HandleInteractionTraceHit(TraceDatum.Start, bHit ? &TraceDatum.OutHits[0] : nullptr);
+		}
+	}
+}
+
+UInteractionSubsystem* ATrustCharacter::GetInteractionRegistry() const {
+	return CVarUseInteractionRegistry.GetValueOnGameThread() != 0 ? GetWorld()->GetSubsystem<UInteractionSubsystem>() : nullptr;
+}
+
 void ATrustCharacter::CouldntFindInteractable() {
-	if (GetWorldTimerManager().IsTimerActive(TimerHandle_Interact)) {
-    	GetWorldTimerManager().ClearTimer(TimerHandle_Interact);
-    }
+	if (UInteractionTimerSubsystem* InteractionTimers = GetInteractionTimers()) {
+		InteractionTimers->CancelInteraction(this);
+	}
 
     //Tell the interactable we've stopped focusing on it, and clear the current interactable
     if (UInteractionComponent* Interactable = GetInteractable()) {
@@ -275,17 +757,27 @@ void ATrustCharacter::FoundNewInteractable(UInteractionComponent* Interactable)
 FVector ATrustCharacter::GetMousePosition() const {
 	FHitResult CursorTraceHit;
 	const ATrustPlayerController* CurrentPlayerController = Cast<ATrustPlayerController>(GetController());
-	CurrentPlayerController->GetHitResultUnderCursor(ECC_Visibility, true, CursorTraceHit);
+	SCOPE_CYCLE_COUNTER(STAT_InteractionSyncTraces);
+	CurrentPlayerController->GetCachedHitResultUnderCursor(ECC_Visibility, true, CursorTraceHit);
 	return CursorTraceHit.Location;
 }
 
 void ATrustCharacter::UseItem(UItem* Item) {
 	if (!HasAuthority() && Item) {
-		ServerUseItem(Item);
+		if (Item->IsStackView()) {
+			ServerUseItemOfClass(Item->GetClass());
+		} else {
+			ServerUseItem(Item);
+		}
 	}
 	
 	if (HasAuthority()) {
-		if (PlayerInventory && !PlayerInventory->FindItem(Item)) {
+		//A stack view only mirrors a compact stack, Use needs the real item
+		if (PlayerInventory && Item && Item->IsStackView()) {
+			Item = PlayerInventory->FindOrMaterializeItemByClass(Item->GetClass());
+		}
+
+		if (PlayerInventory && !PlayerInventory->ContainsItem(Item)) {
 			return;
 		}
 	}
@@ -299,7 +791,11 @@ void ATrustCharacter::UseItem(UItem* Item) {
 void ATrustCharacter::DropItem(UItem* Item, const int32 Quantity) {
 	if (PlayerInventory && Item && PlayerInventory->FindItem(Item)) {
 		if (!HasAuthority()) {
-			ServerDropItem(Item, Quantity);
+			if (Item->IsStackView()) {
+				ServerDropItemOfClass(Item->GetClass(), Quantity);
+			} else {
+				ServerDropItem(Item, Quantity);
+			}
 			return;
 		}
 
@@ -307,53 +803,69 @@ void ATrustCharacter::DropItem(UItem* Item, const int32 Quantity) {
 			const int32 ItemQuantity = Item->GetQuantity();
 			const int32 DroppedQuantity = PlayerInventory->ConsumeItem(Item, Quantity);
 			
-			FActorSpawnParameters SpawnParameters;
-			SpawnParameters.Owner = this;
-			SpawnParameters.bNoFail = true;
-			SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+			SpawnDroppedPickup(Item->GetClass(), DroppedQuantity);
+		}
+	}
+}
 
-			FVector SpawnLocation = GetActorLocation();
-			SpawnLocation.Z -= GetCapsuleComponent()->GetScaledCapsuleHalfHeight();
+void ATrustCharacter::SpawnDroppedPickup(TSubclassOf<UItem> ItemClass, const int32 Quantity) {
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.Owner = this;
+	SpawnParameters.bNoFail = true;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
 
-			FTransform SpawnTransform(GetActorRotation(), SpawnLocation);
+	FVector SpawnLocation = GetActorLocation();
+	SpawnLocation.Z -= GetCapsuleComponent()->GetScaledCapsuleHalfHeight();
 
-			ensure(PickupClass);
+	FTransform SpawnTransform(GetActorRotation(), SpawnLocation);
 
-			APickup *Pickup = GetWorld()->SpawnActor<APickup>(PickupClass, SpawnTransform, SpawnParameters);
-			Pickup->InitializePickup(Item->GetClass(), DroppedQuantity);
-		}
-	}
+	ensure(PickupClass);
+
+	APickup *Pickup = GetWorld()->SpawnActor<APickup>(PickupClass, SpawnTransform, SpawnParameters);
+	Pickup->InitializePickup(ItemClass, Quantity);
 }
 
 bool ATrustCharacter::EquipItem(UEquippableItem* Item) {
-	EquippedItems.Add(Item->GetSlot(), Item);
+	const int32 Slot = (int32)Item->GetSlot();
+	EquippedItems[Slot] = Item;
+	if (HasAuthority()) {
+		EquippedClasses[Slot] = Item->GetClass();
+		AppliedEquippedClasses[Slot] = Item->GetClass();
+	}
+
 	OnEquippedItemsChanged.Broadcast(Item->GetSlot(), Item);
+	OnEquippedClassChanged.Broadcast(Item->GetSlot(), Item->GetClass());
 	return true;
 }
 
 bool ATrustCharacter::UnEquipItem(UEquippableItem* Item) {
-	if (Item) {
-		if (EquippedItems.Contains(Item->GetSlot())) {
-			if (Item == *EquippedItems.Find(Item->GetSlot())) {
-				EquippedItems.Remove(Item->GetSlot());
-				OnEquippedItemsChanged.Broadcast(Item->GetSlot(), nullptr);
-				return true;
-			}
+	if (Item && EquippedItems[(int32)Item->GetSlot()] == Item) {
+		const int32 Slot = (int32)Item->GetSlot();
+		EquippedItems[Slot] = nullptr;
+		if (HasAuthority()) {
+			EquippedClasses[Slot] = nullptr;
+			AppliedEquippedClasses[Slot] = nullptr;
 		}
+
+		OnEquippedItemsChanged.Broadcast(Item->GetSlot(), nullptr);
+		OnEquippedClassChanged.Broadcast(Item->GetSlot(), nullptr);
+		return true;
 	}
 	return false;
 }
 
 void ATrustCharacter::EquipArmor(const UArmorItem* Armor) {
-	if (USkeletalMeshComponent *GearMesh = *PlayerMeshes.Find(Armor->GetSlot())) {
+	if (USkeletalMeshComponent *GearMesh = GetSlotSkeletalMeshComponent(Armor->GetSlot())) {
 		GearMesh->SetSkeletalMesh(Armor->GetMesh());
 		GearMesh->SetMaterial(GearMesh->GetMaterials().Num() - 1, Armor->GetMaterialInstance());
+		RequestMergedMeshRefresh();
 	}
 }
 
 void ATrustCharacter::UnEquipArmor(const EEquippableSlot Slot) {
-	if (USkeletalMeshComponent *EquippableMesh = *PlayerMeshes.Find(Slot)) {
+	if (USkeletalMeshComponent *EquippableMesh = GetSlotSkeletalMeshComponent(Slot)) {
 		EquippableMesh->SetSkeletalMesh(nullptr);
+		RequestMergedMeshRefresh();
 		// if (USkeletalMesh *BodyMesh = *NakedMeshes.Find(Slot)) {
 		// 	EquippableMesh->SetSkeletalMesh(BodyMesh);
 		//
@@ -368,25 +880,255 @@ void ATrustCharacter::UnEquipArmor(const EEquippableSlot Slot) {
 	}
 }
 
+bool ATrustCharacter::ShouldMergeArmorMeshes() const {
+	//Nothing is rendered on a dedicated server
+	return bMergeArmorMeshes && CVarAllowMergedMeshes.GetValueOnGameThread() != 0 && !IsNetMode(NM_DedicatedServer);
+}
+
+void ATrustCharacter::RequestMergedMeshRefresh() {
+	if (!bMergedMeshDirty && BaseBodyMesh && HasActorBegunPlay()) {
+		bMergedMeshDirty = true;
+		GetWorldTimerManager().SetTimerForNextTick(this, &ATrustCharacter::RefreshMergedMesh);
+	}
+}
+
+void ATrustCharacter::RefreshMergedMesh() {
+	bMergedMeshDirty = false;
+
+	if (!ShouldMergeArmorMeshes()) {
+		UseSeparateArmorMeshes();
+		return;
+	}
+
+	TArray<USkeletalMeshComponent*> Parts = PlayerMeshes;
+	Parts.RemoveAllSwap([](const USkeletalMeshComponent* Part) { return Part == nullptr; });
+
+	UCharacterMeshMergeSubsystem* MeshMerger = GetWorld()->GetSubsystem<UCharacterMeshMergeSubsystem>();
+	USkeletalMesh* MergedMesh = MeshMerger ? MeshMerger->GetMergedMesh(BaseBodyMesh, Parts) : nullptr;
+	if (!MergedMesh) {
+		UseSeparateArmorMeshes();
+		return;
+	}
+
+	if (!bUsingMergedMesh) {
+		bUsingMergedMesh = true;
+		for (USkeletalMeshComponent* Part : Parts) {
+			Part->UnregisterComponent();
+		}
+	}
+
+	//Same skeleton, so the animation carries on without reinitializing the pose
+	GetMesh()->EmptyOverrideMaterials();
+	GetMesh()->SetSkeletalMesh(MergedMesh, false);
+}
+
+void ATrustCharacter::UseSeparateArmorMeshes() {
+	if (!bUsingMergedMesh) {
+		return;
+	}
+
+	bUsingMergedMesh = false;
+	GetMesh()->SetSkeletalMesh(BaseBodyMesh, false);
+	for (USkeletalMeshComponent* PlayerMesh : PlayerMeshes) {
+		if (PlayerMesh) {
+			PlayerMesh->RegisterComponent();
+		}
+	}
+}
+
+void ATrustCharacter::CaptureInventorySnapshot(FInventorySnapshot& OutSnapshot) const {
+	OutSnapshot.Reset();
+
+	if (PlayerInventory) {
+		TMap<const UItem*, int32> StackIndices;
+		PlayerInventory->CaptureSnapshot(OutSnapshot, &StackIndices);
+
+		for (int32 Slot = 0; Slot < EquippedItems.Num(); ++Slot) {
+			if (const int32* StackIndex = EquippedItems[Slot] ? StackIndices.Find(EquippedItems[Slot]) : nullptr) {
+				OutSnapshot.AddEquipment((uint8)Slot, *StackIndex);
+			}
+		}
+	}
+}
+
+bool ATrustCharacter::RestoreInventorySnapshot(const FInventorySnapshot& Snapshot) {
+	if (!HasAuthority() || !PlayerInventory) {
+		return false;
+	}
+
+	for (UEquippableItem* Equipped : TArray<UEquippableItem*>(EquippedItems)) {
+		UnEquipItem(Equipped);
+	}
+
+	TArray<UItem*> RestoredItems;
+	const bool bRestoredAll = PlayerInventory->RestoreSnapshot(Snapshot, &RestoredItems);
+
+	//Equipping goes through Use so the item applies its meshes and stats the same way it does when a player equips it
+	for (const FInventorySnapshotEquipment& Equipped : Snapshot.Equipment) {
+		if (UEquippableItem* Item = Cast<UEquippableItem>(RestoredItems[Equipped.StackIndex])) {
+			UseItem(Item);
+		}
+	}
+
+	return bRestoredAll;
+}
+
 USkeletalMeshComponent* ATrustCharacter::GetSlotSkeletalMeshComponent(const EEquippableSlot Slot) {
-	if (PlayerMeshes.Contains(Slot)) {
-		return *PlayerMeshes.Find(Slot);
+	return PlayerMeshes.IsValidIndex((int32)Slot) ? PlayerMeshes[(int32)Slot] : nullptr;
+}
+
+TMap<EEquippableSlot, UEquippableItem*> ATrustCharacter::GetEquippedItems() const {
+	TMap<EEquippableSlot, UEquippableItem*> Result;
+	for (int32 Slot = 0; Slot < EquippedItems.Num(); ++Slot) {
+		if (EquippedItems[Slot]) {
+			Result.Add((EEquippableSlot)Slot, EquippedItems[Slot]);
+		}
 	}
-	return nullptr;
+	return Result;
+}
+
+UEquippableItem* ATrustCharacter::GetEquippedItem(const EEquippableSlot Slot) const {
+	return EquippedItems.IsValidIndex((int32)Slot) ? EquippedItems[(int32)Slot] : nullptr;
+}
+
+void ATrustCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const {
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	//The owner has the items themselves
+	DOREPLIFETIME_CONDITION(ATrustCharacter, EquippedClasses, COND_SimulatedOnly);
+	DOREPLIFETIME_CONDITION(ATrustCharacter, ReplicatedAimYaw, COND_SimulatedOnly);
+}
+
+void ATrustCharacter::OnRep_EquippedClasses() {
+	uint32 ChangedSlots = 0;
+	for (int32 Slot = 0; Slot < EquippedClasses.Num() && Slot < NumEquipmentSlots; ++Slot) {
+		if (EquippedClasses[Slot] != AppliedEquippedClasses[Slot]) {
+			ChangedSlots |= 1u << Slot;
+		}
+	}
+
+	for (int32 Slot = 0; ChangedSlots != 0; ++Slot, ChangedSlots >>= 1) {
+		if (ChangedSlots & 1u) {
+			ApplyEquippedClass(Slot);
+		}
+	}
+}
+
+void ATrustCharacter::ApplyEquippedClass(const int32 Slot) {
+	const TSubclassOf<UEquippableItem> ItemClass = EquippedClasses[Slot];
+	AppliedEquippedClasses[Slot] = ItemClass;
+
+	//Armor looks the same for every item of a class, so the class default is all a remote client needs
+	if (const UArmorItem* Armor = ItemClass ? Cast<UArmorItem>(ItemClass->GetDefaultObject()) : nullptr) {
+		EquipArmor(Armor);
+	} else {
+		UnEquipArmor((EEquippableSlot)Slot);
+	}
+
+	OnEquippedClassChanged.Broadcast((EEquippableSlot)Slot, ItemClass);
 }
 
 void ATrustCharacter::ServerDropItem_Implementation(UItem* Item, int32 Quantity) {
 	DropItem(Item, Quantity);
 }
 
+void ATrustCharacter::ServerDropItemOfClass_Implementation(TSubclassOf<UItem> ItemClass, int32 Quantity) {
+	if (PlayerInventory && ItemClass) {
+		const int32 DroppedQuantity = PlayerInventory->ConsumeItemOfClass(ItemClass, Quantity);
+
+		if (DroppedQuantity > 0) {
+			SpawnDroppedPickup(ItemClass, DroppedQuantity);
+		}
+	}
+}
+
+void ATrustCharacter::TransferItem(UItem* Item, UInventoryComponent* From, UInventoryComponent* To, const int32 Quantity) {
+	if (!HasAuthority()) {
+		if (Item && Item->IsStackView()) {
+			ServerTransferItemOfClass(Item->GetClass(), From, To, Quantity);
+		} else {
+			ServerTransferItem(Item, From, To, Quantity);
+		}
+		return;
+	}
+
+	if (!From || !To || From == To || (From != PlayerInventory && To != PlayerInventory)) {
+		return;
+	}
+
+	if (!From->ContainsItem(Item) || !CanAccessInventory(From) || !CanAccessInventory(To)) {
+		UE_LOG(LogTrust, Verbose, TEXT("%s can't move %s from %s to %s"), *GetName(), *GetNameSafe(Item), *GetPathNameSafe(From), *GetPathNameSafe(To));
+		return;
+	}
+
+	From->TransferItem(Item, To, Quantity);
+}
+
+bool ATrustCharacter::CanAccessInventory(const UInventoryComponent* Inventory) const {
+	if (!Inventory) {
+		return false;
+	}
+
+	if (Inventory == PlayerInventory) {
+		return true;
+	}
+
+	//Anything the character owns, like a pack animal or a placed stash, is theirs to loot from anywhere
+	const AActor* InventoryOwner = Inventory->GetOwner();
+	if (!InventoryOwner || InventoryOwner->IsPendingKillPending()) {
+		return false;
+	}
+	if (InventoryOwner->GetOwner() == this) {
+		return true;
+	}
+
+	//Anything else has to be the loot source the server let this character open, and still be in reach
+	UInteractionComponent* Interactable = GetInteractable();
+	return Interactable && Interactable->GetOwner() == InventoryOwner && ValidateInteractionTarget(Interactable);
+}
+
+void ATrustCharacter::ServerTransferItem_Implementation(UItem* Item, UInventoryComponent* From, UInventoryComponent* To, int32 Quantity) {
+	TransferItem(Item, From, To, Quantity);
+}
+
+bool ATrustCharacter::ServerTransferItem_Validate(UItem* Item, UInventoryComponent* From, UInventoryComponent* To, int32 Quantity) {
+	//A client only ever moves items in or out of its own inventory
+	return Quantity > 0 && From != To && (From == PlayerInventory || To == PlayerInventory);
+}
+
+void ATrustCharacter::ServerTransferItemOfClass_Implementation(TSubclassOf<UItem> ItemClass, UInventoryComponent* From, UInventoryComponent* To, int32 Quantity) {
+	if (From && ItemClass) {
+		TransferItem(From->FindItemByClass(ItemClass), From, To, Quantity);
+	}
+}
+
+bool ATrustCharacter::ServerTransferItemOfClass_Validate(TSubclassOf<UItem> ItemClass, UInventoryComponent* From, UInventoryComponent* To, int32 Quantity) {
+	return Quantity > 0 && From != To && (From == PlayerInventory || To == PlayerInventory);
+}
+
 void ATrustCharacter::ServerUseItem_Implementation(UItem* Item) {
 	UseItem(Item);
 }
 
+void ATrustCharacter::ServerUseItemOfClass_Implementation(TSubclassOf<UItem> ItemClass) {
+	//Using a compact stack needs an object to call Use on, from here on the stack replicates as a normal item
+	if (PlayerInventory && ItemClass) {
+		UseItem(PlayerInventory->FindOrMaterializeItemByClass(ItemClass));
+	}
+}
+
 bool ATrustCharacter::ServerDropItem_Validate(UItem* Item, int32 Quantity) {
 	return true;
 }
 
+bool ATrustCharacter::ServerDropItemOfClass_Validate(TSubclassOf<UItem> ItemClass, int32 Quantity) {
+	return true;
+}
+
 bool ATrustCharacter::ServerUseItem_Validate(UItem* Item) {
 	return true;
 }
+
+bool ATrustCharacter::ServerUseItemOfClass_Validate(TSubclassOf<UItem> ItemClass) {
+	return true;
+}
@@ -5,9 +5,14 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
 #include "Items/EquippableItem.h"
+#include "WorldCollision.h"
 #include "TrustCharacter.generated.h"
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnEquippedItemsChanged, const EEquippableSlot, Slot, const UEquippableItem*, Item);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnEquippedClassChanged, const EEquippableSlot, Slot, TSubclassOf<UEquippableItem>, ItemClass);
+
+//Room for every EEquippableSlot value, equipment is stored in arrays indexed by slot
+static constexpr int32 NumEquipmentSlots = 16;
 
 USTRUCT()
 struct FInteractionData {
@@ -29,10 +34,28 @@ struct FInteractionData {
 	bool bInteractionHeld;
 };
 
+/**An interaction the client already shows as done while it waits for the server's verdict*/
+struct FPredictedInteraction {
+	TWeakObjectPtr<class UInteractionComponent> Interactable;
+
+	//Sent with ServerBeginInteraction, the server confirms or rejects this prediction by it
+	uint16 PredictionId;
+
+	//Confirmed predictions are only kept until the server's inventory catches up with their provisional items
+	bool bConfirmed;
+
+	float PredictedTime;
+
+	float ConfirmedTime;
+};
+
 UCLASS(Blueprintable)
-class ATrustCharacter : public ACharacter {
+class TRUST_API ATrustCharacter : public ACharacter {
 	GENERATED_BODY()
 
+	//Drives interactions from the networked automation tests
+	friend struct FInteractionNetworkTestDriver;
+
 public:
 	ATrustCharacter();
 
@@ -41,10 +64,48 @@ private:
 	
 	uint32 bIsAiming;
 
-	FTimerHandle TimerHandle_Interact;
-
 	UPROPERTY()
 	FInteractionData InteractionData;
+
+	//Async interaction checks, each trace's result is applied at the start of the frame after it was requested
+	FTraceDelegate CursorTraceDelegate;
+
+	FTraceDelegate FocusTraceDelegate;
+
+	uint32 bCursorTracePending;
+
+	uint32 bFocusTracePending;
+
+	//The interactable the registry picked when the pending focus trace is only confirming nothing blocks the view to it
+	TWeakObjectPtr<class UInteractionComponent> FocusTraceCandidate;
+
+	uint32 bMergedMeshDirty;
+
+	//Aim yaw the owning client has set and what it last sent, both quantized
+	uint16 PendingAimYaw;
+
+	uint16 SentAimYaw;
+
+	float LastAimYawSendTime;
+
+	float LastAimYawChangeTime;
+
+	//Sends go unreliably, the settled yaw is sent once more in case the last change was lost
+	uint32 bAimYawSettled;
+
+	float LastAimYawReceiveTime;
+
+	uint32 bUsingMergedMesh;
+
+	TArray<FPredictedInteraction> PredictedInteractions;
+
+	//Last id handed to a predicted interaction, 0 is never used so it can mean no prediction
+	uint16 LastPredictionId;
+
+	//Server side of the interaction the owning client is measuring, 0 when it isn't
+	uint16 LatencyRequestId;
+
+	float LatencyRequestReceiveTime;
 	
 	/** Top down camera */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Camera, meta = (AllowPrivateAccess = "true"))
@@ -60,6 +121,22 @@ protected:
 
 	UPROPERTY(EditDefaultsOnly, Category = "Interaction")
     float InteractionCheckDistance;
+
+	/**Aim yaw updates the owning client sends per second at most while the aim changes*/
+	UPROPERTY(EditDefaultsOnly, Category = "Combat", meta = (ClampMin = 1.0))
+	float AimYawSendRate;
+
+	/**How fast other clients turn a character towards its replicated aim yaw*/
+	UPROPERTY(EditDefaultsOnly, Category = "Combat")
+	float AimYawInterpSpeed;
+
+	/**Quantized yaw the owner aims at, compressed like FRotator::CompressAxisToShort*/
+	UPROPERTY(ReplicatedUsing = OnRep_AimYaw)
+	uint16 ReplicatedAimYaw;
+
+	/**Seconds a predicted interaction may go unconfirmed before the client rolls it back on its own*/
+	UPROPERTY(EditDefaultsOnly, Category = "Interaction")
+	float PredictedInteractionTimeout;
 		
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Components")
 	class UInventoryComponent *PlayerInventory;
@@ -68,16 +145,30 @@ protected:
 	TSubclassOf<class APickup> PickupClass;
 
 	UPROPERTY(VisibleAnywhere, Category = "Items")
-    TMap<EEquippableSlot, UEquippableItem*> EquippedItems;
+    TArray<UEquippableItem*> EquippedItems;
+
+	/**Class of the item in each slot, all simulated proxies need to show the gear. The array never changes size, so only the
+	 * slots that changed are sent and each class goes over the wire as its net GUID*/
+	UPROPERTY(ReplicatedUsing = OnRep_EquippedClasses)
+	TArray<TSubclassOf<UEquippableItem>> EquippedClasses;
 
+	//What this client last applied to the slot meshes, to find which slots a replication update changed
+	UPROPERTY(Transient)
+	TArray<TSubclassOf<UEquippableItem>> AppliedEquippedClasses;
+
+	/**Only where the items themselves exist, the server and the owning client*/
 	UPROPERTY(BlueprintAssignable, Category = "Items")
 	FOnEquippedItemsChanged OnEquippedItemsChanged;
 
+	/**Everywhere, simulated proxies included. Only the item's class, proxies never get the item itself*/
+	UPROPERTY(BlueprintAssignable, Category = "Items")
+	FOnEquippedClassChanged OnEquippedClassChanged;
+
 	UPROPERTY(BlueprintReadOnly, Category = Mesh)
     TMap<EEquippableSlot, USkeletalMesh*> NakedMeshes;
 
     UPROPERTY(BlueprintReadOnly, Category = Mesh)
-    TMap<EEquippableSlot, USkeletalMeshComponent*> PlayerMeshes;
+    TArray<USkeletalMeshComponent*> PlayerMeshes;
 
 	UPROPERTY(EditAnywhere, Category = "Components")
 	USkeletalMeshComponent *HeadMesh;
@@ -93,6 +184,15 @@ protected:
 
 	UPROPERTY(EditAnywhere, Category = "Components")
 	USkeletalMeshComponent *HandsMesh;
+
+	/**Renders the body and armor parts as one merged mesh on GetMesh(). The part components then only hold what's worn
+	 * and are kept out of the scene, rebuilt once per frame at most when armor changes*/
+	UPROPERTY(EditDefaultsOnly, Category = Mesh)
+	bool bMergeArmorMeshes;
+
+	//The body GetMesh() had before merged meshes replaced it
+	UPROPERTY()
+	USkeletalMesh *BaseBodyMesh;
 	
 	// UPROPERTY(VisibleAnywhere, ReplicatedUsing = OnRep_EquippedWeapon)
  //    class AWeapon *EquippedWeapon;
@@ -112,6 +212,9 @@ public:
 	bool IsInteracting() const;
 
 	float GetRemainingInteractTime() const;
+
+	/**Called as an interactable fires OnInteract for this character, answers the client if it's measuring latency*/
+	void NotifyInteractFired();
 	
 	FORCEINLINE UInventoryComponent* GetPlayerInventory() const { return PlayerInventory; }
 	
@@ -121,11 +224,35 @@ public:
     UFUNCTION(Server, Reliable, WithValidation)
     void ServerUseItem(class UItem *Item);
 
+    /**Stack views stand in for compact stacks and aren't replicated, so those are used by class*/
+    UFUNCTION(Server, Reliable, WithValidation)
+    void ServerUseItemOfClass(TSubclassOf<class UItem> ItemClass);
+
     UFUNCTION(BlueprintCallable, Category = "Items")
     void DropItem(class UItem *Item, const int32 Quantity);
 
     UFUNCTION(Server, Reliable, WithValidation)
     void ServerDropItem(class UItem *Item, const int32 Quantity);
+
+    /**Used for compact stacks, which only exist as a local view on the client and can't be sent as an object*/
+    UFUNCTION(Server, Reliable, WithValidation)
+    void ServerDropItemOfClass(TSubclassOf<class UItem> ItemClass, const int32 Quantity);
+
+    /**Moves an item between the player's inventory and another inventory, like a loot source. One side must be the player's and
+     * the server only accepts the other side if CanAccessInventory allows it*/
+    UFUNCTION(BlueprintCallable, Category = "Items")
+    void TransferItem(class UItem *Item, class UInventoryComponent *From, class UInventoryComponent *To, const int32 Quantity);
+
+    /**Server check for TransferItem. The player's own inventory, inventories on actors the player owns, and the loot source
+     * the player is interacting with while it's still in reach*/
+    bool CanAccessInventory(const class UInventoryComponent *Inventory) const;
+
+    UFUNCTION(Server, Reliable, WithValidation)
+    void ServerTransferItem(class UItem *Item, class UInventoryComponent *From, class UInventoryComponent *To, const int32 Quantity);
+
+    /**Stack views of compact stacks aren't replicated, so those are moved by class*/
+    UFUNCTION(Server, Reliable, WithValidation)
+    void ServerTransferItemOfClass(TSubclassOf<class UItem> ItemClass, class UInventoryComponent *From, class UInventoryComponent *To, const int32 Quantity);
 	
 	// equipment items
 	bool EquipItem(UEquippableItem *Item);
@@ -143,7 +270,16 @@ public:
 	USkeletalMeshComponent *GetSlotSkeletalMeshComponent(const EEquippableSlot Slot);
 
 	UFUNCTION(BlueprintPure)
-    FORCEINLINE TMap<EEquippableSlot, UEquippableItem*> GetEquippedItems() const { return EquippedItems; }
+    TMap<EEquippableSlot, UEquippableItem*> GetEquippedItems() const;
+
+	UFUNCTION(BlueprintPure)
+	UEquippableItem* GetEquippedItem(const EEquippableSlot Slot) const;
+
+    /**Copies the inventory and equipment into OutSnapshot, for saving on logout and autosave*/
+    void CaptureInventorySnapshot(struct FInventorySnapshot& OutSnapshot) const;
+
+    /**Server only. Replaces the inventory with the snapshot in one batch and re-equips what was equipped*/
+    bool RestoreInventorySnapshot(const struct FInventorySnapshot& Snapshot);
 
     // UFUNCTION(BlueprintPure, Category = "Weapons")
     // FORCEINLINE class AWeapon *GetEquippedWeapon() const { return EquippedWeapon; }
@@ -151,11 +287,66 @@ public:
 private:
 	void SetRotation(FRotator NewRotation);
 
+	/**Unreliable and rate limited, a newer yaw replaces a lost one anyway*/
+	UFUNCTION(Server, Unreliable)
+	void ServerSetAimYaw(const uint16 QuantizedYaw);
+
 	UFUNCTION(Server, Reliable)
-	void Server_SetRotation(FRotator NewRotation);
+	void ServerSetCombatMode(const bool bCombat);
+
+	void ApplyCombatMode(const bool bCombat);
+
+	/**Turns towards the cursor while in combat mode, owning client only*/
+	void UpdateCursorAim();
+
+	/**Sends the pending aim yaw if the send interval allows it, and the settled yaw once more after it stops changing*/
+	void FlushAimYaw();
+
+	/**Turns simulated proxies towards the replicated aim while aim updates keep arriving*/
+	void UpdateSimulatedAim(float DeltaSeconds);
 
 	FVector GetMousePosition() const;
 
+	bool ShouldMergeArmorMeshes() const;
+
+	/**Merges on the next tick, so equipping a whole loadout at once only merges once*/
+	void RequestMergedMeshRefresh();
+
+	void RefreshMergedMesh();
+
+	//Puts the part components back in the scene, for when merging isn't possible
+	void UseSeparateArmorMeshes();
+
+	/**Hold interactions run on the world's shared interaction timers rather than a timer per character*/
+	class UInteractionTimerSubsystem* GetInteractionTimers() const;
+
+	/**Returns the interactable registry, or null when focus checks should trace instead*/
+	class UInteractionSubsystem* GetInteractionRegistry() const;
+
+	/**Applies last frame's async cursor and focus traces and requests this frame's. The cursor hit goes through the
+	 * controller's cursor cache, so everything else reading the cursor's complex hit that frame uses it instead of tracing again*/
+	void PerformAsyncInteractionCheck(const class ATrustPlayerController* PlayerController);
+
+	void OnCursorTraceDone(const FTraceHandle& TraceHandle, FTraceDatum& TraceDatum);
+
+	void OnFocusTraceDone(const FTraceHandle& TraceHandle, FTraceDatum& TraceDatum);
+
+	/**Focuses the interactable the focus trace hit if it's in reach, TraceHit is null if nothing was hit*/
+	void HandleInteractionTraceHit(const FVector& Start, const FHitResult* TraceHit);
+
+	/**Focuses the registry's Candidate unless the confirm trace hit something else first, ConfirmHit is null if nothing was hit*/
+	void HandleFocusCandidateConfirmed(const FVector& Start, class UInteractionComponent* Candidate, const FHitResult* ConfirmHit);
+
+	void SpawnDroppedPickup(TSubclassOf<class UItem> ItemClass, const int32 Quantity);
+
+	/**Client only. Shows the instant interaction as done straight away, the server confirms or rejects it later*/
+	void PredictInteraction(class UInteractionComponent *Interactable, const uint16 PredictionId);
+
+	/**Drops confirmed predictions once their provisional items are gone and rolls back those the server never answered*/
+	void UpdatePredictedInteractions();
+
+	void RollbackPredictedInteraction(const int32 Index);
+
 protected:
 	UFUNCTION(BlueprintImplementableEvent)
 	void OnCombatModeToggled(bool bCombat);
@@ -163,13 +354,23 @@ protected:
 	UFUNCTION(BlueprintImplementableEvent)
 	void OnAimToggled(bool bAim);
 
-	void Interact();
+	/**Fires the focused interactable's interaction. True if it fired and wasn't refused*/
+	bool Interact();
 
 	void EndInteract();
 	
 	void BeginInteraction();
 	
-	void BeginInteraction(FVector MousePos);
+	/**Starts interacting with whatever is focused, on the server only once the focus has been validated. True if an
+	 * instant interaction was carried out on the spot, false if it was refused or is a hold that only started*/
+	bool BeginFocusedInteraction();
+
+	/**Server check that the client's focused interactable is really in reach. Distance to its bounds decides
+	 * clear passes and clear rejections, a trace only runs for targets just beyond reach that latency could explain*/
+	bool ValidateInteractionTarget(class UInteractionComponent *Target) const;
+
+	/**How far past InteractionDistance a target may be, for where the client saw it one ping ago*/
+	float GetInteractionLatencyAllowance() const;
 	
 	void PerformInteractionCheck(FVector MousePos);
 
@@ -177,6 +378,10 @@ protected:
 
     void FoundNewInteractable(UInteractionComponent *Interactable);
 
+	virtual void BeginPlay() override;
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
 	virtual void Tick(float DeltaSeconds) override;
 	
 	virtual void SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) override;
@@ -184,11 +389,32 @@ protected:
 	FORCEINLINE class UInteractionComponent* GetInteractable() const { return InteractionData.ViewedInteractionComponent; }
 
 	UFUNCTION(Server, Reliable, WithValidation)
-    void ServerBeginInteraction(FVector MousePos);
+    void ServerBeginInteraction(class UInteractionComponent *Target, const uint16 RequestId, const uint16 PredictionId);
 
 	UFUNCTION(Server, Reliable, WithValidation)
     void ServerEndInteraction();
 
+	/**Sent when the server carried out the predicted interaction PredictionId*/
+	UFUNCTION(Client, Reliable)
+	void ClientConfirmPredictedInteraction(const uint16 PredictionId);
+
+	/**Sent when the server didn't carry out the predicted interaction PredictionId*/
+	UFUNCTION(Client, Reliable)
+	void ClientRejectPredictedInteraction(const uint16 PredictionId);
+
+	/**Answers a measured ServerBeginInteraction once the server fired OnInteract, times are server world seconds*/
+	UFUNCTION(Client, Reliable)
+	void ClientInteractionLatencyAck(const uint16 RequestId, const float ServerReceiveTime, const float ServerInteractTime);
+
+	UFUNCTION()
+	void OnRep_EquippedClasses();
+
+	UFUNCTION()
+	void OnRep_AimYaw();
+
+	/**Shows the default look of the slot's replicated item class, for clients that don't have the item itself*/
+	void ApplyEquippedClass(const int32 Slot);
+
 	// UFUNCTION()
 	// void OnRep_EquippedWeapon();
 };
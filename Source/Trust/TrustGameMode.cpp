@@ -3,6 +3,8 @@
 #include "TrustGameMode.h"
 #include "TrustPlayerController.h"
 #include "TrustCharacter.h"
+#include "Components/InventorySnapshot.h"
+#include "GameFramework/PlayerState.h"
 #include "UObject/ConstructorHelpers.h"
 
 ATrustGameMode::ATrustGameMode() {
@@ -14,4 +16,73 @@ ATrustGameMode::ATrustGameMode() {
 	if (PlayerPawnBPClass.Class != nullptr) {
 		DefaultPawnClass = PlayerPawnBPClass.Class;
 	}
-}
\ No newline at end of file
+
+	InventoryAutosaveInterval = 300.f;
+	bRestoreSavedInventories = true;
+}
+
+void ATrustGameMode::BeginPlay() {
+	Super::BeginPlay();
+
+	if (InventoryAutosaveInterval > 0.f) {
+		GetWorldTimerManager().SetTimer(TimerHandle_InventoryAutosave, this, &ATrustGameMode::AutosaveInventories, InventoryAutosaveInterval, true);
+	}
+}
+
+void ATrustGameMode::RestartPlayer(AController* NewPlayer) {
+	Super::RestartPlayer(NewPlayer);
+
+	//Only the first pawn of the session gets the saved inventory. A respawn starts empty, whatever the player dropped
+	//or died with is still out in the world
+	ATrustPlayerController* PlayerController = Cast<ATrustPlayerController>(NewPlayer);
+	ATrustCharacter* Character = PlayerController ? Cast<ATrustCharacter>(PlayerController->GetPawn()) : nullptr;
+	if (!Character || PlayerController->HasRestoredSavedInventory()) {
+		return;
+	}
+
+	PlayerController->MarkSavedInventoryRestored();
+
+	if (bRestoreSavedInventories) {
+		FInventorySnapshot Snapshot;
+		if (FInventorySnapshot::Load(GetInventorySlotName(NewPlayer), Snapshot)) {
+			Character->RestoreInventorySnapshot(Snapshot);
+		}
+	}
+}
+
+void ATrustGameMode::Logout(AController* Exiting) {
+	//A leaving player's pawn is already gone by now, ATrustPlayerController::PawnLeavingGame saved it on the way out.
+	//This only catches controllers that still have one
+	SaveInventory(Exiting);
+
+	Super::Logout(Exiting);
+}
+
+void ATrustGameMode::AutosaveInventories() {
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It) {
+		SaveInventory(It->Get());
+	}
+}
+
+void ATrustGameMode::SaveInventory(AController* Controller) {
+	if (!Controller) {
+		return;
+	}
+
+	if (const ATrustCharacter* Character = Cast<ATrustCharacter>(Controller->GetPawn())) {
+		//Capturing only copies classes and quantities, the serialization and file write happen off the game thread
+		FInventorySnapshot Snapshot;
+		Character->CaptureInventorySnapshot(Snapshot);
+		FInventorySnapshot::SaveAsync(MoveTemp(Snapshot), GetInventorySlotName(Controller));
+	}
+}
+
+FString ATrustGameMode::GetInventorySlotName(const AController* Controller) {
+	if (const APlayerState* PlayerState = Controller->GetPlayerState<APlayerState>()) {
+		if (PlayerState->GetUniqueId().IsValid()) {
+			return PlayerState->GetUniqueId()->ToString();
+		}
+		return PlayerState->GetPlayerName();
+	}
+	return Controller->GetName();
+}
@@ -12,6 +12,30 @@ class ATrustGameMode : public AGameModeBase {
 
 public:
 	ATrustGameMode();
+
+	virtual void BeginPlay() override;
+	virtual void RestartPlayer(AController* NewPlayer) override;
+	virtual void Logout(AController* Exiting) override;
+
+protected:
+	/**Seconds between inventory autosaves of every connected player. Zero only saves on logout*/
+	UPROPERTY(EditDefaultsOnly, Category = "Saving", meta = (ClampMin = 0))
+	float InventoryAutosaveInterval;
+
+	/**If true, players get the inventory they logged out with when they first spawn after logging in*/
+	UPROPERTY(EditDefaultsOnly, Category = "Saving")
+	bool bRestoreSavedInventories;
+
+public:
+	/**Saves the inventory of the controller's pawn, if it has one*/
+	void SaveInventory(AController* Controller);
+
+private:
+	FTimerHandle TimerHandle_InventoryAutosave;
+
+	void AutosaveInventories();
+
+	static FString GetInventorySlotName(const AController* Controller);
 };
 
 
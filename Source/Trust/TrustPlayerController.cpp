@@ -5,12 +5,74 @@
 #include "Runtime/Engine/Classes/Components/DecalComponent.h"
 #include "HeadMountedDisplayFunctionLibrary.h"
 #include "TrustCharacter.h"
+#include "TrustGameMode.h"
 #include "Engine/World.h"
+#include "Trust.h"
+#include "Subsystems/MoveRequestSubsystem.h"
+#include "Widgets/InteractionPromptPool.h"
+#include "Widgets/InteractionWidget.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Cursor Traces"), STAT_CursorTraces, STATGROUP_Trust);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Cursor Hit Cache Hits"), STAT_CursorHitCacheHits, STATGROUP_Trust);
 
 ATrustPlayerController::ATrustPlayerController() {
 	bShowMouseCursor = true;
 	
 	DefaultMouseCursor = EMouseCursor::Default;
+
+	InteractionPrompts = nullptr;
+	bSavedInventoryRestored = false;
+}
+
+void ATrustPlayerController::PawnLeavingGame() {
+	if (ATrustGameMode* GameMode = GetWorld()->GetAuthGameMode<ATrustGameMode>()) {
+		GameMode->SaveInventory(this);
+	}
+
+	Super::PawnLeavingGame();
+}
+
+UInteractionPromptPool* ATrustPlayerController::GetInteractionPrompts() {
+	if (!InteractionPrompts && IsLocalController()) {
+		InteractionPrompts = NewObject<UInteractionPromptPool>(this);
+		InteractionPrompts->Initialize(this, InteractionPromptClass);
+	}
+	return InteractionPrompts;
+}
+
+bool ATrustPlayerController::GetCachedHitResultUnderCursor(const ECollisionChannel TraceChannel, const bool bTraceComplex, FHitResult& OutHit) const {
+	FCursorHitCacheEntry& Entry = CursorHitCache.FindOrAdd(MakeTuple(TraceChannel, bTraceComplex));
+
+	//Frame 0 never ticks, so a fresh entry always traces
+	if (Entry.Frame != GFrameCounter) {
+		Entry.Frame = GFrameCounter;
+		Entry.Hit = FHitResult();
+		Entry.bHit = GetHitResultUnderCursor(TraceChannel, bTraceComplex, Entry.Hit);
+		INC_DWORD_STAT(STAT_CursorTraces);
+	} else {
+		INC_DWORD_STAT(STAT_CursorHitCacheHits);
+	}
+
+	OutHit = Entry.Hit;
+	return Entry.bHit;
+}
+
+void ATrustPlayerController::PublishHitResultUnderCursor(const ECollisionChannel TraceChannel, const bool bTraceComplex, const FHitResult& Hit) {
+	FCursorHitCacheEntry& Entry = CursorHitCache.FindOrAdd(MakeTuple(TraceChannel, bTraceComplex));
+	Entry.Frame = GFrameCounter;
+	Entry.Hit = Hit;
+	Entry.bHit = Hit.bBlockingHit;
+	INC_DWORD_STAT(STAT_CursorTraces);
+}
+
+bool ATrustPlayerController::GetLastHitResultUnderCursor(const ECollisionChannel TraceChannel, const bool bTraceComplex, FHitResult& OutHit) const {
+	const FCursorHitCacheEntry* Entry = CursorHitCache.Find(MakeTuple(TraceChannel, bTraceComplex));
+	if (!Entry) {
+		return false;
+	}
+
+	OutHit = Entry->Hit;
+	return true;
 }
 
 void ATrustPlayerController::PlayerTick(float DeltaTime) {
@@ -20,6 +82,10 @@ void ATrustPlayerController::PlayerTick(float DeltaTime) {
 	if (bMoveToMouseCursor) {
 		MoveToMouseCursor();
 	}
+
+	if (InteractionPrompts) {
+		InteractionPrompts->UpdatePrompts();
+	}
 }
 
 void ATrustPlayerController::SetupInputComponent() {
@@ -34,7 +100,7 @@ void ATrustPlayerController::SetupInputComponent() {
 void ATrustPlayerController::MoveToMouseCursor() {
 	// Trace to see what is under the mouse cursor
 	FHitResult Hit;
-	GetHitResultUnderCursor(ECC_Visibility, false, Hit);
+	GetCachedHitResultUnderCursor(ECC_Visibility, false, Hit);
 
 	if (Hit.bBlockingHit) {
 		// We hit something, move there
@@ -49,7 +115,12 @@ void ATrustPlayerController::SetNewMoveDestination(const FVector DestLocation) {
 
 		// We need to issue move command only if far enough in order for walk animation to play correctly
 		if ((Distance > 120.0f)) {
-			UAIBlueprintHelperLibrary::SimpleMoveToLocation(this, DestLocation);
+			//Called every frame while the button is held, the move requests decide when it's worth pathfinding again
+			if (UMoveRequestSubsystem* MoveRequests = GetWorld()->GetSubsystem<UMoveRequestSubsystem>()) {
+				MoveRequests->RequestMove(this, DestLocation);
+			} else {
+				UAIBlueprintHelperLibrary::SimpleMoveToLocation(this, DestLocation);
+			}
 		}
 	}
 }
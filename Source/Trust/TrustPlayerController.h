@@ -13,13 +13,57 @@ class ATrustPlayerController : public APlayerController {
 public:
 	ATrustPlayerController();
 
+	/**
+	 * Hit under the mouse cursor for this frame. The first call per channel and collision mode each frame traces, every
+	 * later caller that frame gets the same result, so movement and interaction don't each pay for their own deproject
+	 * and trace. Simple and complex collision are cached apart, callers keep whichever they traced before.
+	 */
+	bool GetCachedHitResultUnderCursor(const ECollisionChannel TraceChannel, const bool bTraceComplex, FHitResult& OutHit) const;
+
+	/**Stores a cursor hit traced elsewhere, like an async trace, as this frame's result for the channel and collision
+	 * mode. Pass a default hit result for a miss*/
+	void PublishHitResultUnderCursor(const ECollisionChannel TraceChannel, const bool bTraceComplex, const FHitResult& Hit);
+
+	/**The most recent cached hit for the channel and collision mode from any frame, without tracing. False if nothing
+	 * was ever traced*/
+	bool GetLastHitResultUnderCursor(const ECollisionChannel TraceChannel, const bool bTraceComplex, FHitResult& OutHit) const;
+
+	/**Prompts for the interactables this player focuses, only local controllers have them*/
+	class UInteractionPromptPool* GetInteractionPrompts();
+
+	/**Server only. Whether this session's first pawn already had the saved inventory restored*/
+	FORCEINLINE bool HasRestoredSavedInventory() const { return bSavedInventoryRestored; }
+
+	FORCEINLINE void MarkSavedInventoryRestored() { bSavedInventoryRestored = true; }
+
+	/**Saves the inventory before the pawn is destroyed, Logout runs only after it's gone*/
+	virtual void PawnLeavingGame() override;
+
 private:
+	struct FCursorHitCacheEntry {
+		uint64 Frame = 0;
+		bool bHit = false;
+		FHitResult Hit;
+	};
+
 	UPROPERTY()
 	APawn *ControlledPawn;
 
 	uint32 bMoveToMouseCursor : 1;
 
+	uint32 bSavedInventoryRestored : 1;
+
+	//Keyed by channel and whether complex collision was traced
+	mutable TMap<TPair<ECollisionChannel, bool>, FCursorHitCacheEntry> CursorHitCache;
+
+	UPROPERTY()
+	class UInteractionPromptPool* InteractionPrompts;
+
 protected:
+	/**Prompt shown over focused interactables that don't pick their own*/
+	UPROPERTY(EditDefaultsOnly, Category = "Interaction")
+	TSubclassOf<class UInteractionWidget> InteractionPromptClass;
+
 	/** Navigate player to the current mouse cursor location. */
 	void MoveToMouseCursor();
 	
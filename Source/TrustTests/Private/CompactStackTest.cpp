@@ -0,0 +1,78 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "InventoryBenchmark.h"
+#include "InventoryTestItems.h"
+#include "TrustTestWorld.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "Components/InventoryComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "UObject/UObjectIterator.h"
+
+//Live instances of ItemClass, not counting its class default object, either the real items or the stack views
+static int32 CountItemObjects(const UClass* ItemClass, const bool bStackViews = false) {
+	int32 Count = 0;
+	for (TObjectIterator<UItem> It(RF_ClassDefaultObject); It; ++It) {
+		Count += (It->GetClass() == ItemClass && It->IsStackView() == bStackViews) ? 1 : 0;
+	}
+	return Count;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCompactStackObjectsTest, "Trust.Inventory.CompactStackObjects", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::EngineFilter)
+
+bool FCompactStackObjectsTest::RunTest(const FString& Parameters) {
+	FTrustTestWorld World;
+	const UClass* CompactClass = UInventoryTestCompactItem::StaticClass();
+
+	for (const bool bDelta : { false, true }) {
+		AActor* Owner = World.Get()->SpawnActor<AActor>();
+		UInventoryComponent* Inventory = NewObject<UInventoryComponent>(Owner);
+		FInventoryBenchmark::SetUseDeltaReplication(Inventory, bDelta);
+		Inventory->SetWeightCapacity(BIG_NUMBER);
+		Inventory->RegisterComponent();
+
+		const TCHAR* Replication = bDelta ? TEXT("delta") : TEXT("legacy");
+		const int32 ObjectsBefore = CountItemObjects(CompactClass);
+		const int32 ViewsBefore = CountItemObjects(CompactClass, true);
+
+		Inventory->TryAddItemFromClass(CompactClass, 100);
+		for (int32 i = 0; i < 50; ++i) {
+			Inventory->TryAddItemFromClass(CompactClass, 2);
+			Inventory->ConsumeItemOfClass(CompactClass, 1);
+		}
+
+		const TArray<FInventoryItemRequest> Stacks = Inventory->GetStacksOfClass(CompactClass);
+		const int32 ObjectsWhileStacked = CountItemObjects(CompactClass) - ObjectsBefore;
+		TestEqual(FString::Printf(TEXT("One stack of the expected quantity with %s replication"), Replication), Stacks.Num() == 1 ? Stacks[0].Quantity : -1, 150);
+		TestEqual(FString::Printf(TEXT("UItems held for the stack with %s replication"), Replication), ObjectsWhileStacked, bDelta ? 0 : 1);
+
+		//The public lookups see the stack whether it's compact or not, a compact one through a single stack view
+		for (int32 Pass = 0; Pass < 2; ++Pass) {
+			const UItem* Found = Inventory->FindItemByClass(CompactClass);
+			TestTrue(FString::Printf(TEXT("FindItemByClass finds the stack with %s replication"), Replication), Found && Found->GetQuantity() == 150);
+			TestTrue(FString::Printf(TEXT("FindItemsByClass finds the stack with %s replication"), Replication), Inventory->FindItemsByClass(UItem::StaticClass()).Contains(Found));
+			TestTrue(FString::Printf(TEXT("GetInventoryItems lists the stack with %s replication"), Replication), Inventory->GetInventoryItems().Contains(Found));
+			TestTrue(FString::Printf(TEXT("GetItemView lists the stack with %s replication"), Replication), Inventory->GetItemView(EInventorySortMode::ISM_Weight).Contains(Found));
+		}
+		TestEqual(FString::Printf(TEXT("Stack views made by lookups with %s replication"), Replication), CountItemObjects(CompactClass, true) - ViewsBefore, bDelta ? 1 : 0);
+		TestEqual(FString::Printf(TEXT("Lookups leave the stack compact with %s replication"), Replication), CountItemObjects(CompactClass) - ObjectsBefore, ObjectsWhileStacked);
+
+		//Asking for a UItem is what materializes the stack, once, and lookups then return it instead of the view
+		const UItem* Materialized = Inventory->FindOrMaterializeItemByClass(CompactClass);
+		Inventory->FindOrMaterializeItemByClass(CompactClass);
+		TestTrue(FString::Printf(TEXT("Materializing keeps the quantity with %s replication"), Replication), Materialized && Materialized->GetQuantity() == 150);
+		TestEqual(FString::Printf(TEXT("UItems held once materialized with %s replication"), Replication), CountItemObjects(CompactClass) - ObjectsBefore, 1);
+		TestTrue(FString::Printf(TEXT("FindItemByClass returns the materialized item with %s replication"), Replication), Materialized && Inventory->FindItemByClass(CompactClass) == Materialized);
+
+		AddInfo(FString::Printf(TEXT("%s replication: %d UItems for a churned stack, 1 once materialized"), Replication, ObjectsWhileStacked));
+
+		Inventory->DestroyComponent();
+		Owner->Destroy();
+	}
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,96 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "TrustTestWorld.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "Components/InteractionComponent.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/StaticMeshActor.h"
+#include "Engine/World.h"
+#include "Subsystems/InteractionSubsystem.h"
+
+//Headless: -nullrhi -unattended -ExecCmds="Automation RunTests Trust.Interaction.Benchmark;Quit"
+
+static const int32 InteractionBenchmarkQueries = 10000;
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FInteractionBenchmarkTest, "Trust.Interaction.Benchmark", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::PerfFilter)
+
+/**Spawns fields of 1k and 10k interactables and times a registry focus check, confirm trace included, against the full focus
+ * trace. Only reports the timings, they depend too much on the machine to assert on*/
+bool FInteractionBenchmarkTest::RunTest(const FString& Parameters) {
+	UStaticMesh* CubeMesh = LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Cube.Cube"));
+	if (!CubeMesh) {
+		AddError(TEXT("Needs the engine basic shapes"));
+		return false;
+	}
+
+	for (const int32 NumInteractables : { 1000, 10000 }) {
+		FTrustTestWorld World;
+		UInteractionSubsystem* Registry = World.Get()->GetSubsystem<UInteractionSubsystem>();
+		if (!Registry) {
+			AddError(TEXT("The test world has no interaction registry"));
+			return false;
+		}
+
+		//Loot dense, one interactable roughly every 300 units
+		const int32 Side = FMath::CeilToInt(FMath::Sqrt((float)NumInteractables));
+		const float Spacing = 300.f;
+
+		for (int32 i = 0; i < NumInteractables; ++i) {
+			const FVector Location((i % Side) * Spacing, (i / Side) * Spacing, 0.f);
+			AStaticMeshActor* Actor = World.Get()->SpawnActor<AStaticMeshActor>(Location, FRotator::ZeroRotator);
+			Actor->GetStaticMeshComponent()->SetMobility(EComponentMobility::Movable);
+			Actor->GetStaticMeshComponent()->SetStaticMesh(CubeMesh);
+
+			UInteractionComponent* Interactable = NewObject<UInteractionComponent>(Actor);
+			Interactable->SetupAttachment(Actor->GetRootComponent());
+			Interactable->RegisterComponent();
+		}
+		TestEqual(TEXT("Every interactable is registered"), Registry->Num(), NumInteractables);
+
+		//Same rays for both, so they do the same work
+		FRandomStream Random(NumInteractables);
+		TArray<TPair<FVector, FVector>> Rays;
+		for (int32 i = 0; i < InteractionBenchmarkQueries; ++i) {
+			const FVector Start(Random.FRandRange(0.f, Side * Spacing), Random.FRandRange(0.f, Side * Spacing), 0.f);
+			Rays.Emplace(Start, FVector(Random.FRandRange(-1.f, 1.f), Random.FRandRange(-1.f, 1.f), 0.f).GetSafeNormal());
+		}
+
+		//The registry path as PerformInteractionCheck runs it, the lookup and then the trace confirming nothing blocks the view
+		int32 RegistryHits = 0;
+		const uint64 RegistryStartCycles = FPlatformTime::Cycles64();
+		for (const TPair<FVector, FVector>& Ray : Rays) {
+			float Distance = 0.f;
+			UInteractionComponent* Candidate = Registry->FindInteractableAlongRay(Ray.Key, Ray.Value, nullptr, Distance);
+			if (!Candidate) {
+				continue;
+			}
+
+			FHitResult ConfirmHit;
+			const bool bBlocked = Distance > KINDA_SMALL_NUMBER && World.Get()->LineTraceSingleByChannel(ConfirmHit, Ray.Key, Ray.Key + Ray.Value * Distance, ECC_Visibility)
+				&& ConfirmHit.GetActor() != Candidate->GetOwner();
+			RegistryHits += bBlocked ? 0 : 1;
+		}
+		const double RegistryNs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - RegistryStartCycles) * 1000000.0 / InteractionBenchmarkQueries;
+
+		int32 TraceHits = 0;
+		const uint64 TraceStartCycles = FPlatformTime::Cycles64();
+		for (const TPair<FVector, FVector>& Ray : Rays) {
+			FHitResult TraceHit;
+			if (World.Get()->LineTraceSingleByChannel(TraceHit, Ray.Key, Ray.Key + Ray.Value * 5000.f, ECC_Visibility) && TraceHit.GetActor()) {
+				UInteractionComponent* Interactable = Cast<UInteractionComponent>(TraceHit.GetActor()->GetComponentByClass(UInteractionComponent::StaticClass()));
+				TraceHits += (Interactable && TraceHit.Distance <= Interactable->GetInteractionDistance()) ? 1 : 0;
+			}
+		}
+		const double TraceNs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - TraceStartCycles) * 1000000.0 / InteractionBenchmarkQueries;
+
+		AddInfo(FString::Printf(TEXT("%d interactables, %d queries: registry %.0f ns per query, %d focused; trace %.0f ns per query, %d focused"),
+			NumInteractables, InteractionBenchmarkQueries, RegistryNs, RegistryHits, TraceNs, TraceHits));
+	}
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,118 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "InteractionTestPickup.h"
+#include "TrustNetworkTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS && WITH_EDITOR
+
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+#include "Subsystems/InteractionLatencySubsystem.h"
+#include "Trust/TrustCharacter.h"
+
+/**Picks up server authoritative pickups one after another with latency stats on, then checks what the client's
+ * UInteractionLatencySubsystem recorded against the emulated lag*/
+class FInteractionLatencyCommand : public FTrustNetworkTestCommand {
+
+public:
+	FInteractionLatencyCommand(FAutomationTestBase* InTest, const int32 InLagMs, const int32 InLossPercent, const int32 InNumPickups)
+		: FTrustNetworkTestCommand(InTest, InLagMs, InLossPercent), NumPickups(InNumPickups), NumPickedUp(0), bStarted(false), bPressed(false) {}
+
+	virtual ~FInteractionLatencyCommand() {
+		if (bStarted) {
+			if (IConsoleVariable* LatencyStats = IConsoleManager::Get().FindConsoleVariable(TEXT("Trust.Interaction.LatencyStats"))) {
+				LatencyStats->Set(*PreviousLatencyStats, ECVF_SetByConsole);
+			}
+		}
+	}
+
+protected:
+	virtual bool UpdateTest(ATrustCharacter* ServerCharacter, ATrustCharacter* ClientCharacter) override {
+		UInteractionLatencySubsystem* LatencyStats = ClientCharacter->GetWorld()->GetSubsystem<UInteractionLatencySubsystem>();
+		if (!LatencyStats) {
+			Test->AddError(TEXT("The client has no UInteractionLatencySubsystem"));
+			return true;
+		}
+
+		if (!bStarted) {
+			IConsoleVariable* StatsVariable = IConsoleManager::Get().FindConsoleVariable(TEXT("Trust.Interaction.LatencyStats"));
+			PreviousLatencyStats = StatsVariable->GetString();
+			StatsVariable->Set(1, ECVF_SetByConsole);
+			LatencyStats->ResetStats();
+			bStarted = true;
+		}
+
+		if (!bPressed) {
+			if (!ServerPickup.IsValid()) {
+				FActorSpawnParameters SpawnParameters;
+				SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+				const FVector Location = ServerCharacter->GetActorLocation() + ServerCharacter->GetActorForwardVector() * 100.f;
+				ServerPickup = ServerCharacter->GetWorld()->SpawnActor<AInteractionTestPickup>(Location, FRotator::ZeroRotator, SpawnParameters);
+				ServerPickup->GetInteraction()->SetPredictInteraction(false);
+				return false;
+			}
+
+			//Prediction is the client's call, so the replica has to be told too
+			for (TActorIterator<AInteractionTestPickup> It(ClientCharacter->GetWorld()); It; ++It) {
+				ClientPickup = *It;
+				It->GetInteraction()->SetPredictInteraction(false);
+				FInteractionNetworkTestDriver::Interact(ClientCharacter, It->GetInteraction());
+				bPressed = true;
+				break;
+			}
+			return false;
+		}
+
+		//Done once the server's destroy has arrived and the request has either completed or been given up on
+		if ((ClientPickup.IsValid() && !ClientPickup->IsPendingKillPending()) || LatencyStats->GetNumInFlightRequests() > 0) {
+			return false;
+		}
+
+		ServerPickup.Reset();
+		ClientPickup.Reset();
+		bPressed = false;
+		if (++NumPickedUp < NumPickups) {
+			return false;
+		}
+
+		const FInteractionLatencyHistogram& RoundTrip = LatencyStats->GetRoundTrip();
+		Test->AddInfo(FString::Printf(TEXT("%d pickups with %d ms lag and %d%% loss"), NumPickups, LagMs, LossPercent));
+		Test->AddInfo(FString::Printf(TEXT("Uplink: %s"), *LatencyStats->GetUplink().ToString()));
+		Test->AddInfo(FString::Printf(TEXT("Server: %s"), *LatencyStats->GetServer().ToString()));
+		Test->AddInfo(FString::Printf(TEXT("Downlink: %s"), *LatencyStats->GetDownlink().ToString()));
+		Test->AddInfo(FString::Printf(TEXT("Round trip: %s"), *RoundTrip.ToString()));
+
+		Test->TestEqual(TEXT("Every pickup's round trip was measured"), RoundTrip.NumSamples, NumPickups);
+		Test->TestEqual(TEXT("No request was left without an answer"), LatencyStats->GetNumStaleRequests(), 0);
+		Test->TestTrue(TEXT("Round trips include the emulated lag"), RoundTrip.NumSamples > 0 && RoundTrip.Min >= LagMs);
+
+		//Stages are cut from the round trip, so they have to add back up to it
+		const float StagesMs = LatencyStats->GetUplink().Sum + LatencyStats->GetServer().Sum + LatencyStats->GetDownlink().Sum;
+		Test->TestTrue(TEXT("Uplink, server and downlink add up to the round trip"), FMath::IsNearlyEqual(StagesMs, RoundTrip.Sum, 1.f * NumPickups));
+		return true;
+	}
+
+private:
+	const int32 NumPickups;
+
+	int32 NumPickedUp;
+
+	bool bStarted;
+
+	bool bPressed;
+
+	FString PreviousLatencyStats;
+
+	TWeakObjectPtr<AInteractionTestPickup> ServerPickup;
+
+	TWeakObjectPtr<AInteractionTestPickup> ClientPickup;
+};
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FInteractionLatencyTest, "Trust.Interaction.Latency", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FInteractionLatencyTest::RunTest(const FString& Parameters) {
+	ADD_LATENT_AUTOMATION_COMMAND(FInteractionLatencyCommand(this, 100, 5, 10));
+	return true;
+}
+
+#endif
@@ -0,0 +1,69 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "InteractionTestPickup.h"
+
+#include "Components/InventoryComponent.h"
+#include "Components/SphereComponent.h"
+#include "Engine/CollisionProfile.h"
+#include "Net/UnrealNetwork.h"
+#include "Trust/TrustCharacter.h"
+
+UInteractionTestPickupComponent::UInteractionTestPickupComponent() {
+	InteractionTime = 0.f;
+	InteractionDistance = 300.f;
+	bPredictInteraction = true;
+}
+
+AInteractionTestPickup::AInteractionTestPickup() {
+	Bounds = CreateDefaultSubobject<USphereComponent>(TEXT("Bounds"));
+	Bounds->InitSphereRadius(20.f);
+	Bounds->SetCollisionProfileName(UCollisionProfile::BlockAllDynamic_ProfileName);
+	SetRootComponent(Bounds);
+
+	Interaction = CreateDefaultSubobject<UInteractionTestPickupComponent>(TEXT("Interaction"));
+	Interaction->SetupAttachment(Bounds);
+	Interaction->OnInteract.AddDynamic(this, &AInteractionTestPickup::OnInteracted);
+	Interaction->OnPredictInteract.AddDynamic(this, &AInteractionTestPickup::OnPredictInteracted);
+
+	bReplicates = true;
+	bAlwaysRelevant = true;
+
+	PredictedItemQuantity = 0;
+	GrantedItemQuantity = 0;
+	bRefuseInteract = false;
+}
+
+void AInteractionTestPickup::SetGrantedItem(TSubclassOf<UItem> ItemClass, const int32 PredictedQuantity, const int32 Quantity) {
+	GrantedItemClass = ItemClass;
+	PredictedItemQuantity = PredictedQuantity;
+	GrantedItemQuantity = Quantity;
+}
+
+void AInteractionTestPickup::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const {
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME_CONDITION(AInteractionTestPickup, GrantedItemClass, COND_InitialOnly);
+	DOREPLIFETIME_CONDITION(AInteractionTestPickup, PredictedItemQuantity, COND_InitialOnly);
+}
+
+void AInteractionTestPickup::OnPredictInteracted(ATrustCharacter* Character) {
+	if (GrantedItemClass && Character && Character->GetPlayerInventory()) {
+		Character->GetPlayerInventory()->AddPredictedItem(GrantedItemClass, PredictedItemQuantity, this);
+	}
+}
+
+void AInteractionTestPickup::OnInteracted(ATrustCharacter* Character) {
+	if (!HasAuthority()) {
+		return;
+	}
+
+	if (bRefuseInteract) {
+		Interaction->RefuseInteract();
+		return;
+	}
+
+	if (GrantedItemClass && GrantedItemQuantity > 0 && Character && Character->GetPlayerInventory()) {
+		Character->GetPlayerInventory()->TryAddItemFromClass(GrantedItemClass, GrantedItemQuantity);
+	}
+	Destroy();
+}
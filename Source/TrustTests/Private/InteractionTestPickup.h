@@ -0,0 +1,63 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/InteractionComponent.h"
+#include "GameFramework/Actor.h"
+#include "InteractionTestPickup.generated.h"
+
+/**Instant interaction with adjustable prediction, so tests don't depend on the game's pickup assets*/
+UCLASS(NotBlueprintable, HideDropdown)
+class UInteractionTestPickupComponent : public UInteractionComponent {
+	GENERATED_BODY()
+
+public:
+	UInteractionTestPickupComponent();
+
+	FORCEINLINE void SetPredictInteraction(const bool bNewPredictInteraction) { bPredictInteraction = bNewPredictInteraction; }
+};
+
+/**Replicated actor the networked tests interact with. The server destroys it when the interaction fires, like a pickup,
+ * and gives the interacting character GrantedItemClass, which the client adds as a predicted item when it predicts*/
+UCLASS(NotBlueprintable, HideDropdown)
+class AInteractionTestPickup : public AActor {
+	GENERATED_BODY()
+
+public:
+	AInteractionTestPickup();
+
+	FORCEINLINE UInteractionTestPickupComponent* GetInteraction() const { return Interaction; }
+
+	/**Server only, before the client sees the pickup. Quantity 0 grants nothing while still predicting Quantity on the client*/
+	void SetGrantedItem(TSubclassOf<class UItem> ItemClass, const int32 PredictedQuantity, const int32 Quantity);
+
+	/**Server only. The pickup refuses the interaction and stays, like one that doesn't fit the inventory*/
+	FORCEINLINE void SetRefuseInteract(const bool bNewRefuseInteract) { bRefuseInteract = bNewRefuseInteract; }
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+private:
+	UPROPERTY(Replicated)
+	TSubclassOf<class UItem> GrantedItemClass;
+
+	UPROPERTY(Replicated)
+	int32 PredictedItemQuantity;
+
+	int32 GrantedItemQuantity;
+
+	bool bRefuseInteract;
+
+	UFUNCTION()
+	void OnPredictInteracted(class ATrustCharacter* Character);
+
+
+	UPROPERTY(VisibleAnywhere, Category = "Components")
+	class USphereComponent* Bounds;
+
+	UPROPERTY(VisibleAnywhere, Category = "Components")
+	UInteractionTestPickupComponent* Interaction;
+
+	UFUNCTION()
+	void OnInteracted(class ATrustCharacter* Character);
+};
@@ -0,0 +1,131 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "InventoryBenchmark.h"
+#include "InventoryTestItems.h"
+#include "TrustNetworkTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS && WITH_EDITOR
+
+#include "Components/InventoryComponent.h"
+#include "Engine/NetConnection.h"
+#include "Trust/TrustCharacter.h"
+
+/**
+ * Makes the same inventory changes in legacy and then delta replication and counts what the server actually sent the
+ * client for them. Every change waits for the client to catch up before the next, so each goes out in its own update.
+ */
+class FInventoryBandwidthCommand : public FTrustNetworkTestCommand {
+
+public:
+	explicit FInventoryBandwidthCommand(FAutomationTestBase* InTest)
+		: FTrustNetworkTestCommand(InTest, 0, 0), bDelta(false), bPrepared(false), Change(0), bChangeSent(false), StartBytes(0) {}
+
+protected:
+	virtual bool UpdateTest(ATrustCharacter* ServerCharacter, ATrustCharacter* ClientCharacter) override {
+		UInventoryComponent* ServerInventory = ServerCharacter->GetPlayerInventory();
+		UInventoryComponent* ClientInventory = ClientCharacter->GetPlayerInventory();
+		UNetConnection* Connection = ServerCharacter->GetNetConnection();
+		if (!ServerInventory || !ClientInventory || !Connection) {
+			Test->AddError(TEXT("The characters need an inventory and the server a connection to the client"));
+			return true;
+		}
+
+		if (!bPrepared) {
+			//Start each mode from an empty inventory, whatever the character was given
+			if (ServerInventory->GetNumStacks() > 0) {
+				ServerInventory->RemoveItems(ServerInventory->GetStacksOfClass(UItem::StaticClass()));
+				return false;
+			}
+			if (ClientInventory->GetNumStacks() > 0) {
+				return false;
+			}
+
+			FInventoryBenchmark::SetUseDeltaReplication(ServerInventory, bDelta);
+			FInventoryBenchmark::SetUseDeltaReplication(ClientInventory, bDelta);
+			StartBytes = Connection->OutTotalBytes;
+			bPrepared = true;
+			return false;
+		}
+
+		if (!bChangeSent) {
+			MakeChange(ServerInventory, Change);
+			bChangeSent = true;
+			return false;
+		}
+
+		if (ClientInventory->GetNumStacks() != ServerInventory->GetNumStacks() || GetStackableQuantity(ClientInventory) != GetStackableQuantity(ServerInventory)) {
+			return false;
+		}
+
+		bChangeSent = false;
+		if (++Change < NumChanges) {
+			return false;
+		}
+
+		SentBytes[bDelta ? 1 : 0] = static_cast<int64>(Connection->OutTotalBytes) - StartBytes;
+		if (!bDelta) {
+			bDelta = true;
+			bPrepared = false;
+			Change = 0;
+			return false;
+		}
+
+		Test->AddInfo(FString::Printf(TEXT("%d inventory changes sent %lld bytes with legacy replication and %lld bytes with delta replication"),
+			NumChanges, SentBytes[0], SentBytes[1]));
+		Test->TestTrue(TEXT("Delta replication sends less than legacy replication for the same changes"), SentBytes[1] < SentBytes[0]);
+		return true;
+	}
+
+private:
+	static const int32 NumSingles = 40;
+
+	static const int32 NumQuantityChanges = 30;
+
+	static const int32 NumRemovals = 20;
+
+	//One batch filling the inventory, then quantity changes on one stack, then removals from the front of Items
+	static const int32 NumChanges = 1 + NumQuantityChanges + NumRemovals;
+
+	void MakeChange(UInventoryComponent* Inventory, const int32 ChangeIndex) const {
+		if (ChangeIndex == 0) {
+			FInventoryBatchScope BatchScope(Inventory);
+			for (int32 i = 0; i < NumSingles; ++i) {
+				Inventory->TryAddItemFromClass(UInventoryTestSingleItem::StaticClass());
+			}
+		} else if (ChangeIndex <= NumQuantityChanges) {
+			Inventory->TryAddItemFromClass(UInventoryTestStackableItem::StaticClass(), 1);
+		} else {
+			//Unless it happens to be the last one, this shifts every later element of the legacy Items array
+			const TArray<UItem*> Singles = Inventory->FindItemsByClass(UInventoryTestSingleItem::StaticClass());
+			if (Singles.Num() > 0) {
+				Inventory->RemoveItem(Singles[0]);
+			}
+		}
+	}
+
+	static int32 GetStackableQuantity(const UInventoryComponent* Inventory) {
+		const UItem* Stack = Inventory->FindItemByClass(UInventoryTestStackableItem::StaticClass());
+		return Stack ? Stack->GetQuantity() : 0;
+	}
+
+	bool bDelta;
+
+	bool bPrepared;
+
+	int32 Change;
+
+	bool bChangeSent;
+
+	int64 StartBytes;
+
+	int64 SentBytes[2] = { 0, 0 };
+};
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FInventoryDeltaReplicationBandwidthTest, "Trust.Inventory.DeltaReplicationBandwidth", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FInventoryDeltaReplicationBandwidthTest::RunTest(const FString& Parameters) {
+	ADD_LATENT_AUTOMATION_COMMAND(FInventoryBandwidthCommand(this));
+	return true;
+}
+
+#endif
@@ -0,0 +1,109 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "InventoryBenchmark.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "Components/InventoryComponent.h"
+#include "HAL/FileManager.h"
+#include "InventoryTestItems.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+const TArray<int32>& FInventoryBenchmark::GetStackCounts() {
+	static const TArray<int32> StackCounts = { 10, 100, 1000, 10000 };
+	return StackCounts;
+}
+
+const TArray<int32>& FInventoryBenchmark::GetReplicatedStackCounts() {
+	static const TArray<int32> StackCounts = { 10, 100, 1000 };
+	return StackCounts;
+}
+
+void FInventoryBenchmark::SetUseDeltaReplication(UInventoryComponent* Inventory, const bool bUseDeltaReplication) {
+	check(Inventory->GetNumStacks() == 0);
+	Inventory->bUseDeltaReplication = bUseDeltaReplication;
+}
+
+void FInventoryBenchmark::Fill(UInventoryComponent* Inventory, const int32 StackCount) {
+	Inventory->SetCapacity(FMath::Max(StackCount, Inventory->GetCapacity()));
+	Inventory->SetWeightCapacity(BIG_NUMBER);
+
+	Inventory->TryAddItemFromClass(UInventoryTestStackableItem::StaticClass(), 1);
+	Inventory->TryAddItemFromClass(UInventoryTestCompactItem::StaticClass(), 1);
+	for (int32 i = 2; i < StackCount; ++i) {
+		Inventory->TryAddItemFromClass(UInventoryTestSingleItem::StaticClass());
+	}
+}
+
+int32 FInventoryBenchmark::FindItems(const UInventoryComponent* Inventory, const int32 Ops) {
+	const TSubclassOf<UItem> LookupClasses[] = { UItem::StaticClass(), UInventoryTestSingleItem::StaticClass(), UInventoryTestStackableItem::StaticClass() };
+
+	int32 Found = 0;
+	for (int32 i = 0; i < Ops; ++i) {
+		Found += Inventory->FindItemsByClass(LookupClasses[i % UE_ARRAY_COUNT(LookupClasses)]).Num();
+	}
+	return Found;
+}
+
+void FInventoryBenchmark::Churn(UInventoryComponent* Inventory, FRandomStream& Random, const int32 Ops) {
+	const TSubclassOf<UItem> StackableClasses[] = { UInventoryTestStackableItem::StaticClass(), UInventoryTestCompactItem::StaticClass() };
+
+	for (int32 i = 0; i < Ops; ++i) {
+		const float Roll = Random.FRand();
+		const TSubclassOf<UItem> StackableClass = StackableClasses[Random.RandHelper(UE_ARRAY_COUNT(StackableClasses))];
+
+		if (Roll < 0.5f) {
+			Inventory->TryAddItemFromClass(StackableClass, 1);
+		} else if (Roll < 0.75f) {
+			//Never the last one, so the stack stays and churn only changes quantities
+			int32 Quantity = 0;
+			if (Inventory->FindStackQuantity(StackableClass, Quantity) && Quantity > 1) {
+				Inventory->ConsumeItemOfClass(StackableClass, 1);
+			}
+		} else if (UItem* Single = Inventory->ItemIndex.FindFirstOfClass(UInventoryTestSingleItem::StaticClass())) {
+			Inventory->ConsumeItem(Single);
+			Inventory->TryAddItemFromClass(UInventoryTestSingleItem::StaticClass());
+		}
+	}
+}
+
+int32 FInventoryBenchmark::Drain(UInventoryComponent* Inventory) {
+	const TArray<FInventoryItemRequest> Stacks = Inventory->GetStacksOfClass(UItem::StaticClass());
+
+	for (const FInventoryItemRequest& Stack : Stacks) {
+		Inventory->RemoveItems({ Stack });
+	}
+	return Stacks.Num();
+}
+
+int32 FInventoryBenchmark::GetTotalQuantity(const UInventoryComponent* Inventory) {
+	int32 TotalQuantity = 0;
+	for (const FInventoryItemRequest& Stack : Inventory->GetStacksOfClass(UItem::StaticClass())) {
+		TotalQuantity += Stack.Quantity;
+	}
+	return TotalQuantity;
+}
+
+uint64 FInventoryBenchmark::GetReplicateSubobjectsCycles(const UInventoryComponent* Inventory) {
+	return Inventory->ReplicateSubobjectsCycles;
+}
+
+uint64 FInventoryBenchmark::GetItemsAllocated() {
+	return UInventoryComponent::NumItemsAllocated;
+}
+
+FString FInventoryBenchmark::SaveCsv(const FString& Name, const TArray<FResult>& Results) {
+	FString Csv = TEXT("Workload,Replication,Stacks,Ops,NsPerOp,ItemsAllocated,ObjectsCreated,BytesSent,ReplicateNsPerFrame\n");
+	for (const FResult& Result : Results) {
+		Csv += FString::Printf(TEXT("%s,%s,%d,%d,%.1f,%llu,%d,%lld,%.1f\n"), *Result.Workload, *Result.Replication, Result.Stacks, Result.Ops,
+			Result.NsPerOp, Result.ItemsAllocated, Result.ObjectsCreated, Result.BytesSent, Result.ReplicateNsPerFrame);
+	}
+
+	const FString CsvPath = FPaths::ProfilingDir() / TEXT("Inventory") / FString::Printf(TEXT("%s-%s.csv"), *Name, *FDateTime::Now().ToString());
+	FFileHelper::SaveStringToFile(Csv, *CsvPath);
+	return IFileManager::Get().ConvertToAbsolutePathForExternalAppForWrite(*CsvPath);
+}
+
+#endif
@@ -0,0 +1,67 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+class UInventoryComponent;
+
+/**
+ * Synthetic fill, lookup, churn and drain workloads shared by the inventory benchmark tests, so timings and bytes on
+ * the wire come from the same changes. Friend of UInventoryComponent so it can switch replication modes and reach Items.
+ *
+ * Inventories hold one stack per class, so a stackable share can only be as large as the number of stackable classes.
+ * Every fill is one stack each of UInventoryTestStackableItem and UInventoryTestCompactItem and singles for the rest,
+ * and churn spends half its operations on quantity changes to those two stacks.
+ */
+struct FInventoryBenchmark {
+
+public:
+	struct FResult {
+		FString Workload;
+		FString Replication;
+		int32 Stacks = 0;
+		int32 Ops = 0;
+		double NsPerOp = 0.0;
+		uint64 ItemsAllocated = 0;
+		int32 ObjectsCreated = 0;
+		int64 BytesSent = 0;
+		double ReplicateNsPerFrame = 0.0;
+	};
+
+	/**10 to 10k stacks, for the timing runs*/
+	static const TArray<int32>& GetStackCounts();
+
+	/**GetStackCounts without 10k. Sending 10k legacy item subobjects to a PIE client takes minutes of saturated net updates,
+	 * long enough to time the test out, while 1k already shows how bytes sent grow with inventory size*/
+	static const TArray<int32>& GetReplicatedStackCounts();
+
+	/**Only while the inventory is empty. In PIE set it on both ends, clients read entries differently in each mode*/
+	static void SetUseDeltaReplication(UInventoryComponent* Inventory, const bool bUseDeltaReplication);
+
+	static void Fill(UInventoryComponent* Inventory, const int32 StackCount);
+
+	static int32 FindItems(const UInventoryComponent* Inventory, const int32 Ops);
+
+	static void Churn(UInventoryComponent* Inventory, FRandomStream& Random, const int32 Ops);
+
+	/**Removes every stack, one at a time. Returns how many there were*/
+	static int32 Drain(UInventoryComponent* Inventory);
+
+	/**Time Inventory has spent in ReplicateSubobjects so far*/
+	static uint64 GetReplicateSubobjectsCycles(const UInventoryComponent* Inventory);
+
+	/**UItems every inventory has created so far, differences of it are what a workload allocated*/
+	static uint64 GetItemsAllocated();
+
+	/**Sum of every stack's quantity, compact ones included, for telling when a client has caught up*/
+	static int32 GetTotalQuantity(const UInventoryComponent* Inventory);
+
+	/**Writes Results to Saved/Profiling/Inventory and returns the path*/
+	static FString SaveCsv(const FString& Name, const TArray<FResult>& Results);
+};
+
+#endif
@@ -0,0 +1,259 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "InventoryBenchmark.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "Components/InventoryComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "TrustTestWorld.h"
+
+#if WITH_EDITOR
+#include "Engine/NetConnection.h"
+#include "Trust/TrustCharacter.h"
+#include "TrustNetworkTest.h"
+#endif
+
+//Headless: -nullrhi -unattended -ExecCmds="Automation RunTests Trust.Inventory.Benchmark;Quit"
+
+/**Times each workload against an inventory in a standalone world, for both replication modes*/
+class FInventoryBenchmarkTimer {
+
+public:
+	FInventoryBenchmarkTimer(UWorld* InWorld, TArray<FInventoryBenchmark::FResult>& InResults) : World(InWorld), Results(InResults), Random(0x7457) {}
+
+	void RunSize(const int32 StackCount, const bool bDelta) {
+		AActor* Owner = World->SpawnActor<AActor>();
+		UInventoryComponent* Inventory = NewObject<UInventoryComponent>(Owner);
+		FInventoryBenchmark::SetUseDeltaReplication(Inventory, bDelta);
+		Inventory->RegisterComponent();
+
+		const FString Replication = bDelta ? TEXT("Delta") : TEXT("Legacy");
+
+		Measure(TEXT("Fill"), Replication, StackCount, StackCount, [&]() { FInventoryBenchmark::Fill(Inventory, StackCount); });
+		Measure(TEXT("FindItemsByClass"), Replication, StackCount, 1000, [&]() { FInventoryBenchmark::FindItems(Inventory, 1000); });
+		Measure(TEXT("Churn"), Replication, StackCount, 10000, [&]() { FInventoryBenchmark::Churn(Inventory, Random, 10000); });
+		Measure(TEXT("Drain"), Replication, StackCount, Inventory->GetNumStacks(), [&]() { FInventoryBenchmark::Drain(Inventory); });
+
+		Inventory->DestroyComponent();
+		Owner->Destroy();
+	}
+
+private:
+	template<typename FunctionType>
+	void Measure(const TCHAR* Workload, const FString& Replication, const int32 StackCount, const int32 Ops, FunctionType Function) {
+		const uint64 ItemsBefore = FInventoryBenchmark::GetItemsAllocated();
+		const int32 ObjectsBefore = GUObjectArray.GetObjectArrayNumMinusAvailable();
+
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+		Function();
+		const uint64 EndCycles = FPlatformTime::Cycles64();
+
+		FInventoryBenchmark::FResult& Result = Results.AddDefaulted_GetRef();
+		Result.Workload = Workload;
+		Result.Replication = Replication;
+		Result.Stacks = StackCount;
+		Result.Ops = Ops;
+		Result.NsPerOp = Ops > 0 ? FPlatformTime::ToMilliseconds64(EndCycles - StartCycles) * 1000000.0 / Ops : 0.0;
+		Result.ItemsAllocated = FInventoryBenchmark::GetItemsAllocated() - ItemsBefore;
+		Result.ObjectsCreated = GUObjectArray.GetObjectArrayNumMinusAvailable() - ObjectsBefore;
+	}
+
+	UWorld* World;
+
+	TArray<FInventoryBenchmark::FResult>& Results;
+
+	FRandomStream Random;
+};
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FInventoryBenchmarkTimingTest, "Trust.Inventory.Benchmark.Timing", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::PerfFilter)
+
+bool FInventoryBenchmarkTimingTest::RunTest(const FString& Parameters) {
+	TArray<FInventoryBenchmark::FResult> Results;
+	{
+		FTrustTestWorld World;
+		FInventoryBenchmarkTimer Timer(World.Get(), Results);
+		for (const bool bDelta : { false, true }) {
+			for (const int32 StackCount : FInventoryBenchmark::GetStackCounts()) {
+				Timer.RunSize(StackCount, bDelta);
+			}
+		}
+	}
+
+	for (const FInventoryBenchmark::FResult& Result : Results) {
+		AddInfo(FString::Printf(TEXT("%s %s, %d stacks: %.1f ns per op over %d ops, %llu items allocated, %d objects created"), *Result.Workload, *Result.Replication,
+			Result.Stacks, Result.NsPerOp, Result.Ops, Result.ItemsAllocated, Result.ObjectsCreated));
+	}
+	AddInfo(FString::Printf(TEXT("Written to %s"), *FInventoryBenchmark::SaveCsv(TEXT("InventoryBenchmarkTiming"), Results)));
+
+	//The compact stack is the one difference between the modes' fills, and it must not cost a UItem
+	const FInventoryBenchmark::FResult* LegacyFill = Results.FindByPredicate([](const FInventoryBenchmark::FResult& Result) { return Result.Workload == TEXT("Fill") && Result.Replication == TEXT("Legacy"); });
+	const FInventoryBenchmark::FResult* DeltaFill = Results.FindByPredicate([](const FInventoryBenchmark::FResult& Result) { return Result.Workload == TEXT("Fill") && Result.Replication == TEXT("Delta"); });
+	if (LegacyFill && DeltaFill) {
+		TestTrue(TEXT("Delta replication creates fewer objects filling the same inventory"), DeltaFill->ObjectsCreated < LegacyFill->ObjectsCreated);
+	}
+	return true;
+}
+
+#if WITH_EDITOR
+
+/**
+ * Runs each workload on the server character's inventory in PIE and counts the bytes the server's connection sends
+ * until the client has caught up. Each workload runs within one frame, so this is what one net update carries.
+ */
+class FInventoryBenchmarkBytesCommand : public FTrustNetworkTestCommand {
+
+public:
+	explicit FInventoryBenchmarkBytesCommand(FAutomationTestBase* InTest)
+		: FTrustNetworkTestCommand(InTest, 0, 0), bDelta(false), SizeIndex(0), Workload(EWorkload::Prepare), bRunning(false), RunTime(0.0), StartBytes(0),
+		StartReplicateCycles(0), StartFrame(0) {
+		TestTimeout = 180.0;
+	}
+
+protected:
+	virtual bool UpdateTest(ATrustCharacter* ServerCharacter, ATrustCharacter* ClientCharacter) override {
+		UInventoryComponent* ServerInventory = ServerCharacter->GetPlayerInventory();
+		UInventoryComponent* ClientInventory = ClientCharacter->GetPlayerInventory();
+		UNetConnection* Connection = ServerCharacter->GetNetConnection();
+		if (!ServerInventory || !ClientInventory || !Connection) {
+			Test->AddError(TEXT("The characters need an inventory and the server a connection to the client"));
+			return true;
+		}
+
+		const double Now = FPlatformTime::Seconds();
+		const bool bInSync = ClientInventory->GetNumStacks() == ServerInventory->GetNumStacks()
+			&& FInventoryBenchmark::GetTotalQuantity(ClientInventory) == FInventoryBenchmark::GetTotalQuantity(ServerInventory);
+
+		if (Workload == EWorkload::Prepare) {
+			//Start every size from an empty inventory, whatever the character was given
+			if (ServerInventory->GetNumStacks() > 0) {
+				FInventoryBenchmark::Drain(ServerInventory);
+			} else if (ClientInventory->GetNumStacks() == 0) {
+				FInventoryBenchmark::SetUseDeltaReplication(ServerInventory, bDelta);
+				FInventoryBenchmark::SetUseDeltaReplication(ClientInventory, bDelta);
+				Workload = EWorkload::Fill;
+			}
+			return false;
+		}
+
+		if (!bRunning) {
+			StartBytes = Connection->OutTotalBytes;
+			StartReplicateCycles = FInventoryBenchmark::GetReplicateSubobjectsCycles(ServerInventory);
+			StartFrame = GFrameCounter;
+			RunTime = Now;
+			bRunning = true;
+
+			const int32 StackCount = FInventoryBenchmark::GetReplicatedStackCounts()[SizeIndex];
+			if (Workload == EWorkload::Fill) {
+				FInventoryBenchmark::Fill(ServerInventory, StackCount);
+			} else if (Workload == EWorkload::Churn) {
+				//Same seed for both modes, so they replicate the same changes
+				FRandomStream Random(0x7457 + StackCount);
+				FInventoryBenchmark::Churn(ServerInventory, Random, ChurnOps);
+			} else {
+				FInventoryBenchmark::Drain(ServerInventory);
+			}
+			return false;
+		}
+
+		//A net update or two is all a workload makes, waiting a little longer catches the last of it
+		if (!bInSync || Now - RunTime < SettleTime) {
+			return false;
+		}
+
+		FInventoryBenchmark::FResult& Result = Results.AddDefaulted_GetRef();
+		Result.Workload = Workload == EWorkload::Fill ? TEXT("Fill") : (Workload == EWorkload::Churn ? TEXT("Churn") : TEXT("Drain"));
+		Result.Replication = bDelta ? TEXT("Delta") : TEXT("Legacy");
+		Result.Stacks = FInventoryBenchmark::GetReplicatedStackCounts()[SizeIndex];
+		Result.Ops = Workload == EWorkload::Churn ? ChurnOps : Result.Stacks;
+		Result.BytesSent = static_cast<int64>(Connection->OutTotalBytes) - StartBytes;
+
+		//Averaged over every frame until the client caught up, the frames with nothing to send included
+		const uint64 ReplicateCycles = FInventoryBenchmark::GetReplicateSubobjectsCycles(ServerInventory) - StartReplicateCycles;
+		Result.ReplicateNsPerFrame = FPlatformTime::ToMilliseconds64(ReplicateCycles) * 1000000.0 / FMath::Max<uint64>(GFrameCounter - StartFrame, 1);
+		bRunning = false;
+
+		if (Workload != EWorkload::Drain) {
+			Workload = Workload == EWorkload::Fill ? EWorkload::Churn : EWorkload::Drain;
+			return false;
+		}
+
+		Workload = EWorkload::Prepare;
+		if (++SizeIndex < FInventoryBenchmark::GetReplicatedStackCounts().Num()) {
+			return false;
+		}
+
+		SizeIndex = 0;
+		if (!bDelta) {
+			bDelta = true;
+			return false;
+		}
+
+		Report();
+		return true;
+	}
+
+private:
+	enum class EWorkload : uint8 {
+		Prepare,
+		Fill,
+		Churn,
+		Drain
+	};
+
+	static const int32 ChurnOps = 200;
+
+	static constexpr double SettleTime = 0.5;
+
+	void Report() const {
+		for (const FInventoryBenchmark::FResult& Result : Results) {
+			Test->AddInfo(FString::Printf(TEXT("%s %s, %d stacks: %lld bytes sent for %d ops, %.0f ns per frame in ReplicateSubobjects"), *Result.Workload, *Result.Replication,
+				Result.Stacks, Result.BytesSent, Result.Ops, Result.ReplicateNsPerFrame));
+		}
+		Test->AddInfo(FString::Printf(TEXT("Written to %s"), *FInventoryBenchmark::SaveCsv(TEXT("InventoryBenchmarkBytes"), Results)));
+
+		//Churn in the largest inventory is what delta replication is for
+		const int32 LargestStackCount = FInventoryBenchmark::GetReplicatedStackCounts().Last();
+		auto FindChurn = [this, LargestStackCount](const TCHAR* Replication) {
+			return Results.FindByPredicate([Replication, LargestStackCount](const FInventoryBenchmark::FResult& Result) {
+				return Result.Workload == TEXT("Churn") && Result.Replication == Replication && Result.Stacks == LargestStackCount;
+			});
+		};
+
+		const FInventoryBenchmark::FResult* LegacyChurn = FindChurn(TEXT("Legacy"));
+		const FInventoryBenchmark::FResult* DeltaChurn = FindChurn(TEXT("Delta"));
+		if (LegacyChurn && DeltaChurn) {
+			Test->TestTrue(TEXT("Delta replication sends less for churn in a large inventory"), DeltaChurn->BytesSent < LegacyChurn->BytesSent);
+		}
+	}
+
+	bool bDelta;
+
+	int32 SizeIndex;
+
+	EWorkload Workload;
+
+	bool bRunning;
+
+	double RunTime;
+
+	int64 StartBytes;
+
+	uint64 StartReplicateCycles;
+
+	uint64 StartFrame;
+
+	TArray<FInventoryBenchmark::FResult> Results;
+};
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FInventoryBenchmarkBytesTest, "Trust.Inventory.Benchmark.BytesSent", EAutomationTestFlags::EditorContext | EAutomationTestFlags::PerfFilter)
+
+bool FInventoryBenchmarkBytesTest::RunTest(const FString& Parameters) {
+	ADD_LATENT_AUTOMATION_COMMAND(FInventoryBenchmarkBytesCommand(this));
+	return true;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,165 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "InventoryBenchmark.h"
+#include "InventoryTestItems.h"
+#include "TrustTestWorld.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "Components/InventoryComponent.h"
+#include "Components/InventorySnapshot.h"
+#include "Engine/World.h"
+#include "Trust/TrustCharacter.h"
+#include "UObject/UObjectIterator.h"
+
+//An empty, delta replicated inventory, which is what compact stacks need
+static ATrustCharacter* SpawnSnapshotTestCharacter(UWorld* World) {
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	ATrustCharacter* Character = World->SpawnActor<ATrustCharacter>(ATrustCharacter::StaticClass(), FVector::ZeroVector, FRotator::ZeroRotator, SpawnParameters);
+
+	UInventoryComponent* Inventory = Character->GetPlayerInventory();
+	FInventoryBenchmark::Drain(Inventory);
+	FInventoryBenchmark::SetUseDeltaReplication(Inventory, true);
+	Inventory->SetCapacity(FMath::Max(Inventory->GetCapacity(), 10));
+	Inventory->SetWeightCapacity(BIG_NUMBER);
+	return Character;
+}
+
+//Class and quantity of every stack, sorted, so inventories can be compared whatever order their stacks are in
+static FString DescribeStacks(const UInventoryComponent* Inventory) {
+	TArray<FString> Stacks;
+	for (const FInventoryItemRequest& Stack : Inventory->GetStacksOfClass(UItem::StaticClass())) {
+		Stacks.Add(FString::Printf(TEXT("%s x%d"), *GetNameSafe(Stack.ItemClass), Stack.Quantity));
+	}
+	Stacks.Sort();
+	return FString::Join(Stacks, TEXT(", "));
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FInventorySnapshotRoundTripTest, "Trust.Inventory.SnapshotRoundTrip", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::EngineFilter)
+
+bool FInventorySnapshotRoundTripTest::RunTest(const FString& Parameters) {
+	FTrustTestWorld World;
+
+	ATrustCharacter* Source = SpawnSnapshotTestCharacter(World.Get());
+	UInventoryComponent* SourceInventory = Source->GetPlayerInventory();
+	SourceInventory->TryAddItemFromClass(UInventoryTestStackableItem::StaticClass(), 25);
+	SourceInventory->TryAddItemFromClass(UInventoryTestCompactItem::StaticClass(), 40);
+	SourceInventory->TryAddItemFromClass(UInventoryTestSingleItem::StaticClass());
+	SourceInventory->TryAddItemFromClass(UInventoryTestSingleItem::StaticClass());
+	SourceInventory->TryAddItemFromClass(UInventoryTestEquippableItem::StaticClass());
+
+	UItem* Equippable = SourceInventory->FindItemByClass(UInventoryTestEquippableItem::StaticClass());
+	Source->UseItem(Equippable);
+	if (!TestTrue(TEXT("Using the equippable equips it"), Equippable && Source->GetEquippedItem(EEquippableSlot::EIS_Head) == Equippable)) {
+		return false;
+	}
+	const UItem* SourceCompact = SourceInventory->FindItemByClass(UInventoryTestCompactItem::StaticClass());
+	TestTrue(TEXT("The compact stack is found as a stack view before capturing"), SourceCompact && SourceCompact->IsStackView() && SourceCompact->GetQuantity() == 40);
+
+	FInventorySnapshot Captured;
+	Source->CaptureInventorySnapshot(Captured);
+	TestEqual(TEXT("Every stack is captured"), Captured.Stacks.Num(), 5);
+	TestEqual(TEXT("The equipped item is captured"), Captured.Equipment.Num(), 1);
+
+	TArray<uint8> Bytes;
+	FInventorySnapshot Loaded;
+	TestTrue(TEXT("The snapshot writes"), Captured.ToBytes(Bytes));
+	TestTrue(TEXT("The snapshot reads back"), Loaded.FromBytes(Bytes));
+	TestTrue(TEXT("The snapshot reads back unchanged"), Loaded == Captured);
+
+	ATrustCharacter* Target = SpawnSnapshotTestCharacter(World.Get());
+	UInventoryComponent* TargetInventory = Target->GetPlayerInventory();
+	TestTrue(TEXT("Every stack restores"), Target->RestoreInventorySnapshot(Loaded));
+	TestEqual(TEXT("The restored inventory holds the same stacks"), DescribeStacks(TargetInventory), DescribeStacks(SourceInventory));
+	const UItem* TargetCompact = TargetInventory->FindItemByClass(UInventoryTestCompactItem::StaticClass());
+	TestTrue(TEXT("The compact stack is restored compact and found as a stack view"), TargetCompact && TargetCompact->IsStackView() && TargetCompact->GetQuantity() == 40);
+
+	const UEquippableItem* RestoredEquippable = Target->GetEquippedItem(EEquippableSlot::EIS_Head);
+	TestTrue(TEXT("The equipped item is restored, equipped, from the restored inventory"),
+		RestoredEquippable && RestoredEquippable->IsA<UInventoryTestEquippableItem>() && TargetInventory->ContainsItem(RestoredEquippable));
+
+	FInventorySnapshot Recaptured;
+	Target->CaptureInventorySnapshot(Recaptured);
+	TestTrue(TEXT("Capturing the restored inventory gives the same snapshot"), Recaptured == Loaded);
+
+	Source->Destroy();
+	Target->Destroy();
+	return true;
+}
+
+//Headless: -nullrhi -unattended -ExecCmds="Automation RunTests Trust.Inventory.SnapshotBenchmark;Quit"
+
+static const int32 SnapshotBenchmarkInventories = 10000;
+
+static const int32 SnapshotBenchmarkStacksPerInventory = 20;
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FInventorySnapshotBenchmarkTest, "Trust.Inventory.SnapshotBenchmark", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::PerfFilter)
+
+/**Round trips synthetic snapshots through the binary format, checks every one comes back identical and reports the throughput*/
+bool FInventorySnapshotBenchmarkTest::RunTest(const FString& Parameters) {
+	TArray<UClass*> ItemClasses;
+	for (TObjectIterator<UClass> It; It; ++It) {
+		if (It->IsChildOf(UItem::StaticClass()) && !It->HasAnyClassFlags(CLASS_Abstract | CLASS_Deprecated | CLASS_NewerVersionExists)) {
+			ItemClasses.Add(*It);
+		}
+	}
+
+	FRandomStream Random(SnapshotBenchmarkInventories);
+	TArray<FInventorySnapshot> Snapshots;
+	Snapshots.SetNum(SnapshotBenchmarkInventories);
+
+	for (FInventorySnapshot& Snapshot : Snapshots) {
+		for (int32 i = 0; i < SnapshotBenchmarkStacksPerInventory; ++i) {
+			Snapshot.AddStack(ItemClasses[Random.RandHelper(ItemClasses.Num())], Random.RandRange(1, 100));
+		}
+
+		for (uint8 Slot = 0; Slot < 5; ++Slot) {
+			Snapshot.AddEquipment(Slot, Random.RandHelper(SnapshotBenchmarkStacksPerInventory));
+		}
+	}
+
+	TArray<TArray<uint8>> Buffers;
+	Buffers.SetNum(SnapshotBenchmarkInventories);
+
+	int64 TotalBytes = 0;
+	const double WriteStart = FPlatformTime::Seconds();
+	for (int32 i = 0; i < SnapshotBenchmarkInventories; ++i) {
+		Snapshots[i].ToBytes(Buffers[i]);
+		TotalBytes += Buffers[i].Num();
+	}
+	const double WriteSeconds = FPlatformTime::Seconds() - WriteStart;
+
+	TArray<FInventorySnapshot> Loaded;
+	Loaded.SetNum(SnapshotBenchmarkInventories);
+
+	const double ReadStart = FPlatformTime::Seconds();
+	int32 NumFailed = 0;
+	for (int32 i = 0; i < SnapshotBenchmarkInventories; ++i) {
+		if (!Loaded[i].FromBytes(Buffers[i])) {
+			++NumFailed;
+		}
+	}
+	const double ReadSeconds = FPlatformTime::Seconds() - ReadStart;
+
+	int32 NumMismatched = 0;
+	for (int32 i = 0; i < SnapshotBenchmarkInventories; ++i) {
+		if (!(Snapshots[i] == Loaded[i])) {
+			++NumMismatched;
+		}
+	}
+
+	const double MegaBytes = TotalBytes / (1024.0 * 1024.0);
+	AddInfo(FString::Printf(TEXT("%d inventories, %d stacks each, %d item classes, %.1f bytes per inventory"),
+		SnapshotBenchmarkInventories, SnapshotBenchmarkStacksPerInventory, ItemClasses.Num(), (double)TotalBytes / SnapshotBenchmarkInventories));
+	AddInfo(FString::Printf(TEXT("Write %.2f ms (%.0f inventories/s, %.1f MB/s)"), WriteSeconds * 1000.0,
+		SnapshotBenchmarkInventories / FMath::Max(WriteSeconds, SMALL_NUMBER), MegaBytes / FMath::Max(WriteSeconds, SMALL_NUMBER)));
+	AddInfo(FString::Printf(TEXT("Read %.2f ms (%.0f inventories/s, %.1f MB/s)"), ReadSeconds * 1000.0,
+		SnapshotBenchmarkInventories / FMath::Max(ReadSeconds, SMALL_NUMBER), MegaBytes / FMath::Max(ReadSeconds, SMALL_NUMBER)));
+
+	TestEqual(TEXT("Every snapshot reads back"), NumFailed, 0);
+	TestEqual(TEXT("Every snapshot reads back unchanged"), NumMismatched, 0);
+	return true;
+}
+
+#endif
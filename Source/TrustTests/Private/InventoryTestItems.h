@@ -0,0 +1,62 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Items/EquippableItem.h"
+#include "Items/Item.h"
+#include "InventoryTestItems.generated.h"
+
+/**Stackable item for the inventory tests, so the results don't depend on which game items are loaded*/
+UCLASS(NotBlueprintable, HideDropdown)
+class UInventoryTestStackableItem : public UItem {
+	GENERATED_BODY()
+
+public:
+	UInventoryTestStackableItem() {
+		bStackable = true;
+		MaxStackSize = 1000;
+		Weight = 0.01f;
+	}
+};
+
+/**Non-stackable counterpart of UInventoryTestStackableItem, every instance is its own stack*/
+UCLASS(NotBlueprintable, HideDropdown)
+class UInventoryTestSingleItem : public UItem {
+	GENERATED_BODY()
+
+public:
+	UInventoryTestSingleItem() {
+		bStackable = false;
+		Weight = 0.1f;
+	}
+};
+
+/**Stackable item kept as class and quantity by delta replicated inventories*/
+UCLASS(NotBlueprintable, HideDropdown)
+class UInventoryTestCompactItem : public UItem {
+	GENERATED_BODY()
+
+public:
+	UInventoryTestCompactItem() {
+		bStackable = true;
+		bCompactStack = true;
+		MaxStackSize = 1000;
+		Weight = 0.01f;
+	}
+
+	virtual bool HasStatelessNativeUse() const override {
+		return true;
+	}
+};
+
+/**Equips into the head slot and does nothing else, for tests that need equipment without armor meshes*/
+UCLASS(NotBlueprintable, HideDropdown)
+class UInventoryTestEquippableItem : public UEquippableItem {
+	GENERATED_BODY()
+
+public:
+	UInventoryTestEquippableItem() {
+		Slot = EEquippableSlot::EIS_Head;
+	}
+};
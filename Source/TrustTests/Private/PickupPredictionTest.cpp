@@ -0,0 +1,239 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "InteractionTestPickup.h"
+#include "InventoryTestItems.h"
+#include "TrustNetworkTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS && WITH_EDITOR
+
+#include "Components/InventoryComponent.h"
+#include "EngineUtils.h"
+#include "Trust/TrustCharacter.h"
+
+/**Picks up predicted pickups one after another and times, from the key press, when the client hides each one and when
+ * the server's answer has arrived and the prediction is settled*/
+class FPickupPredictionLatencyCommand : public FTrustNetworkTestCommand {
+
+public:
+	FPickupPredictionLatencyCommand(FAutomationTestBase* InTest, const int32 InLagMs, const int32 InNumPickups)
+		: FTrustNetworkTestCommand(InTest, InLagMs, 0), NumPickups(InNumPickups), PressTime(0.0), ShowTime(0.0), bPressed(false) {}
+
+protected:
+	virtual bool UpdateTest(ATrustCharacter* ServerCharacter, ATrustCharacter* ClientCharacter) override {
+		const double Now = FPlatformTime::Seconds();
+
+		if (!bPressed) {
+			if (!ServerPickup.IsValid()) {
+				FActorSpawnParameters SpawnParameters;
+				SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+				const FVector Location = ServerCharacter->GetActorLocation() + ServerCharacter->GetActorForwardVector() * 100.f;
+				ServerPickup = ServerCharacter->GetWorld()->SpawnActor<AInteractionTestPickup>(Location, FRotator::ZeroRotator, SpawnParameters);
+				return false;
+			}
+
+			//Wait for the pickup to replicate, then press interact on it
+			for (TActorIterator<AInteractionTestPickup> It(ClientCharacter->GetWorld()); It; ++It) {
+				ClientPickup = *It;
+				PressTime = Now;
+				ShowTime = 0.0;
+				bPressed = true;
+				FInteractionNetworkTestDriver::Interact(ClientCharacter, It->GetInteraction());
+
+				if (It->IsHidden()) {
+					ShowTime = Now;
+				}
+				break;
+			}
+			return false;
+		}
+
+		AInteractionTestPickup* Pickup = ClientPickup.Get();
+		const bool bPickupGone = !Pickup || Pickup->IsPendingKillPending();
+
+		if (ShowTime == 0.0 && !bPickupGone && Pickup->IsHidden()) {
+			ShowTime = Now;
+		}
+
+		if (ShowTime != 0.0 && !bPickupGone && !Pickup->IsHidden()) {
+			Test->AddError(TEXT("The predicted pickup was rolled back"));
+			return true;
+		}
+
+		if (bPickupGone && !FInteractionNetworkTestDriver::HasPredictedInteractions(ClientCharacter)) {
+			if (ShowTime == 0.0) {
+				Test->AddError(TEXT("The pickup was never hidden before the server removed it, it wasn't predicted"));
+				return true;
+			}
+
+			ShowMs.Add((ShowTime - PressTime) * 1000.0);
+			ConfirmMs.Add((Now - PressTime) * 1000.0);
+			ServerPickup.Reset();
+			ClientPickup.Reset();
+			bPressed = false;
+		}
+
+		if (ConfirmMs.Num() < NumPickups) {
+			return false;
+		}
+
+		const double MaxShowMs = FMath::Max(ShowMs);
+		const double MinConfirmMs = FMath::Min(ConfirmMs);
+		Test->AddInfo(FString::Printf(TEXT("%d pickups with %d ms packet lag: shown after at most %.1f ms, confirmed after %.1f to %.1f ms"),
+			NumPickups, LagMs, MaxShowMs, MinConfirmMs, FMath::Max(ConfirmMs)));
+
+		//Showing must not wait for the network, confirming can't be faster than the lag it goes through
+		Test->TestTrue(TEXT("Predicted pickups show before the server could have answered"), MaxShowMs < LagMs);
+		Test->TestTrue(TEXT("Server confirmation takes at least the emulated lag"), MinConfirmMs >= LagMs);
+		return true;
+	}
+
+private:
+	const int32 NumPickups;
+
+	TWeakObjectPtr<AInteractionTestPickup> ServerPickup;
+
+	TWeakObjectPtr<AInteractionTestPickup> ClientPickup;
+
+	double PressTime;
+
+	double ShowTime;
+
+	bool bPressed;
+
+	TArray<double> ShowMs;
+
+	TArray<double> ConfirmMs;
+};
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPickupPredictionLatencyTest, "Trust.Interaction.PickupPredictionLatency", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FPickupPredictionLatencyTest::RunTest(const FString& Parameters) {
+	ADD_LATENT_AUTOMATION_COMMAND(FPickupPredictionLatencyCommand(this, 150, 5));
+	return true;
+}
+
+/**
+ * Picks up three pickups that predict a stack of UInventoryTestStackableItem. The server grants the first, refuses the
+ * second and grants nothing for the third. Each predicted stack has to show on the press, and then be replaced by the
+ * server's stack, be removed by the rejection, or be removed once the confirmed prediction times out
+ */
+class FPickupPredictedItemCommand : public FTrustNetworkTestCommand {
+
+public:
+	FPickupPredictedItemCommand(FAutomationTestBase* InTest, const int32 InLagMs)
+		: FTrustNetworkTestCommand(InTest, InLagMs, 0), Case(ECase::Granted), bPressed(false), PressTime(0.0), QuantityBefore(0) {}
+
+protected:
+	virtual bool UpdateTest(ATrustCharacter* ServerCharacter, ATrustCharacter* ClientCharacter) override {
+		const double Now = FPlatformTime::Seconds();
+		UInventoryComponent* ClientInventory = ClientCharacter->GetPlayerInventory();
+		const UClass* ItemClass = UInventoryTestStackableItem::StaticClass();
+
+		if (!bPressed) {
+			if (!ServerPickup.IsValid()) {
+				//The last case's pickup has to be gone on the client too, so the one found next is the new one
+				if (TActorIterator<AInteractionTestPickup>(ClientCharacter->GetWorld())) {
+					return false;
+				}
+
+				FActorSpawnParameters SpawnParameters;
+				SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+				const FVector Location = ServerCharacter->GetActorLocation() + ServerCharacter->GetActorForwardVector() * 100.f;
+				AInteractionTestPickup* Pickup = ServerCharacter->GetWorld()->SpawnActor<AInteractionTestPickup>(Location, FRotator::ZeroRotator, SpawnParameters);
+				Pickup->SetGrantedItem(UInventoryTestStackableItem::StaticClass(), PickupQuantity, Case == ECase::NeverGranted ? 0 : PickupQuantity);
+				Pickup->SetRefuseInteract(Case == ECase::Refused);
+				ServerPickup = Pickup;
+				return false;
+			}
+
+			for (TActorIterator<AInteractionTestPickup> It(ClientCharacter->GetWorld()); It; ++It) {
+				ClientPickup = *It;
+				QuantityBefore = GetHeldQuantity(ClientInventory);
+				PressTime = Now;
+				bPressed = true;
+				FInteractionNetworkTestDriver::Interact(ClientCharacter, It->GetInteraction());
+
+				//Nothing has reached the server yet, the predicted stack comes from the pickup's OnPredictInteract
+				const TArray<UItem*> Predicted = ClientInventory->GetPredictedItems();
+				if (!Test->TestTrue(FString::Printf(TEXT("%s: the predicted item shows on the press"), GetCaseName()),
+					Predicted.Num() == 1 && Predicted[0]->IsA(ItemClass) && Predicted[0]->GetQuantity() == PickupQuantity)) {
+					return true;
+				}
+				break;
+			}
+			return false;
+		}
+
+		if (ClientInventory->GetPredictedItems().Num() > 0) {
+			return false;
+		}
+
+		const int32 QuantityGained = GetHeldQuantity(ClientInventory) - QuantityBefore;
+		const float Timeout = FInteractionNetworkTestDriver::GetPredictedInteractionTimeout(ClientCharacter);
+		const AInteractionTestPickup* Pickup = ClientPickup.Get();
+
+		if (Case == ECase::Granted) {
+			Test->TestEqual(TEXT("Granted: the predicted item is replaced by the server's stack"), QuantityGained, PickupQuantity);
+			Test->TestTrue(TEXT("Granted: the replacement comes with the server's stack, not the timeout"), Now - PressTime < Timeout);
+		} else if (Case == ECase::Refused) {
+			Test->TestEqual(TEXT("Refused: the predicted item is removed and nothing is granted"), QuantityGained, 0);
+			Test->TestTrue(TEXT("Refused: the pickup is shown again"), Pickup && !Pickup->IsPendingKillPending() && !Pickup->IsHidden());
+			Test->TestTrue(TEXT("Refused: the server still has the pickup"), ServerPickup.IsValid());
+		} else {
+			Test->TestEqual(TEXT("Never granted: the predicted item is removed and nothing is granted"), QuantityGained, 0);
+			Test->TestTrue(TEXT("Never granted: the predicted item stays until the timeout"), Now - PressTime >= Timeout);
+		}
+
+		if (AInteractionTestPickup* Remaining = ServerPickup.Get()) {
+			Remaining->Destroy();
+		}
+		ServerPickup.Reset();
+		ClientPickup.Reset();
+		bPressed = false;
+
+		if (Case == ECase::NeverGranted) {
+			return true;
+		}
+		Case = Case == ECase::Granted ? ECase::Refused : ECase::NeverGranted;
+		return false;
+	}
+
+private:
+	enum class ECase : uint8 {
+		Granted,
+		Refused,
+		NeverGranted
+	};
+
+	static const int32 PickupQuantity = 5;
+
+	static int32 GetHeldQuantity(const UInventoryComponent* Inventory) {
+		const UItem* Stack = Inventory->FindItemByClass(UInventoryTestStackableItem::StaticClass());
+		return Stack ? Stack->GetQuantity() : 0;
+	}
+
+	const TCHAR* GetCaseName() const {
+		return Case == ECase::Granted ? TEXT("Granted") : (Case == ECase::Refused ? TEXT("Refused") : TEXT("Never granted"));
+	}
+
+	ECase Case;
+
+	TWeakObjectPtr<AInteractionTestPickup> ServerPickup;
+
+	TWeakObjectPtr<AInteractionTestPickup> ClientPickup;
+
+	bool bPressed;
+
+	double PressTime;
+
+	int32 QuantityBefore;
+};
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPickupPredictedItemTest, "Trust.Interaction.PickupPredictedItem", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FPickupPredictedItemTest::RunTest(const FString& Parameters) {
+	ADD_LATENT_AUTOMATION_COMMAND(FPickupPredictedItemCommand(this, 150));
+	return true;
+}
+
+#endif
@@ -0,0 +1,167 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "TrustNetworkTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS && WITH_EDITOR
+
+#include "Editor.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "Settings/LevelEditorPlaySettings.h"
+#include "Trust/TrustCharacter.h"
+
+//Seconds PIE gets to start and hand both sides a character
+static const double NetworkTestSetupTimeout = 30.0;
+
+void FInteractionNetworkTestDriver::Interact(ATrustCharacter* Character, UInteractionComponent* Target) {
+	Character->FoundNewInteractable(Target);
+	Character->BeginInteraction();
+	Character->EndInteract();
+}
+
+bool FInteractionNetworkTestDriver::HasPredictedInteractions(const ATrustCharacter* Character) {
+	return Character->PredictedInteractions.Num() > 0;
+}
+
+float FInteractionNetworkTestDriver::GetPredictedInteractionTimeout(const ATrustCharacter* Character) {
+	return Character->PredictedInteractionTimeout;
+}
+
+FTrustNetworkTestCommand::FTrustNetworkTestCommand(FAutomationTestBase* InTest, const int32 InLagMs, const int32 InLossPercent)
+	: Test(InTest), LagMs(InLagMs), LossPercent(InLossPercent), TestTimeout(60.0), Stage(EStage::Start), StageStartTime(0.0) {}
+
+bool FTrustNetworkTestCommand::Update() {
+	const double Now = FPlatformTime::Seconds();
+
+	switch (Stage) {
+	case EStage::Start:
+		if (!StartSession()) {
+			return true;
+		}
+		Stage = EStage::WaitForCharacters;
+		StageStartTime = Now;
+		return false;
+
+	case EStage::WaitForCharacters: {
+		ATrustCharacter* ServerCharacter = nullptr;
+		ATrustCharacter* ClientCharacter = nullptr;
+		if (FindCharacters(ServerCharacter, ClientCharacter)) {
+			//Interaction reach is checked against where the server has the character, so nobody moves during the test
+			ServerCharacter->GetCharacterMovement()->DisableMovement();
+			ClientCharacter->GetCharacterMovement()->DisableMovement();
+			Stage = EStage::Test;
+			StageStartTime = Now;
+		} else if (Now - StageStartTime > NetworkTestSetupTimeout) {
+			Test->AddError(FString::Printf(TEXT("The PIE client didn't get a possessed ATrustCharacter within %.0f s"), NetworkTestSetupTimeout));
+			EndSession();
+		}
+		return false;
+	}
+
+	case EStage::Test: {
+		ATrustCharacter* ServerCharacter = nullptr;
+		ATrustCharacter* ClientCharacter = nullptr;
+		if (!FindCharacters(ServerCharacter, ClientCharacter)) {
+			Test->AddError(TEXT("Lost a character during the test"));
+			EndSession();
+		} else if (UpdateTest(ServerCharacter, ClientCharacter)) {
+			EndSession();
+		} else if (Now - StageStartTime > TestTimeout) {
+			Test->AddError(FString::Printf(TEXT("Test didn't finish within %.0f s"), TestTimeout));
+			EndSession();
+		}
+		return false;
+	}
+
+	case EStage::WaitForEnd:
+	default:
+		return !GEditor->IsPlaySessionInProgress();
+	}
+}
+
+bool FTrustNetworkTestCommand::StartSession() {
+	if (!GEditor || GEditor->IsPlaySessionInProgress()) {
+		Test->AddError(TEXT("Networked tests need the editor with no play session running"));
+		return false;
+	}
+
+	IConsoleVariable* PktLag = IConsoleManager::Get().FindConsoleVariable(TEXT("NetEmulation.PktLag"));
+	IConsoleVariable* PktLoss = IConsoleManager::Get().FindConsoleVariable(TEXT("NetEmulation.PktLoss"));
+	if (!PktLag || !PktLoss) {
+		Test->AddError(TEXT("This build has no network emulation"));
+		return false;
+	}
+
+	//Set before the net drivers are created so both ends of the connection pick them up
+	PreviousPktLag = PktLag->GetString();
+	PreviousPktLoss = PktLoss->GetString();
+	PktLag->Set(LagMs, ECVF_SetByConsole);
+	PktLoss->Set(LossPercent, ECVF_SetByConsole);
+
+	ULevelEditorPlaySettings* PlaySettings = NewObject<ULevelEditorPlaySettings>();
+	PlaySettings->SetPlayNetMode(EPlayNetMode::PIE_Client);
+	PlaySettings->SetPlayNumberOfClients(1);
+	PlaySettings->SetRunUnderOneProcess(true);
+
+	FRequestPlaySessionParams Params;
+	Params.WorldType = EPlaySessionWorldType::PlayInEditor;
+	Params.EditorPlaySettings = PlaySettings;
+	GEditor->RequestPlaySession(Params);
+	return true;
+}
+
+void FTrustNetworkTestCommand::EndSession() {
+	if (IConsoleVariable* PktLag = IConsoleManager::Get().FindConsoleVariable(TEXT("NetEmulation.PktLag"))) {
+		PktLag->Set(*PreviousPktLag, ECVF_SetByConsole);
+	}
+	if (IConsoleVariable* PktLoss = IConsoleManager::Get().FindConsoleVariable(TEXT("NetEmulation.PktLoss"))) {
+		PktLoss->Set(*PreviousPktLoss, ECVF_SetByConsole);
+	}
+
+	GEditor->RequestEndPlayMap();
+	Stage = EStage::WaitForEnd;
+}
+
+bool FTrustNetworkTestCommand::FindCharacters(ATrustCharacter*& OutServerCharacter, ATrustCharacter*& OutClientCharacter) {
+	UWorld* ServerWorld = nullptr;
+	UWorld* ClientWorld = nullptr;
+	for (const FWorldContext& Context : GEngine->GetWorldContexts()) {
+		UWorld* World = Context.World();
+		if (Context.WorldType == EWorldType::PIE && World) {
+			if (World->GetNetMode() == NM_DedicatedServer) {
+				ServerWorld = World;
+			} else if (World->GetNetMode() == NM_Client) {
+				ClientWorld = World;
+			}
+		}
+	}
+
+	APlayerController* ServerController = ServerWorld ? ServerWorld->GetFirstPlayerController() : nullptr;
+	if (!ServerController) {
+		return false;
+	}
+
+	//The map's game mode may give players some other pawn, the tests only need a character where the controller's pawn is
+	OutServerCharacter = Cast<ATrustCharacter>(ServerController->GetPawn());
+	if (!OutServerCharacter) {
+		APawn* OldPawn = ServerController->GetPawn();
+		FActorSpawnParameters SpawnParameters;
+		SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		const FVector Location = OldPawn ? OldPawn->GetActorLocation() : FVector(0.f, 0.f, 200.f);
+
+		OutServerCharacter = ServerWorld->SpawnActor<ATrustCharacter>(ATrustCharacter::StaticClass(), Location, FRotator::ZeroRotator, SpawnParameters);
+		ServerController->Possess(OutServerCharacter);
+		if (OldPawn) {
+			OldPawn->Destroy();
+		}
+	}
+
+	APlayerController* ClientController = ClientWorld ? ClientWorld->GetFirstPlayerController() : nullptr;
+	OutClientCharacter = ClientController ? Cast<ATrustCharacter>(ClientController->GetPawn()) : nullptr;
+	return OutServerCharacter && OutClientCharacter && OutClientCharacter->IsLocallyControlled();
+}
+
+#endif
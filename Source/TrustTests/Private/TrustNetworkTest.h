@@ -0,0 +1,72 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS && WITH_EDITOR
+
+class ATrustCharacter;
+class UInteractionComponent;
+
+/**Friend of ATrustCharacter, reaches the interaction entry points input would normally call*/
+struct FInteractionNetworkTestDriver {
+	/**Focuses Target and presses and releases interact, as the local player would*/
+	static void Interact(ATrustCharacter* Character, UInteractionComponent* Target);
+
+	static bool HasPredictedInteractions(const ATrustCharacter* Character);
+
+	static float GetPredictedInteractionTimeout(const ATrustCharacter* Character);
+};
+
+/**
+ * Plays the current map in PIE as a dedicated server and one client in this process, with NetEmulation.PktLag and
+ * NetEmulation.PktLoss set for the whole session. Once both sides have a possessed, unmoving ATrustCharacter it calls
+ * UpdateTest every frame until that returns true, then ends the session and puts the emulation settings back.
+ */
+class FTrustNetworkTestCommand : public IAutomationLatentCommand {
+
+public:
+	FTrustNetworkTestCommand(FAutomationTestBase* InTest, const int32 InLagMs, const int32 InLossPercent);
+
+	virtual bool Update() override final;
+
+protected:
+	/**Called every frame once both characters are ready, returns true when the test is done*/
+	virtual bool UpdateTest(ATrustCharacter* ServerCharacter, ATrustCharacter* ClientCharacter) = 0;
+
+	FAutomationTestBase* Test;
+
+	const int32 LagMs;
+
+	const int32 LossPercent;
+
+	//Seconds UpdateTest gets before the test fails
+	double TestTimeout;
+
+private:
+	enum class EStage : uint8 {
+		Start,
+		WaitForCharacters,
+		Test,
+		WaitForEnd
+	};
+
+	bool StartSession();
+
+	void EndSession();
+
+	/**Makes sure the server's player has an ATrustCharacter, returns both sides' characters once the client has its own*/
+	bool FindCharacters(ATrustCharacter*& OutServerCharacter, ATrustCharacter*& OutClientCharacter);
+
+	EStage Stage;
+
+	double StageStartTime;
+
+	FString PreviousPktLag;
+
+	FString PreviousPktLoss;
+};
+
+#endif
@@ -0,0 +1,23 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "TrustTestWorld.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+
+FTrustTestWorld::FTrustTestWorld() {
+	World = UWorld::CreateWorld(EWorldType::Game, false);
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	WorldContext.SetCurrentWorld(World);
+	World->InitializeActorsForPlay(FURL());
+	World->BeginPlay();
+}
+
+FTrustTestWorld::~FTrustTestWorld() {
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+}
+
+#endif
@@ -0,0 +1,26 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+class UWorld;
+
+/**A standalone game world that has begun play, for tests that need actors but no network. Destroyed with the scope*/
+struct FTrustTestWorld {
+
+public:
+	FTrustTestWorld();
+
+	~FTrustTestWorld();
+
+	FORCEINLINE UWorld* Get() const { return World; }
+
+private:
+	UWorld* World;
+};
+
+#endif
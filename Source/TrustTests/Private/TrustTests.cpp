@@ -0,0 +1,6 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "Modules/ModuleManager.h"
+
+//Automation tests and the classes they need. A developer module, so none of it is in shipping builds
+IMPLEMENT_MODULE(FDefaultModuleImpl, TrustTests);